@@ -0,0 +1,393 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+#include "solver.h"
+#include "nimber.h"
+#include "mcts.h"
+#include "book.h"
+
+/* Analysis off the GUI thread : the board's position is handed over after every change, and one worker thread looks
+ * at the newest one - the opening book's answer if it has the position, else a quick Monte Carlo guess, then the exact
+ * solver unless the book had solved it already. Work on a position the board has moved on from is given up at the next
+ * poll (both searches poll a stop function), so the worker is always on the board as it is. Each result is kept for the
+ * GUI to collect, with an SDL_USEREVENT pushed to say it is there : the event loop never waits on the worker */
+
+/* Global constants for background analysis */
+static const int analysisEventCode = 1;			// SDL_UserEvent code of a result, data1 holding the Analyzer
+static const Uint32 analysisGuessTime = 500;	// milliseconds of Monte Carlo search before the solver starts
+static const int analysisGuessThreads = 1;		// threads for it : the GUI keeps the rest
+static const int taskEventCode = 3;				// SDL_UserEvent code of a finished task, data1 holding the AnalysisTask
+static const int taskMoveThreads = 4;			// threads and milliseconds of Monte Carlo search for the computer's move
+static const Uint32 taskMoveTime = 2000;
+/* End constants */
+
+struct analysisResult
+{
+	unsigned generation;	// the submit it answers
+	bool solved;			// exact : won is proven, and move wins if won - else a Monte Carlo guess
+	bool won;
+	bool hasMove;			// false for a lost position (solved), or one with no move - won under misère, lost under normal play
+	sproutsMove move;
+	double winRate;			// for a guess : playouts the move won
+};
+
+class Analyzer
+{
+	private:
+		SDL_Thread *thread;
+		SDL_mutex *lock;			// guards pending and latest
+		SDL_cond *wake;				// signalled on submit and on quitting
+		position pending;
+		sproutsRules pendingRules;
+		volatile unsigned generation, working;	// newest submit, and the one being analysed
+		volatile bool quitting;
+		analysisResult latest;
+		bool hasLatest;
+
+		/* Private functions */
+		void post(const analysisResult&);
+		static bool stale(void*);
+		static int run(void*);
+
+	public:
+		/* Constructors */
+		Analyzer();
+		~Analyzer();
+
+		/* Public variables */
+		const Tablebase *tablebases[2];		// endgame outcomes for each rules (normal play, misère), if set - before the first submit
+		const OpeningBook *books[2];		// opening moves for each rules, if set - the same
+
+		/* Construction */
+		unsigned submit(const position&, sproutsRules=normalPlay);	// analyse this from now on, giving up anything older : returns its generation
+
+		/* Queries */
+		bool result(analysisResult&);		// the best known about the newest position, false if nothing yet
+};
+Analyzer::Analyzer()
+{
+	generation = working = 0;
+	quitting = false;
+	hasLatest = false;
+	tablebases[normalPlay] = tablebases[misere] = NULL;
+	books[normalPlay] = books[misere] = NULL;
+	lock = SDL_CreateMutex();
+	wake = SDL_CreateCond();
+	thread = SDL_CreateThread( run, this );
+}
+Analyzer::~Analyzer()
+{
+	SDL_mutexP( lock );
+	quitting = true;
+	SDL_CondSignal( wake );
+	SDL_mutexV( lock );
+	if( thread )
+		SDL_WaitThread( thread, NULL );
+	SDL_DestroyCond( wake );
+	SDL_DestroyMutex( lock );
+}
+unsigned Analyzer::submit(const position &p, sproutsRules rules)
+{
+	SDL_mutexP( lock );
+	pending = p;
+	pendingRules = rules;
+	unsigned g = ++generation;
+	hasLatest = false;
+	SDL_CondSignal( wake );
+	SDL_mutexV( lock );
+	return g;
+}
+bool Analyzer::result(analysisResult &r)
+{
+	SDL_mutexP( lock );
+	bool fresh = hasLatest && latest.generation == generation;
+	if( fresh )
+		r = latest;
+	SDL_mutexV( lock );
+	return fresh;
+}
+/* Kept only if the board has not moved on meanwhile */
+void Analyzer::post(const analysisResult &r)
+{
+	SDL_mutexP( lock );
+	bool fresh = r.generation == generation;
+	if( fresh )
+	{
+		latest = r;
+		hasLatest = true;
+	}
+	SDL_mutexV( lock );
+	if( fresh )
+	{
+		SDL_Event event;
+		event.type = SDL_USEREVENT;
+		event.user.code = analysisEventCode;
+		event.user.data1 = this;
+		event.user.data2 = NULL;
+		SDL_PushEvent( &event );
+	}
+}
+bool Analyzer::stale(void *data)
+{
+	Analyzer *a = (Analyzer*)data;
+	return a->quitting || a->generation != a->working;
+}
+/* Sleep until there is a position newer than the last one looked at, guess, then solve */
+int Analyzer::run(void *data)
+{
+	Analyzer &a = *(Analyzer*)data;
+	Solver solver;		// its table carries over : positions keep coming back a few moves apart
+	MonteCarlo player;
+	Canonicalizer canonicalizer;		// the books' own is the GUI thread's
+	position p;
+	const OpeningBook *book;
+	const bookEntry *entry;
+	unsigned done = 0;
+	solver.stop = player.stop = stale;
+	solver.stopData = player.stopData = &a;
+	for( ;; )
+	{
+		SDL_mutexP( a.lock );
+		while( !a.quitting && a.generation == done )
+			SDL_CondWait( a.wake, a.lock );
+		if( a.quitting )
+		{
+			SDL_mutexV( a.lock );
+			return 0;
+		}
+		p = a.pending;
+		solver.rules = player.rules = a.pendingRules;
+		solver.tablebase = a.tablebases[ a.pendingRules ];
+		book = a.books[ a.pendingRules ];
+		a.working = done = a.generation;
+		SDL_mutexV( a.lock );
+
+		analysisResult r;
+		r.generation = done;
+		r.solved = r.won = false;
+		if( book && book->lookup( p, r.move, canonicalizer, &entry ) )		// searched longer offline than the guess would be
+		{
+			r.solved = entry->value != 0;
+			r.won = entry->value > 0;
+			r.hasMove = !r.solved || r.won;
+			r.winRate = entry->winRate/65535.0;
+		}
+		else
+		{
+			r.hasMove = player.choose( p, analysisGuessThreads, analysisGuessTime, 0, r.move );
+			r.winRate = player.winRate;
+			if( stale( &a ) )
+				continue;
+			if( !r.hasMove )		// no move : decided by the rules, nothing to solve
+			{
+				r.solved = true;
+				r.won = solver.rules == misere;		// the rules the position was submitted under (pendingRules may have moved on)
+			}
+		}
+		a.post( r );
+		if( r.solved )
+			continue;
+		r.won = solver.solve( p, &r.move );
+		if( stale( &a ) )		// solve gave up, its answer means nothing
+			continue;
+		r.solved = true;
+		r.hasMove = r.won;
+		a.post( r );
+	}
+}
+
+/* The searches a key asks for - solve, nimber, the computer's move - on a thread of their own, so the window keeps
+ * drawing and taking input while they run. One at a time : its report (for the console) and move are collected by the
+ * GUI once an SDL_USEREVENT says it is done. The board may have moved on by then, so a move is checked before it is played */
+enum analysisTaskKind { taskSolve, taskNimber, taskMove };
+
+struct taskResult
+{
+	analysisTaskKind kind;
+	std::string report;		// what was found, for the console
+	bool hasMove;			// taskSolve : a winning move - taskMove : the move chosen
+	sproutsMove move;
+};
+
+class AnalysisTask
+{
+	private:
+		SDL_Thread *thread;
+		volatile bool stopping;
+		analysisTaskKind kind;
+		position p;
+		sproutsRules rules;
+		taskResult done;
+
+		/* Private functions */
+		void solve();
+		void nimber();
+		void choose();
+		static bool stopped(void*);
+		static int run(void*);
+
+	public:
+		/* Constructors */
+		AnalysisTask();
+		~AnalysisTask();		// gives the search up
+
+		/* Public variables */
+		const Tablebase *tablebases[2];		// for each rules, if set - as for the Analyzer
+		PositionDatabase *databases[2];
+		const OpeningBook *books[2];
+		void (*progress)(const Solver&, int, void*);	// for the solver, called on the task's thread, if set
+
+		/* Construction */
+		bool start(analysisTaskKind, const position&, sproutsRules=normalPlay);	// false if one is running still
+		bool finish(taskResult&);		// the result, once its event is in - false if none was started
+
+		/* Queries */
+		bool busy() const { return thread != NULL; }
+};
+AnalysisTask::AnalysisTask()
+{
+	thread = NULL;
+	stopping = false;
+	progress = NULL;
+	tablebases[normalPlay] = tablebases[misere] = NULL;
+	databases[normalPlay] = databases[misere] = NULL;
+	books[normalPlay] = books[misere] = NULL;
+}
+AnalysisTask::~AnalysisTask()
+{
+	stopping = true;
+	if( thread )
+		SDL_WaitThread( thread, NULL );
+}
+bool AnalysisTask::start(analysisTaskKind k, const position &from, sproutsRules r)
+{
+	if( thread )
+		return false;
+	kind = k;
+	p = from;
+	rules = r;
+	stopping = false;
+	thread = SDL_CreateThread( run, this );
+	return thread != NULL;
+}
+bool AnalysisTask::finish(taskResult &r)
+{
+	if( !thread )
+		return false;
+	SDL_WaitThread( thread, NULL );		// it has pushed its event : at its end already
+	thread = NULL;
+	r = done;
+	return true;
+}
+bool AnalysisTask::stopped(void *data)
+{
+	return ((AnalysisTask*)data)->stopping;
+}
+int AnalysisTask::run(void *data)
+{
+	AnalysisTask &t = *(AnalysisTask*)data;
+	t.done.kind = t.kind;
+	t.done.report.clear();
+	t.done.hasMove = false;
+	switch( t.kind )
+	{
+		case taskSolve:		t.solve();		break;
+		case taskNimber:	t.nimber();		break;
+		case taskMove:		t.choose();		break;
+	}
+	SDL_Event event;
+	event.type = SDL_USEREVENT;
+	event.user.code = taskEventCode;
+	event.user.data1 = &t;
+	event.user.data2 = NULL;
+	while( !t.stopping && SDL_PushEvent( &event ) < 0 )
+		SDL_Delay( 1 );
+	return 0;
+}
+/* Who wins, and a winning move */
+void AnalysisTask::solve()
+{
+	Solver solver;
+	position after;
+	std::string text;
+	int moves;
+	solver.progress = progress;
+	solver.stop = stopped;
+	solver.stopData = this;
+	solver.rules = rules;
+	solver.tablebase = tablebases[rules];
+	solver.database = databases[rules];
+	bool won = solver.solve( p, &done.move, &moves );
+	if( solver.stopped() )
+		done.report = "Solving given up";
+	else if( won && !moves )
+		done.report = "The player to move wins : no move left";
+	else if( won )
+	{
+		done.hasMove = true;
+		applyMove( p, done.move, after );
+		writePosition( after, text );
+		done.report = "The player to move wins, by moving to " + text;
+	}
+	else
+		done.report = "The player to move loses";
+}
+/* Nimber of the position : the XOR of its independent parts', each searched apart - normal play only */
+void AnalysisTask::nimber()
+{
+	std::vector<position> parts;
+	NimberSolver solver;
+	std::string text;
+	char line[64];
+	solver.database = databases[normalPlay];
+	solver.stop = stopped;
+	solver.stopData = this;
+	solver.split( p, parts );
+	int total = 0;
+	for( unsigned i = 0; i < parts.size(); i++ )
+	{
+		int n = solver.nimber( parts[i] );
+		if( solver.stopped() )
+		{
+			done.report = "Nimber search given up";
+			return;
+		}
+		writePosition( parts[i], text );
+		sprintf( line, "  nimber %d\n", n );
+		done.report += text + line;
+		total ^= n;
+	}
+	sprintf( line, "Nimber %d : the player to move %s", total, total ? "wins" : "loses" );
+	done.report += line;
+}
+/* The opening book's move, else a Monte Carlo search's */
+void AnalysisTask::choose()
+{
+	MonteCarlo player;
+	Canonicalizer canonicalizer;		// the book's own is the GUI thread's
+	char line[128];
+	player.rules = rules;
+	player.stop = stopped;
+	player.stopData = this;
+	if( books[rules] && books[rules]->lookup( p, done.move, canonicalizer ) )
+	{
+		done.hasMove = true;
+		done.report = "Book move";
+	}
+	else if( player.choose( p, taskMoveThreads, taskMoveTime, 0, done.move ) )
+	{
+		done.hasMove = true;
+		sprintf( line, "%lu playouts (%d a second), the move wins %d%% of them", (unsigned long)player.playouts, (int)player.rate(), (int)(100*player.winRate) );
+		done.report = line;
+	}
+	else
+		done.report = "No move left";
+}
+
+#endif
@@ -0,0 +1,805 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <SDL/SDL.h>
+
+#include "sweep.h"
+#include "faces.h"
+#include "router.h"
+#include "triangulation.h"
+#include "position.h"
+#include "canonical.h"
+#include "solver.h"
+#include "parallel.h"
+#include "nimber.h"
+#include "database.h"
+#include "mcts.h"
+#include "packed.h"
+
+using namespace std;
+
+/* Benchmarks for the analysis code - no window, just timings printed to stdout
+ * Usage : sproutsBench [sweep|faces|region|route|mesh|position|canonical|solve|parallel|nimber|database|perft|mcts|misere|packed|suite] [threads]
+ * suite writes JSON, to compare builds by machine */
+
+/* Every allocation counted, to check the hot loops make none, and the bytes live on the heap with the most there have
+ * been since heapPeak was last reset (each block carries its size in front of it). No exception specifications : a
+ * replacement takes the ones <new> declares, which C++98 and C++17 spell differently */
+static volatile unsigned long allocations = 0;
+static volatile size_t heapBytes = 0, heapPeak = 0;
+static const size_t heapHeader = 16;		// keeps the blocks handed out aligned as malloc's
+__attribute__((noinline)) void *operator new(size_t size)
+{
+	__sync_add_and_fetch( &allocations, 1 );		// the parallel benches allocate on several threads at once
+	char *p = (char*)malloc( size + heapHeader );
+	if( !p )
+		throw std::bad_alloc();
+	*(size_t*)p = size;
+	size_t live = __sync_add_and_fetch( &heapBytes, size ), peak = heapPeak;
+	while( live > peak && !__sync_bool_compare_and_swap( &heapPeak, peak, live ) )		// raised only, never over a higher one from another thread
+		peak = heapPeak;
+	return p + heapHeader;
+}
+__attribute__((noinline)) void operator delete(void *p)
+{
+	if( !p )
+		return;
+	char *block = (char*)p - heapHeader;
+	__sync_sub_and_fetch( &heapBytes, *(size_t*)block );
+	free( block );
+}
+
+/* n random segments of similar length in a square sized so there are roughly as many crossings as segments */
+void randomSegments(int n, vector<segment> &segs)
+{
+	double side = 40*sqrt((double)n), length = 20;
+	segs.clear();
+	for( int i = 0; i < n; i++ )
+	{
+		double x = side*rand()/RAND_MAX, y = side*rand()/RAND_MAX, angle = 6.2831853*rand()/RAND_MAX;
+		segment s = { x, y, x + length*cos(angle), y + length*sin(angle), i, 0, true, true };
+		segs.push_back( s );
+	}
+}
+/* Every pair tested : what the sweep replaces */
+int naiveCrossings(const vector<segment> &segs)
+{
+	int k = 0;
+	double s, t;
+	for( unsigned i = 0; i < segs.size(); i++ )
+		for( unsigned j = i + 1; j < segs.size(); j++ )
+			if( segmentsCross( segs[i].x0,segs[i].y0, segs[i].x1,segs[i].y1, segs[j].x0,segs[j].y0, segs[j].x1,segs[j].y1, s, t ) )
+				k++;
+	return k;
+}
+void benchSweep(int threads)
+{
+	const int sizes[] = { 1000, 10000, 100000 };
+	vector<segment> segs;
+	vector<sweepHit> hits;
+	Uint32 start;
+	const double collinear[4][8] = {		// pairs of segments on one line : overlapping, one inside the other, apart, and a parallel pair off it
+		{ 0,0, 10,10,  5,5, 15,15 }, { 0,0, 10,0,  8,0, 2,0 }, { 0,0, 1,2,  2,4, 3,6 }, { 0,0, 10,0,  0,1, 10,1 } };
+	const bool collinearCross[4] = { true, true, false, false };
+	for( int i = 0; i < 4; i++ )
+	{
+		const double *c = collinear[i];
+		double s = -1, t = -1;
+		segment pair[2] = { { c[0],c[1], c[2],c[3], 0, 0, true, true }, { c[4],c[5], c[6],c[7], 1, 0, true, true } };
+		segs.assign( pair, pair + 2 );
+		hits.clear();
+		sweepCrossings( segs, hits );
+		bool cross = segmentsCross( c[0],c[1], c[2],c[3], c[4],c[5], c[6],c[7], s, t );
+		bool onBoth = !cross || (fabs( c[0] + (c[2] - c[0])*s - c[4] - (c[6] - c[4])*t ) < 1e-9 && fabs( c[1] + (c[3] - c[1])*s - c[5] - (c[7] - c[5])*t ) < 1e-9);
+		printf( "collinear pair %d : %s, sweep %d hits%s\n", i, cross ? "cross" : "apart", (int)hits.size(),
+			cross == collinearCross[i] && onBoth && !hits.empty() == cross ? "" : "  WRONG" );
+	}
+	printf( "segments  crossings  naive(ms)  sweep(ms)  sweep x%d(ms)\n", threads );
+	for( int i = 0; i < 3; i++ )
+	{
+		srand( 1 );			// same board every run
+		randomSegments( sizes[i], segs );
+		int naive = -1;
+		Uint32 naiveTime = 0;
+		if( sizes[i] <= 10000 )		// 100k is 5e9 pairs : not worth waiting for
+		{
+			start = SDL_GetTicks();
+			naive = naiveCrossings( segs );
+			naiveTime = SDL_GetTicks() - start;
+		}
+		hits.clear();
+		start = SDL_GetTicks();
+		sweepCrossings( segs, hits );
+		Uint32 sweepTime = SDL_GetTicks() - start;
+		int k = hits.size();
+		hits.clear();
+		start = SDL_GetTicks();
+		sweepCrossings( segs, hits, threads );
+		Uint32 parallelTime = SDL_GetTicks() - start;
+		if( naive >= 0 && naive != k )
+			printf( "MISMATCH : naive found %d crossings\n", naive );
+		if( (int)hits.size() != k )
+			printf( "MISMATCH : %d threads found %d crossings\n", threads, (int)hits.size() );
+		if( naive >= 0 )
+			printf( "%8d  %9d  %9u  %9u  %12u\n", sizes[i], k, naiveTime, sweepTime, parallelTime );
+		else
+			printf( "%8d  %9d  %9s  %9u  %12u\n", sizes[i], k, "-", sweepTime, parallelTime );
+	}
+}
+
+/* A k by k grid of spots joined to their neighbours and across one diagonal of each cell, with slightly bent curves */
+void gridBoard(int k, board &bd)
+{
+	const double spacing = 30, bend = 3;
+	bd.spots.clear();
+	bd.curves.clear();
+	for( int i = 0; i < k*k; i++ )
+	{
+		boardSpot s = { spacing*(i % k), spacing*(i / k) };
+		bd.spots.push_back( s );
+	}
+	for( int i = 0; i < k*k; i++ )
+	{
+		int x = i % k, y = i / k, from[3] = { i, i, i }, to[3] = { -1, -1, -1 };
+		if( x + 1 < k ) to[0] = i + 1;
+		if( y + 1 < k ) to[1] = i + k;
+		if( x + 1 < k && y + 1 < k )	// the cell right and below : one diagonal or the other
+		{
+			if( rand() % 2 )
+				to[2] = i + k + 1;
+			else
+			{
+				from[2] = i + 1;
+				to[2] = i + k;
+			}
+		}
+		for( int j = 0; j < 3; j++ )
+		{
+			if( to[j] < 0 )
+				continue;
+			const boardSpot &a = bd.spots[from[j]], &b = bd.spots[to[j]];
+			double nx = -(b.y - a.y)/spacing*bend, ny = (b.x - a.x)/spacing*bend;	// push the middle control points sideways a little
+			boardCurve c;
+			c.from = from[j];
+			c.to = to[j];
+			c.c.x[0] = a.x;	c.c.x[1] = (2*a.x + b.x)/3 + nx;	c.c.x[2] = (a.x + 2*b.x)/3 + nx;	c.c.x[3] = b.x;
+			c.c.y[0] = a.y;	c.c.y[1] = (2*a.y + b.y)/3 + ny;	c.c.y[2] = (a.y + 2*b.y)/3 + ny;	c.c.y[3] = b.y;
+			bd.curves.push_back( c );
+		}
+	}
+}
+void benchFaces()
+{
+	const int sizes[] = { 10, 20, 30 }, repeats = 20;
+	board bd;
+	PlanarMap map;
+	printf( "spots  curves  faces  build(ms)\n" );
+	for( int i = 0; i < 3; i++ )
+	{
+		srand( 1 );
+		gridBoard( sizes[i], bd );
+		Uint32 start = SDL_GetTicks();
+		for( int r = 0; r < repeats; r++ )
+			map.build( bd );
+		printf( "%5d  %6d  %5d  %9.2f\n", (int)bd.spots.size(), (int)bd.curves.size(), map.faces(), (double)(SDL_GetTicks() - start)/repeats );
+	}
+}
+/* Point in face queries at random points of the grid : faceAt finds the face, inFace checks it */
+void benchRegion()
+{
+	const int sizes[] = { 10, 20, 30 }, queries = 100000;
+	board bd;
+	PlanarMap map;
+	printf( "faces  queries  wrong  faceAt(us)  inFace(us)\n" );
+	for( int i = 0; i < 3; i++ )
+	{
+		srand( 1 );
+		gridBoard( sizes[i], bd );
+		map.build( bd );
+		double side = 30*(sizes[i] - 1);
+		std::vector<double> xs( queries ), ys( queries );
+		std::vector<int> found( queries );
+		for( int q = 0; q < queries; q++ )
+		{
+			xs[q] = side*rand()/RAND_MAX;
+			ys[q] = side*rand()/RAND_MAX;
+		}
+		Uint32 start = SDL_GetTicks();
+		for( int q = 0; q < queries; q++ )
+			found[q] = map.faceAt( xs[q], ys[q] );
+		Uint32 locateTime = SDL_GetTicks() - start;
+		int wrong = 0;
+		start = SDL_GetTicks();
+		for( int q = 0; q < queries; q++ )
+			if( !map.inFace( found[q], xs[q], ys[q] ) )
+				wrong++;
+		Uint32 testTime = SDL_GetTicks() - start;
+		printf( "%5d  %7d  %5d  %10.3f  %10.3f\n", map.faces(), queries, wrong, 1000.0*locateTime/queries, 1000.0*testTime/queries );
+	}
+}
+/* A serpentine : walls hanging alternately from the top and bottom of a screen sized board, routed from one end to the other */
+void benchRoute()
+{
+	const int sizes[] = { 4, 8, 16 }, repeats = 20;
+	const double width = 960, height = 540;
+	box screen = { 0, 0, width, height };
+	printf( "walls  pieces  route(ms)\n" );
+	for( int i = 0; i < 3; i++ )
+	{
+		PlanarMap map;
+		int a = map.addSpot( 10, height/2 ), b = map.addSpot( width - 10, height/2 );
+		for( int w = 0; w < sizes[i]; w++ )
+		{
+			double x = width*(w + 1)/(sizes[i] + 1), top = w % 2 ? 60 : 0, bottom = w % 2 ? height : height - 60;
+			int from = map.addSpot( x, top ), to = map.addSpot( x, bottom );
+			cubic c = { { x, x + 10, x - 10, x }, { top, (2*top + bottom)/3, (top + 2*bottom)/3, bottom } };
+			map.addCurve( c, from, to );
+		}
+		Router router( map, screen );
+		std::vector<cubic> chain;
+		bool routed = false;
+		Uint32 start = SDL_GetTicks();
+		for( int r = 0; r < repeats; r++ )
+			routed = router.route( a, b, chain );
+		printf( "%5d  %6d  %9.2f%s\n", sizes[i], (int)chain.size(), (double)(SDL_GetTicks() - start)/repeats, routed ? "" : "  (no route)" );
+	}
+}
+/* Triangulation of the grid boards : all curves inserted one by one, then walks and shortest paths corner to corner */
+void benchMesh()
+{
+	const int sizes[] = { 10, 20, 30 }, queries = 100000, paths = 100;
+	board bd;
+	Triangulation mesh;
+	printf( "curves  triangles  build(ms)  locate(us)  path(ms)  length\n" );
+	for( int i = 0; i < 3; i++ )
+	{
+		srand( 1 );
+		gridBoard( sizes[i], bd );
+		double side = 30*(sizes[i] - 1);
+		box area = { 0, 0, side, side };
+		Uint32 start = SDL_GetTicks();
+		mesh.clear( area );
+		for( unsigned c = 0; c < bd.curves.size(); c++ )
+			if( !mesh.insertCurve( bd.curves[c].c ) )
+				printf( "curve %d crosses another\n", c );
+		Uint32 buildTime = SDL_GetTicks() - start;
+		start = SDL_GetTicks();
+		for( int q = 0; q < queries; q++ )
+			mesh.locate( side*rand()/RAND_MAX, side*rand()/RAND_MAX );
+		Uint32 locateTime = SDL_GetTicks() - start;
+		std::vector<double> xs, ys;
+		double length = 0;
+		start = SDL_GetTicks();
+		for( int q = 0; q < paths; q++ )		// corner to corner outside the grid : round it, since every cell is closed
+			length = mesh.shortestPath( -20, -10, side + 20, side + 10, xs, ys );
+		Uint32 pathTime = SDL_GetTicks() - start;
+		printf( "%6d  %9d  %9u  %10.3f  %8.3f  %6.0f\n", (int)bd.curves.size(), mesh.triangles(), buildTime, 1000.0*locateTime/queries, (double)pathTime/paths, length );
+	}
+}
+/* Position strings of the grid boards, with every other curve left out so spots have lives left : time per curve should stay flat */
+void benchPosition()
+{
+	const int sizes[] = { 10, 20, 30, 60 }, repeats = 50;
+	board bd;
+	PlanarMap map;
+	position p;
+	std::string text;
+	std::vector<bool> joint;
+	printf( "curves  faces  length  extract(us)  per curve(ns)\n" );
+	for( int i = 0; i < 4; i++ )
+	{
+		srand( 1 );
+		gridBoard( sizes[i], bd );
+		std::vector<boardCurve> kept;
+		for( unsigned c = 0; c < bd.curves.size(); c += 2 )
+			kept.push_back( bd.curves[c] );
+		bd.curves.swap( kept );
+		map.build( bd );
+		Uint32 start = SDL_GetTicks();
+		for( int r = 0; r < repeats; r++ )
+		{
+			extractPosition( map, joint, p );
+			writePosition( p, text );
+		}
+		double time = 1000.0*(SDL_GetTicks() - start)/repeats;
+		printf( "%6d  %5d  %6d  %11.1f  %13.1f\n", (int)bd.curves.size(), map.faces(), (int)text.size(), time, 1000.0*time/bd.curves.size() );
+	}
+}
+/* The same position written another way : labels renamed, boundaries turned, regions mirrored, both shuffled */
+void scramblePosition(const position &p, position &out)
+{
+	vector<int> names( p.labels ), regionOrder( p.regionEnd.size() );
+	for( int l = 0; l < p.labels; l++ )
+		names[l] = l;
+	std::random_shuffle( names.begin(), names.end() );
+	for( unsigned r = 0; r < regionOrder.size(); r++ )
+		regionOrder[r] = r;
+	std::random_shuffle( regionOrder.begin(), regionOrder.end() );
+	out.spots.clear();
+	out.boundaryEnd.clear();
+	out.regionEnd.clear();
+	out.labels = p.labels;
+	for( unsigned i = 0; i < regionOrder.size(); i++ )
+	{
+		int r = regionOrder[i], first = r ? p.regionEnd[r - 1] : 0;
+		bool mirror = rand() % 2;
+		vector<int> boundaries;
+		for( int b = first; b < p.regionEnd[r]; b++ )
+			boundaries.push_back( b );
+		std::random_shuffle( boundaries.begin(), boundaries.end() );
+		for( unsigned j = 0; j < boundaries.size(); j++ )
+		{
+			int b = boundaries[j], begin = b ? p.boundaryEnd[b - 1] : 0, length = p.boundaryEnd[b] - begin, turn = rand() % length;
+			for( int k = 0; k < length; k++ )
+			{
+				int c = p.spots[ begin + (turn + (mirror ? length - k : k)) % length ];
+				out.spots.push_back( c < positionLabel ? c : positionLabel + names[c - positionLabel] );
+			}
+			out.boundaryEnd.push_back( out.spots.size() );
+		}
+		out.regionEnd.push_back( out.boundaryEnd.size() );
+	}
+}
+/* Canonical forms and hashes of small positions, the size a solver meets them at - and positions from random games
+ * written other ways, which must all get the same form */
+void benchCanonical()
+{
+	const char *texts[] = { "0.0.0.0.0.0.0.0.}!", "A0B.1C.}CAB.}2D1D.0.}!", "1A1A.B2B1.}0.0.1C.}C2.}!", "0.0.0.}AB.}BA1.0.}!" };
+	const int count = 4, repeats = 1000000;
+	position p[count], canon;
+	Canonicalizer canonicalizer;
+	std::string key;
+	Uint64 hashes = 0;
+	printf( "position                   canonical                  hash\n" );
+	for( int i = 0; i < count; i++ )
+	{
+		readPosition( texts[i], p[i] );
+		canonicalizer.canonical( p[i], canon );
+		writePosition( canon, key );
+		printf( "%-25s  %-25s  %08X%08X\n", texts[i], key.c_str(), (Uint32)(positionHash( canon ) >> 32), (Uint32)positionHash( canon ) );
+	}
+	Uint32 start = SDL_GetTicks();
+	for( int r = 0; r < repeats; r++ )
+	{
+		canonicalizer.canonical( p[r % count], canon );
+		hashes += positionHash( canon );
+	}
+	Uint32 time = SDL_GetTicks() - start;
+	printf( "%d canonical forms and hashes in %u ms : %.2f million per second (%08X)\n", repeats, time, time ? repeats/(1000.0*time) : 0, (Uint32)hashes );
+
+	const int games = 2000, ways = 10;
+	vector<sproutsMove> moves;
+	position q, other, otherCanon;
+	int checked = 0, differ = 0;
+	srand( 1 );
+	for( int g = 0; g < games; g++ )
+	{
+		readPosition( texts[0], q );
+		for( ;; )
+		{
+			canonicalizer.canonical( q, canon );
+			for( int w = 0; w < ways; w++ )
+			{
+				scramblePosition( q, other );
+				canonicalizer.canonical( other, otherCanon );
+				checked++;
+				differ += !(otherCanon.spots == canon.spots && otherCanon.boundaryEnd == canon.boundaryEnd && otherCanon.regionEnd == canon.regionEnd);
+			}
+			generateMoves( q, moves );
+			if( moves.empty() )
+				break;
+			applyMove( q, moves[ rand() % moves.size() ], other );
+			q = other;
+		}
+	}
+	printf( "%d positions from random games written other ways : %d with another canonical form%s\n", checked, differ, differ ? "  WRONG" : "" );
+}
+/* Starting positions of 1 to 6 spots solved from scratch (6 takes a while) */
+void benchSolve()
+{
+	const int knownMoves[5] = { 0, 1, 5, 15, 38 };		// from n isolated spots : n*2^(n-1) loops (other spots inside or out) and n(n-1)/2 joins
+	vector<sproutsMove> moves;
+	for( int n = 1; n <= 4; n++ )
+	{
+		std::string text;
+		position p;
+		for( int i = 0; i < n; i++ )
+			text += "0.";
+		text += "}!";
+		readPosition( text.c_str(), p );
+		generateMoves( p, moves );
+		printf( "%d spots : %lu moves%s\n", n, (unsigned long)moves.size(), (int)moves.size() == knownMoves[n] ? "" : "  WRONG" );
+	}
+	printf( "spots  result  positions  hits      time(ms)  positions/s\n" );
+	for( int n = 1; n <= 6; n++ )
+	{
+		std::string text;
+		position p;
+		for( int i = 0; i < n; i++ )
+			text += "0.";
+		text += "}!";
+		readPosition( text.c_str(), p );
+		Solver solver;
+		bool win = solver.solve( p );
+		Uint32 time = SDL_GetTicks() - solver.started;
+		printf( "%5d  %6s  %9lu  %8lu  %8u  %11.0f\n", n, win ? "win" : "loss", (unsigned long)solver.nodes, (unsigned long)solver.hits, time, time ? 1000.0*solver.nodes/time : 0 );
+	}
+}
+/* The 6 spot start (a loss : every move has to be refuted, so there is plenty to share out) on 1, 2, 4 ... threads */
+void benchParallel(int threads)
+{
+	position p;
+	readPosition( "0.0.0.0.0.0.}!", p );
+	ParallelSolver solver;
+	double base = 0;
+	printf( "threads  result  positions  time(ms)  positions/s  speedup\n" );
+	for( int t = 1; t <= threads; t *= 2 )
+	{
+		solver.clear();
+		Uint32 start = SDL_GetTicks();
+		bool win = solver.solve( p, t );
+		Uint32 time = SDL_GetTicks() - start;
+		double rate = time ? 1000.0*solver.nodes/time : 0;
+		if( t == 1 )
+			base = time;
+		printf( "%7d  %6s  %9lu  %8u  %11.0f  %7.2f\n", t, win ? "win" : "loss", (unsigned long)solver.nodes, time, rate, time ? base/time : 0 );
+	}
+}
+/* Sums of starting positions (separate regions) : the nimber solver against the plain search of the whole tree */
+void benchNimber()
+{
+	const char *texts[] = { "0.0.0.0.0.}!", "0.0.0.}0.0.0.}!", "0.0.}0.0.0.}0.0.0.}!", "0.0.0.0.}0.0.0.}!" };
+	printf( "position                nimber  positions  time(ms)  negamax positions  time(ms)\n" );
+	for( int i = 0; i < 4; i++ )
+	{
+		position p;
+		readPosition( texts[i], p );
+		NimberSolver nimbers;
+		Solver solver;
+		Uint32 start = SDL_GetTicks();
+		int value = nimbers.nimber( p );
+		Uint32 nimberTime = SDL_GetTicks() - start;
+		bool win = solver.solve( p );
+		Uint32 solveTime = SDL_GetTicks() - solver.started;
+		if( win != (value != 0) )
+			printf( "MISMATCH : negamax says %s\n", win ? "win" : "loss" );
+		printf( "%-22s  %6d  %9lu  %8u  %17lu  %8u\n", texts[i], value, (unsigned long)nimbers.nodes, nimberTime, (unsigned long)solver.nodes, solveTime );
+	}
+}
+/* The 5 spot start solved into a new database, then again by a fresh solver reading it back mapped read-only */
+void benchDatabase()
+{
+	const char *path = "sproutsBench.db";
+	position p;
+	readPosition( "0.0.0.0.0.}!", p );
+	remove( path );
+	PositionDatabase database;
+	if( !database.open( path, true, 16 ) )
+	{
+		printf( "could not create %s\n", path );
+		return;
+	}
+	Solver first;
+	first.database = &database;
+	bool win = first.solve( p );
+	Uint32 firstTime = SDL_GetTicks() - first.started;
+	database.flush();
+	database.close();
+	Uint32 start = SDL_GetTicks();
+	if( !database.open( path ) )
+	{
+		printf( "could not reopen %s\n", path );
+		return;
+	}
+	Uint32 openTime = SDL_GetTicks() - start;
+	Solver second;
+	second.database = &database;
+	bool again = second.solve( p );
+	Uint32 secondTime = SDL_GetTicks() - second.started;
+	const int lookups = 1000000;
+	int value, depth, found = 0;
+	start = SDL_GetTicks();
+	for( int i = 0; i < lookups; i++ )
+		found += database.find( (Uint64)i*0x9E3779B97F4A7C15ull, databaseOutcome, value, depth );
+	Uint32 lookupTime = SDL_GetTicks() - start;
+	printf( "records  open(ms)  solve(ms) positions  again(ms) positions  lookups/s\n" );
+	printf( "%7lu  %8u  %9u %9lu  %9u %9lu  %9.0f%s\n", (unsigned long)database.records(), openTime, firstTime, (unsigned long)first.nodes,
+		secondTime, (unsigned long)second.nodes, lookupTime ? 1000.0*lookups/lookupTime : 0, win == again ? "" : "  MISMATCH" );
+	database.close();
+	remove( path );
+}
+/* Leaves of the move tree depth moves down, every move counted (no canonical forms, no transpositions) : the move
+ * generator on its own */
+Uint64 perft(const position &p, int depth, vector<moveList> &lists)
+{
+	moveList &list = lists[depth];
+	int count = generateChildren( p, list );
+	if( depth == 1 )
+		return count;
+	Uint64 leaves = 0;
+	for( int i = 0; i < count; i++ )
+		leaves += perft( list.children[i], depth - 1, lists );
+	return leaves;
+}
+/* Starting positions taken deeper until a count takes a fifth of a second : the second run of each reuses the scratch, and
+ * should allocate nothing */
+void benchPerft()
+{
+	printf( "spots  depth  leaves        time(ms)  leaves/s     allocations\n" );
+	for( int n = 2; n <= 5; n++ )
+	{
+		std::string text;
+		position p;
+		for( int i = 0; i < n; i++ )
+			text += "0.";
+		text += "}!";
+		readPosition( text.c_str(), p );
+		vector<moveList> lists( livesBound( p ) + 1 );
+		Uint32 time = 0;
+		for( int depth = 1; depth <= livesBound( p ) && time < 200; depth++ )
+		{
+			perft( p, depth, lists );
+			unsigned long before = allocations;
+			Uint32 start = SDL_GetTicks();
+			Uint64 leaves = perft( p, depth, lists );
+			time = SDL_GetTicks() - start;
+			printf( "%5d  %5d  %12lu  %8u  %11.0f  %11lu\n", n, depth, (unsigned long)leaves, time, time ? 1000.0*leaves/time : 0, allocations - before );
+		}
+	}
+}
+/* Playouts per second from the 8 spot start on 1, 2, 4 ... threads, then the moves chosen in a second from the
+ * 5 and 6 spot starts checked by the solver (5 is a win : the move should be a winning one) */
+void benchMonteCarlo(int threads)
+{
+	position p;
+	sproutsMove best;
+	readPosition( "0.0.0.0.0.0.0.0.}!", p );
+	printf( "threads  playouts  time(ms)  playouts/s\n" );
+	for( int t = 1; t <= threads; t *= 2 )
+	{
+		MonteCarlo player;
+		player.choose( p, t, 1000, 0, best );
+		printf( "%7d  %8lu  %8u  %10.0f\n", t, (unsigned long)player.playouts, player.elapsed, player.rate() );
+	}
+	printf( "position          playouts  win rate  move leads to           solver says the mover\n" );
+	for( int n = 5; n <= 6; n++ )
+	{
+		std::string text, childText;
+		position child, canon;
+		Canonicalizer canonicalizer;
+		for( int i = 0; i < n; i++ )
+			text += "0.";
+		text += "}!";
+		readPosition( text.c_str(), p );
+		MonteCarlo player;
+		player.choose( p, threads, 1000, 0, best );
+		applyMove( p, best, child );
+		canonicalizer.canonical( child, canon );
+		writePosition( canon, childText );
+		Solver solver;
+		bool childWins = solver.solve( canon );
+		printf( "%-16s  %8lu  %8.2f  %-22s  %s\n", text.c_str(), (unsigned long)player.playouts, player.winRate, childText.c_str(), childWins ? "loses" : "wins" );
+	}
+}
+/* Starting positions of 1 to 5 spots under both rules, each from scratch, with the parallel solver as a check on misère */
+void benchMisere(int threads)
+{
+	const char *ends[2] = { "2.}!", "2.}2.}!" };		// no move : the player to move has lost normal play and won misère
+	for( int i = 0; i < 2; i++ )
+	{
+		position p;
+		sproutsMove best;
+		Solver normal, other;
+		ParallelSolver check;
+		int moves, checkMoves;
+		readPosition( ends[i], p );
+		other.rules = check.rules = misere;
+		best.region = -1;
+		bool normalWin = normal.solve( p ), misereWin = other.solve( p, &best, &moves ), parallelWin = check.solve( p, threads, &best, &checkMoves );
+		printf( "%s : normal %s, misere %s%s\n", ends[i], normalWin ? "win" : "loss", misereWin ? "win" : "loss",
+			!normalWin && misereWin && parallelWin && !moves && !checkMoves && best.region == -1 ? "" : "  WRONG" );
+	}
+	printf( "spots  normal  positions  time(ms)  misere  positions  time(ms)\n" );
+	for( int n = 1; n <= 5; n++ )
+	{
+		std::string text;
+		position p;
+		for( int i = 0; i < n; i++ )
+			text += "0.";
+		text += "}!";
+		readPosition( text.c_str(), p );
+		Solver normal, other;
+		other.rules = misere;
+		bool normalWin = normal.solve( p );
+		Uint32 normalTime = SDL_GetTicks() - normal.started;
+		bool misereWin = other.solve( p );
+		Uint32 misereTime = SDL_GetTicks() - other.started;
+		ParallelSolver check;
+		check.rules = misere;
+		printf( "%5d  %6s  %9lu  %8u  %6s  %9lu  %8u%s\n", n, normalWin ? "win" : "loss", (unsigned long)normal.nodes, normalTime,
+			misereWin ? "win" : "loss", (unsigned long)other.nodes, misereTime, check.solve( p, threads ) == misereWin ? "" : "  MISMATCH" );
+	}
+}
+/* Every canonical position within four moves of the 2 to 8 spot starts, packed and unpacked : the round trip is checked,
+ * then the size against the position structs and the time to pack, unpack and hash */
+void benchPacked()
+{
+	vector<position> all, level, next;
+	vector<Uint64> keys;
+	vector<sproutsMove> moves;
+	Canonicalizer canonicalizer;
+	position child, canon, back;
+	for( int n = 2; n <= 8; n++ )
+	{
+		std::string text;
+		for( int i = 0; i < n; i++ )
+			text += "0.";
+		text += "}!";
+		readPosition( text.c_str(), child );
+		canonicalizer.canonical( child, canon );
+		level.assign( 1, canon );
+		for( int ply = 0; ply < 4; ply++ )
+		{
+			next.clear();
+			for( unsigned i = 0; i < level.size(); i++ )
+			{
+				Uint64 key = positionHash( level[i] );
+				if( find( keys.begin(), keys.end(), key ) != keys.end() )
+					continue;
+				keys.push_back( key );
+				all.push_back( level[i] );
+				generateMoves( level[i], moves );
+				for( unsigned m = 0; m < moves.size(); m++ )
+				{
+					applyMove( level[i], moves[m], child );
+					canonicalizer.canonical( child, canon );
+					next.push_back( canon );
+				}
+			}
+			level.swap( next );
+		}
+	}
+	size_t structBytes = 0, codes = 0, wrong = 0;
+	PackedPositions packed;
+	for( unsigned i = 0; i < all.size(); i++ )
+	{
+		structBytes += sizeof(position) + (all[i].spots.size() + all[i].boundaryEnd.size() + all[i].regionEnd.size())*sizeof(int);
+		codes += all[i].spots.size();
+		packed.push_back( all[i] );
+		packed.get( i, back );
+		if( back.spots != all[i].spots || back.boundaryEnd != all[i].boundaryEnd || back.regionEnd != all[i].regionEnd || back.labels != all[i].labels )
+			wrong++;
+	}
+	printf( "%lu positions, %.1f spots each : %lu bytes as structs (without heap overhead), %lu packed (%.1f a position), %lu round trips wrong\n",
+		(unsigned long)all.size(), (double)codes/all.size(), (unsigned long)structBytes, (unsigned long)(packed.memory() - packed.size()*sizeof(size_t)),
+		(double)(packed.memory() - packed.size()*sizeof(size_t))/all.size(), (unsigned long)wrong );
+
+	const int repeats = 20;
+	Uint64 hashes = 0;
+	std::vector<Uint8> bytes;
+	Uint32 start = SDL_GetTicks();
+	for( int r = 0; r < repeats; r++ )
+		for( unsigned i = 0; i < all.size(); i++ )
+		{
+			bytes.clear();
+			packPosition( all[i], bytes );
+		}
+	Uint32 packTime = SDL_GetTicks() - start;
+	start = SDL_GetTicks();
+	for( int r = 0; r < repeats; r++ )
+		for( unsigned i = 0; i < all.size(); i++ )
+			packed.get( i, back );
+	Uint32 unpackTime = SDL_GetTicks() - start;
+	start = SDL_GetTicks();
+	for( int r = 0; r < repeats; r++ )
+		for( unsigned i = 0; i < all.size(); i++ )
+			hashes += packedHash( packed.data(i), packed.length(i) );
+	Uint32 packedHashTime = SDL_GetTicks() - start;
+	start = SDL_GetTicks();
+	for( int r = 0; r < repeats; r++ )
+		for( unsigned i = 0; i < all.size(); i++ )
+			hashes += positionHash( all[i] );
+	Uint32 hashTime = SDL_GetTicks() - start;
+	double total = (double)repeats*all.size()/1000;
+	printf( "million per second : pack %.2f, unpack %.2f, packedHash %.2f, positionHash %.2f (%08X)\n", packTime ? total/packTime : 0,
+		unpackTime ? total/unpackTime : 0, packedHashTime ? total/packedHashTime : 0, hashTime ? total/hashTime : 0, (Uint32)hashes );
+}
+/* The regression suite : the starts of 1 to 6 spots in normal play and 1 to 5 in misère solved from scratch, then the
+ * 5 spot misère start on 1, 2, 4 ... threads - time, positions, table hits and heap for each, as JSON on stdout */
+void benchSuite(int threads)
+{
+	const int mostSpots[2] = { 6, 5 };		// by rules
+	const char *rulesNames[2] = { "normal", "misere" };
+	printf( "{\n  \"benchmark\": \"suite\",\n  \"compiler\": \"%s\",\n  \"built\": \"%s %s\",\n  \"solves\": [", __VERSION__, __DATE__, __TIME__ );
+	bool first = true;
+	for( int r = normalPlay; r <= misere; r++ )
+		for( int n = 1; n <= mostSpots[r]; n++ )
+		{
+			std::string text;
+			position p;
+			for( int i = 0; i < n; i++ )
+				text += "0.";
+			text += "}!";
+			readPosition( text.c_str(), p );
+			heapPeak = heapBytes;
+			size_t before = heapBytes;
+			Solver solver;
+			solver.rules = (sproutsRules)r;
+			bool win = solver.solve( p );
+			Uint32 time = SDL_GetTicks() - solver.started;
+			Uint64 probes = solver.nodes + solver.hits;
+			printf( "%s\n    { \"spots\": %d, \"rules\": \"%s\", \"result\": \"%s\", \"timeMs\": %u, \"nodes\": %lu, \"hits\": %lu, \"hitRate\": %.4f, \"nodesPerSecond\": %.0f, \"peakHeapBytes\": %lu }",
+				first ? "" : ",", n, rulesNames[r], win ? "win" : "loss", time, (unsigned long)solver.nodes, (unsigned long)solver.hits,
+				probes ? (double)solver.hits/probes : 0, time ? 1000.0*solver.nodes/time : 0, (unsigned long)(heapPeak - before) );
+			fflush( stdout );
+			first = false;
+		}
+	printf( "\n  ],\n  \"scaling\": [" );
+	position p;
+	readPosition( "0.0.0.0.0.}!", p );
+	double base = 0;
+	for( int t = 1; t <= threads; t *= 2 )
+	{
+		heapPeak = heapBytes;
+		size_t before = heapBytes;
+		ParallelSolver solver;
+		solver.rules = misere;
+		Uint32 start = SDL_GetTicks();
+		bool win = solver.solve( p, t );
+		Uint32 time = SDL_GetTicks() - start;
+		if( t == 1 )
+			base = time;
+		printf( "%s\n    { \"threads\": %d, \"spots\": 5, \"rules\": \"misere\", \"result\": \"%s\", \"timeMs\": %u, \"nodes\": %lu, \"speedup\": %.2f, \"peakHeapBytes\": %lu }",
+			t == 1 ? "" : ",", t, win ? "win" : "loss", time, (unsigned long)solver.nodes, time ? base/time : 0, (unsigned long)(heapPeak - before) );
+		fflush( stdout );
+	}
+	printf( "\n  ]\n}\n" );
+}
+
+int main( int argc, char* argv[] )
+{
+	const char *mode = argc > 1 ? argv[1] : "sweep";
+	int threads = argc > 2 ? atoi(argv[2]) : 4;
+	if( threads < 1 )
+		threads = 1;
+
+	if( !strcmp( mode, "sweep" ) )
+		benchSweep( threads );
+	else if( !strcmp( mode, "faces" ) )
+		benchFaces();
+	else if( !strcmp( mode, "region" ) )
+		benchRegion();
+	else if( !strcmp( mode, "route" ) )
+		benchRoute();
+	else if( !strcmp( mode, "mesh" ) )
+		benchMesh();
+	else if( !strcmp( mode, "position" ) )
+		benchPosition();
+	else if( !strcmp( mode, "canonical" ) )
+		benchCanonical();
+	else if( !strcmp( mode, "solve" ) )
+		benchSolve();
+	else if( !strcmp( mode, "parallel" ) )
+		benchParallel( threads );
+	else if( !strcmp( mode, "nimber" ) )
+		benchNimber();
+	else if( !strcmp( mode, "database" ) )
+		benchDatabase();
+	else if( !strcmp( mode, "perft" ) )
+		benchPerft();
+	else if( !strcmp( mode, "mcts" ) )
+		benchMonteCarlo( threads );
+	else if( !strcmp( mode, "misere" ) )
+		benchMisere( threads );
+	else if( !strcmp( mode, "packed" ) )
+		benchPacked();
+	else if( !strcmp( mode, "suite" ) )
+		benchSuite( threads );
+	else
+	{
+		fprintf( stderr, "unknown benchmark : %s\n", mode );
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -1,9 +1,18 @@
 #include <algorithm>
 #include <ctime>
+#include <map>
 #include <vector>
 #include <cmath>
 #include "xorRNG.h"
 #include "draw.h"
+#include "geometry.h"
+#include "sweep.h"
+#include "faces.h"
+#include "router.h"
+#include "boxgrid.h"
+#include "position.h"
+#include "moves.h"
+#include "canonical.h"
 
 
 class Bezier
@@ -17,6 +26,8 @@ class Bezier
 		static const int curvePoints = 40;
 		static const int radiusGlobal = 15;
 		static const int radiusRadius = 225;
+		static const int spotLives = 3;			// lines that may end at one spot
+		static const int spotTolerance = 4;		// pixels a new spot may be from its line
 		/* End constants */
 		
 		struct pointsLines					// for associating an active line, point pair and its distance from some other point
@@ -31,23 +42,62 @@ class Bezier
 		std::vector<bLine> allLines;
 		int activeLine;
 		
+		struct bSpot
+		{ int *x, *y; };
+		std::vector<bSpot> startSpots;		// the spots the game started from : isolated until a line ends at one (its ends share these ints)
+
+		PlanarMap planarMap;				// faces of the board, kept up to date move by move (curve i is allLines[i])
+		std::map<int*, int> spotIds;		// spot index in planarMap for each endpoint int
+		bool mapValid;						// false after an edit the map cannot follow (dragging points, random lines) : rebuilt on the next query
+		Triangulation mesh;					// free space between the lines, also kept up to date move by move
+		bool meshValid;						// like mapValid, for mesh
+		std::set<int*> bends;				// endpoint ints where a routed line goes from one cubic to the next : joints, not spots
+		BoxGrid lineGrid;					// boxes of lines [0, indexed) for crosses()
+		unsigned indexed;
+		bool gridValid;						// false after a line moved : the grid is refilled on the next test
+		bool hinted;						// a suggested move is drawn by drawLines, with a ring on its spots
+		std::vector<cubic> hintChain;		// its line, as playMove would place it
+		Uint32 hintColor;
+		
 		SDL_Surface *surface;				// screen to draw onto
 		SDL_Surface *picking;	// may be used for selecting nodes at some point (if checking all distances becomes too slow) : NOT USED CURRENTLY
 		
 		/* Private functions */
 		double dist(int,int,int,int);		// return distance between (x,y) and (x1,y1)
 		double distLine(int,int,int,int);	// return distance between (x,y) and (lineIndex,pointIndex)
+		static cubic toCubic(const bLine&);	// floating point copy of a line for the geometric tests
+		void mapLine(int);					// add a new line to planarMap and mesh (or mark them stale if the line crosses something)
+		bool nearSpot(int,int,int*&,int*&,int=-1);	// like select, but only spots : the x and y ints of the nearest one (not counting the line at the given index)
+		bool isSpot(int*,int=-1);			// true if an endpoint int is a spot of the board (not counting the line at the given index)
+		bool crossesOthers(int);			// true if the line at the given index crosses any other line
+		bool placeChain(int*,int*,int*,int*,const std::vector<cubic>&);	// store a routed chain between two spots (x and y ints) as lines, with its new spot half way : false if rounding made it cross something
+		void unroute(unsigned);				// take the lines from the given index on back out, with the points only they had
+		bool planMove(const sproutsMove&, std::vector<cubic>&, Uint64&);	// a chain for a move of getPosition's position that reaches its child, and the child's canonical hash
+		void markBends(std::vector<bool>&);	// map spots that are bends of routed lines, not spots of the game
+		void drawingEvent(const SDL_Event&);	// one event for each interaction state (see handleEvent)
+		void placingEvent(const SDL_Event&);
+		void choosingEvent(const SDL_Event&);
+		void splittingEvent(const SDL_Event&);
+		void routingEvent(const SDL_Event&);
+		void dropLine();					// give up the line being drawn
 		
 	public:
+		enum moveError { moveLegal, moveNoLives, moveCrosses, moveCrossesItself, moveSpotOffLine, moveEndOffSpot };
+
 		/* Public variables */
 		bool active;					// true if moving a point
 		
 		/* Constructors */
-		Bezier(SDL_Surface*);			// default constructor
+		Bezier(SDL_Surface*, Uint32=0, int=0);	// draw on the surface, random lines seeded with the number given (0 : the time) - or, given a number of spots, start a game from that many
 		
 		/* Curve generation */
-		void addLine(bool=false);		// make new line with user input, or random point positions if bool is true
+		void addLine(bool=false);		// start a new line drawn by the user (see handleEvent), or make one at random points at once if bool is true
+		void addLine(int,int);			// start a new line drawn by the user from (x,y)
 		
+		/* Interaction */
+		bool handleEvent(const SDL_Event&);	// feed an event to the interaction under way : false if there is none (or the event is not for it)
+		bool busy() const { return input != inputIdle; }
+
 		/* Curve selection */
 		void highlightNear(int,int);	// highlights a node if input near enough to select it
 		bool select(int,int,bool);		// accepts x,y : if close to a point, set that point active
@@ -57,34 +107,77 @@ class Bezier
 		void move(int,int);				// move active point to (x,y)
 		bool connect(int,int);			// connects the point at (x,y) to an existing point (if near enough)
 		bool disconnect(int,int);		// disconnect points near (x,y) (if near enough - looks for near node)
-		bool splitLine(void);			// accepts input (endpoint,endpoint) and spot on curve to split it into two
-		void splitLine(bLine,int,int);
+		void splitLine(void);			// start splitting a line : the user picks it by a point, then a spot on it
+		void splitLine(int,int,int);	// split the line at the given index at approximately (x,y)
+		void routeLine(void);			// start routing a line : the user picks two spots
+		bool route(int,int,int,int,int=-1);	// route a line from the spot nearest (x,y) to the spot nearest (x1,y1) (in the given face of planarMap only, if not -1), false if there is no room
+		bool playMove(const sproutsMove&);	// route a move of getPosition's position (the board as it is), reaching the child it was chosen for - false if there is no room
+		bool showHint(const sproutsMove&, Uint32);	// mark a move of getPosition's position by its line in the given colour (RGBA) from the next drawLines on - false if there is no room for it
+		void clearHint() { hinted = false; }
+
+		/* Curve tests */
+		bool crosses(int);				// true if the line at the given index crosses itself or any other line (meeting at a shared spot is not a crossing)
+		int lives(int*, int=-1);		// lines that may still end at a spot (ignoring the line at the given index), 0 at a bend
+		moveError checkLine(int);		// a line being drawn : lives left at both ends, no crossings, both ends on spots already there
+		moveError checkMove(int,int,int);	// a whole move : checkLine, and the new spot at (x,y) lies on the line
+		static const char *moveMessage(moveError);
+		int auditCrossings(std::vector< std::pair<int,int> >&, int=1);	// fill with every pair of crossing lines (i,i for a line crossing itself), sweeping on the given number of threads
+
+		/* Board export */
+		void getBoard(board&);			// copy the lines out as spots and curves (endpoints joined by a shared point are one spot)
+		const PlanarMap &faces();		// faces of the board : which face a spot is in, the boundaries of a face
+		void getPosition(position&, positionSource* =NULL);	// the board as a Sprouts position (see position.h), for solvers and databases - and where its spots and regions are
+		Triangulation &triangulation();	// free space of the board : point location, shortest paths that cross no line
 
 		/* Curve visualization */
 		void drawLines(Uint32=0xFFFFFFFF,bool=true);	// blank surface, then draw all lines in the structure - default color is white, pass false to not lock/unlock/flip surface
 		void drawLine(bLine);			// blank surface, then draw only given line
+
+	private:
+		/* Interaction state (see handleEvent) - after the public types it uses */
+		enum inputState					// what the clicks and keys are for while an interaction is under way
+		{
+			inputIdle,					// nothing : the main loop has them
+			inputDrawing,				// addLine : the new line's four points
+			inputPlacing,				// addLine : its new spot, on the finished line
+			inputChoosing,				// splitLine : the line to split
+			inputSplitting,				// splitLine : where on it
+			inputRouting				// routeLine : the two spots
+		};
+		inputState input;
+		int inputLine;						// the line being drawn, or split
+		moveError drawError, drawShown;		// while drawing : what the line breaks, and what the caption says
+		int routeChosen, routeX, routeY;	// while routing : spots clicked, and the first one
 };
-Bezier::Bezier(SDL_Surface *sf)
+Bezier::Bezier(SDL_Surface *sf, Uint32 seed, int spots)
 {
-	srand( time(NULL) );
+	srand( seed ? seed : time(NULL) );
 
 	/* Set drawing surface */
 	surface = sf;
 	// picking = SDL_ConvertSurface(sf, sf->format, sf->flags);	// TODO: look into using a picking layer to select nodes/find close nodes/entc - NOW: copy current video surface
 	// SDL_FillRect( picking, NULL, 0 );							// blank picking surface
 
-	/* Generate a new curve */
-	addLine(true);
+	/* Generate a new curve, or the game's spots : on a circle around the middle (just the middle for one) */
+	input = inputIdle;
+	if( spots <= 0 )
+		addLine(true);
+	for( int i = 0; i < spots; i++ )
+	{
+		double angle = 6.283185307179586*i/spots, radius = spots > 1 ? std::min( surface->w, surface->h )/3.0 : 0;		// 2 pi / spots apart
+		bSpot s = { new int( surface->w/2 + (int)floor( radius*cos( angle ) + 0.5 ) ), new int( surface->h/2 + (int)floor( radius*sin( angle ) + 0.5 ) ) };
+		startSpots.push_back( s );
+	}
 	
 	active = false;		// not moving a point initially
+	mapValid = meshValid = gridValid = false;
+	indexed = 0;
+	hinted = false;
 }
 void Bezier::addLine(bool rnd)
 {
-	bool run = true;
-	int xMouse, yMouse, pointBackup;
 	bLine tmpBezier;
-	SDL_Event event;
-	SDL_PollEvent(&event);
+	int xMouse, yMouse;
 	if( rnd )	// TODO: Make this part flow better so it isn't completely separate from the following section 
 	{
 		for( int i = 0; i < 4; i++ )
@@ -95,79 +188,184 @@ void Bezier::addLine(bool rnd)
 			*tmpBezier.yPoints[i] = random(surface->h); // 
 		}
 		allLines.push_back(tmpBezier);
+		mapValid = meshValid = gridValid = false;	// a random line may cross anything
 	}
 	else
 	{
-		for( int i = 0; i < 4; i++ )
-		{
-			tmpBezier.xPoints[i] = new int;
-			tmpBezier.yPoints[i] = new int;
-			*tmpBezier.xPoints[i] = event.button.x;		// initialize all points to current mouse location
-			*tmpBezier.yPoints[i] = event.button.y;
-		}
-		tmpBezier.activePoint = 0;
-		activeLine = allLines.size();
-		allLines.push_back(tmpBezier);
-
-		// Note to self: I have replaced allLines[activeLine] with allLines.back() since the new curve is pushed to the back of allLines - is this replacement more efficient
-		while( allLines.back().activePoint < 4 && run )
-		{
-			while( SDL_PollEvent(&event) )
+		SDL_GetMouseState( &xMouse, &yMouse );
+		addLine( xMouse, yMouse );
+	}
+}
+void Bezier::addLine(int x, int y)
+{
+	bLine tmpBezier;
+	if( input != inputIdle )
+		return;
+	for( int i = 0; i < 4; i++ )
+	{
+		tmpBezier.xPoints[i] = new int;
+		tmpBezier.yPoints[i] = new int;
+		*tmpBezier.xPoints[i] = x;		// initialize all points to the mouse location
+		*tmpBezier.yPoints[i] = y;
+	}
+	tmpBezier.activePoint = 0;
+	activeLine = inputLine = allLines.size();
+	allLines.push_back(tmpBezier);
+	drawError = drawShown = moveLegal;
+	input = inputDrawing;
+}
+/* The interactions (drawing a move, splitting a line, routing one) are states : each event is handed to the one under
+ * way and it returns at once, so the main loop - and the analysis, and the drawing - carry on between clicks.
+ * Leaving the window ends an interaction as giving it up would, and the quit still reaches the main loop */
+bool Bezier::handleEvent(const SDL_Event &event)
+{
+	if( input == inputIdle || event.type == SDL_USEREVENT )
+		return false;
+	bool left = event.type == SDL_ACTIVEEVENT && !event.active.gain && (event.active.state & SDL_APPMOUSEFOCUS);	// the mouse went out of the window
+	if( event.type == SDL_QUIT || left )
+	{
+		if( input == inputDrawing || input == inputPlacing )
+			dropLine();
+		input = inputIdle;
+		SDL_WM_SetCaption( moveMessage( moveLegal ), NULL );
+		drawLines();
+		return left;
+	}
+	switch( input )
+	{
+		case inputDrawing:		drawingEvent( event );		break;
+		case inputPlacing:		placingEvent( event );		break;
+		case inputChoosing:		choosingEvent( event );		break;
+		case inputSplitting:	splittingEvent( event );	break;
+		case inputRouting:		routingEvent( event );		break;
+		default:				break;
+	}
+	return true;
+}
+void Bezier::dropLine()
+{
+	if( input == inputPlacing )		// drawn in full, so already in the map : rebuild without it (a line still being drawn never went in)
+		mapValid = meshValid = false;
+	allLines.pop_back();
+	input = inputIdle;
+	drawLines();
+}
+/* Clicks place the new line's points one by one, and it follows the mouse meanwhile : its ends go on the spots clicked
+ * near (a click far from any spot is refused), its control points where they are clicked */
+void Bezier::drawingEvent(const SDL_Event &event)
+{
+	int xMouse, yMouse, *spotX, *spotY;
+	SDL_Event later;
+	switch( event.type )
+	{
+		case SDL_KEYUP:				// keyboard released
+			if( event.key.keysym.sym == SDLK_ESCAPE )
+				dropLine();
+			return;
+		case SDL_MOUSEBUTTONDOWN:	// mouse pressed
+			if( event.button.button == SDL_BUTTON_RIGHT )
 			{
-				switch( event.type )
+				dropLine();
+				return;
+			}
+			if( event.button.button != SDL_BUTTON_LEFT )
+				return;
+			xMouse = event.button.x;	// get mouse click location
+			yMouse = event.button.y;	//
+			if( allLines.back().activePoint % 3 == 0 )		// an end : snapped to the spot clicked near, and there must be one
+			{
+				if( !nearSpot( xMouse, yMouse, spotX, spotY, inputLine ) )
 				{
-					case SDL_KEYUP:				// keyboard released
-						if( event.key.keysym.sym == SDLK_ESCAPE )
-							run = false;
-						break;
-					case SDL_MOUSEBUTTONDOWN:	// mouse pressed
-						if( event.button.button == SDL_BUTTON_LEFT )
-						{
-							xMouse = event.button.x;	// get mouse click location
-							yMouse = event.button.y;	//
-
-							pointBackup = allLines.back().activePoint;		// backup active point in case select() changes it
-							if( select(xMouse,yMouse,true) )		// clicked near another node : snap to that node	(WARNING! This function will change activeLine and activePoint if it returns true)
-							{
-								allLines.back().xPoints[allLines.back().activePoint] = allLines[activeLine].xPoints[allLines[activeLine].activePoint];
-								allLines.back().yPoints[allLines.back().activePoint] = allLines[activeLine].yPoints[allLines[activeLine].activePoint];
-								activeLine = allLines.size() - 1;
-								allLines.back().activePoint = pointBackup;
-							}
-							else
-							{
-								*allLines.back().xPoints[allLines.back().activePoint] = xMouse;
-								*allLines.back().yPoints[allLines.back().activePoint] = yMouse;
-							}
-							drawLines();
-							allLines.back().activePoint++;
-						}
-						else if( event.button.button == SDL_BUTTON_RIGHT )
-						{
-							run = false;
-						}
-						break;
-					case SDL_MOUSEMOTION:		// mouse moved
-						xMouse = event.button.x;	// get mouse click location
-						yMouse = event.button.y;	//
-						*allLines.back().xPoints[allLines.back().activePoint] = xMouse;
-						*allLines.back().yPoints[allLines.back().activePoint] = yMouse;
-						drawLines();
-						break;
-					case SDL_QUIT:				// top-right X clicked
-						run = false;
-						break;
-					default:
-						break;
+					SDL_WM_SetCaption( moveMessage( moveEndOffSpot ), NULL );
+					drawShown = moveEndOffSpot;
+					return;
 				}
+				delete allLines.back().xPoints[allLines.back().activePoint];
+				delete allLines.back().yPoints[allLines.back().activePoint];
+				allLines.back().xPoints[allLines.back().activePoint] = spotX;
+				allLines.back().yPoints[allLines.back().activePoint] = spotY;
 			}
-		}
-		if( !run )		// broke out unsuccessfully
-		{
-			allLines.pop_back();
+			else		// a control point : where it was clicked
+			{
+				*allLines.back().xPoints[allLines.back().activePoint] = xMouse;
+				*allLines.back().yPoints[allLines.back().activePoint] = yMouse;
+			}
+			drawLines();
+			if( ++allLines.back().activePoint < 4 )
+				return;
+			if( (drawError = checkLine( inputLine )) != moveLegal )		// finished, but not a legal line
+			{
+				SDL_WM_SetCaption( moveMessage( drawError ), NULL );
+				dropLine();
+				return;
+			}
+			mapLine( inputLine );		// one new curve : update the faces it was drawn in - a move is a line and a new spot on it
+			SDL_WM_SetCaption( "Click on the new line to place its spot", NULL );
 			drawLines();
+			input = inputPlacing;
+			return;
+		case SDL_MOUSEMOTION:		// mouse moved
+			*allLines.back().xPoints[allLines.back().activePoint] = event.motion.x;
+			*allLines.back().yPoints[allLines.back().activePoint] = event.motion.y;
+			if( SDL_PeepEvents( &later, 1, SDL_PEEKEVENT, SDL_MOUSEMOTIONMASK ) > 0 )	// a newer position is queued already : check and draw that one instead
+				return;
+			drawError = checkLine( inputLine );
+			if( drawError == moveEndOffSpot )		// the end is put on a spot when it is clicked
+				drawError = moveLegal;
+			drawLines( drawError == moveLegal ? 0xFFFFFFFF : 0xFF4040FF );	// draw the board red while the new line breaks a rule
+			if( drawError != drawShown )
+			{
+				SDL_WM_SetCaption( moveMessage( drawError ), NULL );
+				drawShown = drawError;
+			}
+			return;
+		default:
+			return;
+	}
+}
+/* A click on the line just drawn splits it there - escape or the right button gives up the whole move */
+void Bezier::placingEvent(const SDL_Event &event)
+{
+	if( event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT )
+	{
+		moveError error = checkMove( inputLine, event.button.x, event.button.y );
+		SDL_WM_SetCaption( moveMessage( error ), NULL );
+		if( error != moveLegal )
+			return;
+		splitLine( inputLine, event.button.x, event.button.y );
+		input = inputIdle;
+		drawLines();
+	}
+	else if( (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_RIGHT) || (event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_ESCAPE) )
+	{
+		SDL_WM_SetCaption( moveMessage( moveLegal ), NULL );
+		dropLine();
+	}
+}
+void Bezier::mapLine(int lineIndex)
+{
+	if( !mapValid && !meshValid )
+		return;
+	if( crosses( lineIndex ) )
+	{
+		mapValid = meshValid = gridValid = false;
+		return;
+	}
+	if( mapValid )
+	{
+		int ends[2];
+		for( int i = 0; i < 2; i++ )
+		{
+			int *p = allLines[lineIndex].xPoints[3*i];
+			if( spotIds.find(p) == spotIds.end() )		// not snapped to a spot : it is a new one
+				spotIds[p] = planarMap.addSpot( *p, *allLines[lineIndex].yPoints[3*i] );
+			ends[i] = spotIds[p];
 		}
+		if( planarMap.addCurve( toCubic( allLines[lineIndex] ), ends[0], ends[1] ) < 0 )
+			mapValid = false;
 	}
+	if( meshValid && !mesh.insertCurve( toCubic( allLines[lineIndex] ) ) )
+		meshValid = false;
 }
 void Bezier::highlightNear(int x, int y)
 {
@@ -286,6 +484,7 @@ void Bezier::move(int x, int y)
 	{
 		*allLines[activeLine].xPoints[allLines[activeLine].activePoint] = x;
 		*allLines[activeLine].yPoints[allLines[activeLine].activePoint] = y;
+		mapValid = meshValid = gridValid = false;
 	}
 }
 /* Caution: use this only when a point is active, or it will do no good */
@@ -297,8 +496,26 @@ bool Bezier::connect(int x, int y)
 	int oldLine  = activeLine;
 	if( select( x, y, oldLine, oldPoint ) )		// found a point near the current one (excluding active point)
 	{
-		allLines[oldLine].xPoints[oldPoint] = allLines[activeLine].xPoints[allLines[activeLine].activePoint];
+		int *movingX = allLines[oldLine].xPoints[oldPoint], *movingY = allLines[oldLine].yPoints[oldPoint];
+		int *targetX = allLines[activeLine].xPoints[allLines[activeLine].activePoint];
+		bool ends = (oldPoint == 0 || oldPoint == 3) && (allLines[activeLine].activePoint == 0 || allLines[activeLine].activePoint == 3);
+		if( ends && movingX != targetX && (spotLives - lives( movingX )) + (spotLives - lives( targetX )) > spotLives )	// joining two spots : the lines at both must fit on one
+		{
+			activeLine = oldLine;
+			allLines[activeLine].activePoint = oldPoint;
+			return false;
+		}
+		allLines[oldLine].xPoints[oldPoint] = targetX;
 		allLines[oldLine].yPoints[oldPoint] = allLines[activeLine].yPoints[allLines[activeLine].activePoint];
+		mapValid = meshValid = gridValid = false;
+		if( crosses( oldLine ) )		// snapping bent the line across another : leave it where it was
+		{
+			allLines[oldLine].xPoints[oldPoint] = movingX;
+			allLines[oldLine].yPoints[oldPoint] = movingY;
+			activeLine = oldLine;
+			allLines[activeLine].activePoint = oldPoint;
+			return false;
+		}
 		return true;
 	}
 	else
@@ -322,6 +539,7 @@ bool Bezier::disconnect(int x, int y)
 
 			activeLine = oldLine;		// reset closest point to be active again
 			allLines[activeLine].activePoint = oldPoint;
+			mapValid = meshValid = gridValid = false;
 			return true;
 		}
 		else
@@ -330,97 +548,61 @@ bool Bezier::disconnect(int x, int y)
 	else
 		return false;	// no points found near (x,y)
 }
-bool Bezier::splitLine(void)
+void Bezier::splitLine(void)
 {
-	int selectedPoints = 0, firstLine, firstPoint, secondLine, secondPoint;
-	int oldPoint, oldLine, xMouse, yMouse, searchBounds = 3;
-	bool run = true, selected = false;
-	bLine bl;
-	SDL_Event event;
-	while( run )
+	if( input == inputIdle )
+		input = inputChoosing;
+}
+/* The line to split is picked by one of its points */
+void Bezier::choosingEvent(const SDL_Event &event)
+{
+	if( (event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_ESCAPE) || (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_RIGHT) )
 	{
-		while( SDL_PollEvent(&event) )		// get events
-		{
-			switch( event.type )
-			{
-				case SDL_KEYUP:				// keyboard released
-					if( event.key.keysym.sym == SDLK_ESCAPE )
-						return false;	// break out of splitting - this should reinstate the chosen line (to be done later)
-				case SDL_MOUSEBUTTONDOWN:	// mouse pressed
-					if( event.button.button == SDL_BUTTON_LEFT )
-					{
-						xMouse = event.button.x;	// get mouse click location
-						yMouse = event.button.y;	//
-
-						// the select function needs some help - if two lines are connected to a single node, it will just select an arbitrary line (which one should it choose?) - maybe click on node, then click on line from node
-						if( select(xMouse,yMouse,false) )		// clicked near another node : snap to that node	(WARNING! This function will change activeLine and activePoint if it returns true)
-						{
-							selected = true;
-							bl = allLines[activeLine];	// copy chosen line to a temporary one
-							drawLines( SDL_MapRGBA(surface->format, 100,100,100,100) );
-							drawLine( bl );
-							allLines.erase(allLines.begin() + activeLine);	// remove line to be split (it is now in bl)
-							run = false;
-						}
-						break;
-					}
-					else if( event.button.button == SDL_BUTTON_RIGHT )
-						return false;
-				// case SDL_MOUSEMOTION:
-					// if( select( event.motion.x, event.motion.y, false ) )
-						// fill in here with code to highlight a near node
-					// break;
-				case SDL_QUIT:		// top-right X clicked
-					return false;
-				default:
-					break;
-			}
-		}
+		input = inputIdle;		// break out of splitting
+		drawLines();
+	}
+	// the select function needs some help - if two lines are connected to a single node, it will just select an arbitrary line (which one should it choose?) - maybe click on node, then click on line from node
+	else if( event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT && select( event.button.x, event.button.y, false ) )	// clicked near a node : its line	(WARNING! This function will change activeLine and activePoint if it returns true)
+	{
+		inputLine = activeLine;		// the line stays where it is (its index is its curve in planarMap) - it is just drawn over the greyed board
+		drawLines( SDL_MapRGBA(surface->format, 100,100,100,100) );
+		drawLine( allLines[inputLine] );
+		input = inputSplitting;
 	}
-	/* Click code - click near a line to select a spot on the line */
-	// now the active line is in bl
-	while( true )
+}
+/* Click code - click near a line to select a spot on the line */
+void Bezier::splittingEvent(const SDL_Event &event)
+{
+	const int searchBounds = 3;
+	if( event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT )
 	{
-		while( SDL_PollEvent(&event) )
+		for( int i = -searchBounds; i <= searchBounds; i++ )
 		{
-			switch( event.type )
+			for( int j = -searchBounds; j <= searchBounds; j++ )
 			{
-				case SDL_MOUSEBUTTONDOWN:
-					if( event.button.button == SDL_BUTTON_LEFT )
-					{
-						for( int i = -searchBounds; i <= searchBounds; i++ )
-						{
-							for( int j = -searchBounds; j <= searchBounds; j++ )
-							{
-								if( (i-j)*(i-j) > searchBounds*searchBounds )	// exclude edges of i X j square not in a circle (huh?)
-									continue;
-								if( getpixel( surface, event.button.x + i, event.button.y + j ) == SDL_MapRGBA(surface->format, 255,255,255,255) )	// found white pixel (curve point probably)
-								{
-									splitLine( bl, event.button.x + i, event.button.y + j );
-									drawLines();
-									return true;
-								}
-					}	}	}		// what about this notation for ending a set of brackets? heh heh...
-					break;
-				case SDL_MOUSEBUTTONUP:
-				case SDL_KEYUP:
-					if( event.button.button == SDL_BUTTON_RIGHT || event.key.keysym.sym == SDLK_ESCAPE )
-					{
-						allLines.push_back( bl );
-						return false;
-					}
-					break;
-				case SDL_QUIT:
-					return false;
-			}
-		}
+				if( (i-j)*(i-j) > searchBounds*searchBounds )	// exclude edges of i X j square not in a circle (huh?)
+					continue;
+				if( getpixel( surface, event.button.x + i, event.button.y + j ) == SDL_MapRGBA(surface->format, 255,255,255,255) )	// found white pixel (curve point probably)
+				{
+					splitLine( inputLine, event.button.x + i, event.button.y + j );
+					input = inputIdle;
+					drawLines();
+					return;
+				}
+		}	}		// what about this notation for ending a set of brackets? heh heh...
+	}
+	else if( (event.type == SDL_MOUSEBUTTONUP && event.button.button == SDL_BUTTON_RIGHT) || (event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_ESCAPE) )
+	{
+		input = inputIdle;
+		drawLines();
 	}
 }
-/* This function splits a curve at approximately (x,y) */
-void Bezier::splitLine( bLine bl, int x, int y )
+/* This function splits a curve at approximately (x,y) : the first half replaces it, the second half is added at the back */
+void Bezier::splitLine( int lineIndex, int x, int y )
 {
 	int xNew, yNew;
-	double smallestDistance = dist( x,y, *bl.xPoints[0],*bl.yPoints[0] ), smallestT;
+	bLine bl = allLines[lineIndex];
+	double smallestDistance = dist( x,y, *bl.xPoints[0],*bl.yPoints[0] ), smallestT = 0;
 	double step = 1.0/curvePoints;
 	bLine first, second;
 	for( int i = 0; i < 4; i++ )
@@ -430,6 +612,9 @@ void Bezier::splitLine( bLine bl, int x, int y )
 		second.xPoints[i] = new int;
 		second.yPoints[i] = new int;
 	}
+	delete first.xPoints[0];	delete first.yPoints[0];		// the halves keep the original endpoints, so they stay joined to whatever shares them
+	delete second.xPoints[3];	delete second.yPoints[3];
+	first.xPoints[0] = bl.xPoints[0];	first.yPoints[0] = bl.yPoints[0];
 	first.activePoint = second.activePoint = 0;
 	// find t value at which distance to target is minimum
 	for( double t = 0; t <= 1; t += step )
@@ -444,11 +629,9 @@ void Bezier::splitLine( bLine bl, int x, int y )
 		}
 	}
 	// now split the curve
-	 *first.xPoints[0] = *bl.xPoints[0];
 	 *first.xPoints[1] = (1-smallestT)* *bl.xPoints[0]+smallestT* *bl.xPoints[1];
 	 *first.xPoints[2] = (1-smallestT)*((1-smallestT)* *bl.xPoints[0]+smallestT* *bl.xPoints[1])+smallestT*((1-smallestT)* *bl.xPoints[1]+smallestT* *bl.xPoints[2]);
 	 *first.xPoints[3] = (1-smallestT)*((1-smallestT)*((1-smallestT)* *bl.xPoints[0]+smallestT* *bl.xPoints[1])+smallestT*((1-smallestT)* *bl.xPoints[1]+smallestT* *bl.xPoints[2]))+smallestT*((1-smallestT)*((1-smallestT)* *bl.xPoints[1]+smallestT* *bl.xPoints[2])+smallestT*((1-smallestT)* *bl.xPoints[2]+smallestT* *bl.xPoints[3]));
-	 *first.yPoints[0] = *bl.yPoints[0];
 	 *first.yPoints[1] = (1-smallestT)* *bl.yPoints[0]+smallestT* *bl.yPoints[1];
 	 *first.yPoints[2] = (1-smallestT)*((1-smallestT)* *bl.yPoints[0]+smallestT* *bl.yPoints[1])+smallestT*((1-smallestT)* *bl.yPoints[1]+smallestT* *bl.yPoints[2]);
 	 *first.yPoints[3] = (1-smallestT)*((1-smallestT)*((1-smallestT)* *bl.yPoints[0]+smallestT* *bl.yPoints[1])+smallestT*((1-smallestT)* *bl.yPoints[1]+smallestT* *bl.yPoints[2]))+smallestT*((1-smallestT)*((1-smallestT)* *bl.yPoints[1]+smallestT* *bl.yPoints[2])+smallestT*((1-smallestT)* *bl.yPoints[2]+smallestT* *bl.yPoints[3]));
@@ -458,12 +641,475 @@ void Bezier::splitLine( bLine bl, int x, int y )
 
 	*second.xPoints[1] = (1-smallestT)*((1-smallestT)* *bl.xPoints[1]+smallestT* *bl.xPoints[2])+smallestT*((1-smallestT)* *bl.xPoints[2]+smallestT* *bl.xPoints[3]);
 	*second.xPoints[2] = (1-smallestT)* *bl.xPoints[2]+smallestT* *bl.xPoints[3];
-	*second.xPoints[3] = *bl.xPoints[3];
+	 second.xPoints[3] = bl.xPoints[3];
 	*second.yPoints[1] = (1-smallestT)*((1-smallestT)* *bl.yPoints[1]+smallestT* *bl.yPoints[2])+smallestT*((1-smallestT)* *bl.yPoints[2]+smallestT* *bl.yPoints[3]);
 	*second.yPoints[2] = (1-smallestT)* *bl.yPoints[2]+smallestT* *bl.yPoints[3];
-	*second.yPoints[3] = *bl.yPoints[3];
-	allLines.push_back( first );
+	 second.yPoints[3] = bl.yPoints[3];
+	allLines[lineIndex] = first;
 	allLines.push_back( second );
+	if( mapValid )		// the new spot just splits one curve in two : no face changes
+		spotIds[ first.xPoints[3] ] = planarMap.splitCurve( lineIndex, toCubic(first), toCubic(second) );
+	if( meshValid )		// the halves follow the old line to within rounding : keep its segments and put the spot on them
+		mesh.insertPoint( *first.xPoints[3], *first.yPoints[3], 1.0 );
+}
+bool Bezier::nearSpot(int x, int y, int *&spotX, int *&spotY, int skipLine)
+{
+	int d;
+	pointsLines closestLine = { -1, -1, radiusRadius };
+	for( unsigned int lineIterator = 0; lineIterator < allLines.size(); lineIterator++ )
+	{
+		if( (int)lineIterator == skipLine )
+			continue;
+		for( int i = 0; i < 4; i += 3 )		// endpoints only
+		{
+			if( bends.count( allLines[lineIterator].xPoints[i] ) )
+				continue;
+			d = (*allLines[lineIterator].xPoints[i] - x) * (*allLines[lineIterator].xPoints[i] - x) + (*allLines[lineIterator].yPoints[i] - y) * (*allLines[lineIterator].yPoints[i] - y);
+			if( d <= closestLine.dist )
+			{
+				closestLine.aLine = lineIterator;
+				closestLine.aPoint = i;
+				closestLine.dist = d;
+			}
+		}
+	}
+	spotX = spotY = NULL;
+	if( closestLine.aLine != -1 )
+	{
+		spotX = allLines[closestLine.aLine].xPoints[closestLine.aPoint];
+		spotY = allLines[closestLine.aLine].yPoints[closestLine.aPoint];
+	}
+	for( unsigned s = 0; s < startSpots.size(); s++ )		// the start spots no line ends at yet count too
+	{
+		d = (*startSpots[s].x - x) * (*startSpots[s].x - x) + (*startSpots[s].y - y) * (*startSpots[s].y - y);
+		if( d <= closestLine.dist )
+		{
+			spotX = startSpots[s].x;
+			spotY = startSpots[s].y;
+			closestLine.dist = d;
+		}
+	}
+	return spotX != NULL;
+}
+bool Bezier::isSpot(int *point, int skipLine)
+{
+	if( bends.count( point ) )
+		return false;
+	for( unsigned s = 0; s < startSpots.size(); s++ )
+		if( startSpots[s].x == point )
+			return true;
+	for( unsigned lineIterator = 0; lineIterator < allLines.size(); lineIterator++ )
+		if( (int)lineIterator != skipLine && (allLines[lineIterator].xPoints[0] == point || allLines[lineIterator].xPoints[3] == point) )
+			return true;
+	return false;
+}
+void Bezier::routeLine(void)
+{
+	if( input != inputIdle )
+		return;
+	routeChosen = 0;
+	input = inputRouting;
+	drawLines();
+}
+/* Two clicks on spots : the first is ringed, the second routes the line */
+void Bezier::routingEvent(const SDL_Event &event)
+{
+	int *spotX, *spotY;
+	if( event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT && nearSpot( event.button.x, event.button.y, spotX, spotY ) )
+	{
+		if( routeChosen == 0 )		// first spot : remember it and ring it
+		{
+			routeX = *spotX;
+			routeY = *spotY;
+			routeChosen++;
+			SDL_LockSurface( surface );
+			drawLines( 0xFFFFFFFF, false );
+			circleRGBA( surface, routeX, routeY, 7, 255,0,255,255 );
+			SDL_UnlockSurface( surface );
+			SDL_Flip( surface );
+		}
+		else
+		{
+			route( routeX, routeY, *spotX, *spotY );
+			input = inputIdle;
+			drawLines();
+		}
+	}
+	else if( (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_RIGHT) || (event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_ESCAPE) )
+	{
+		input = inputIdle;
+		drawLines();
+	}
+}
+/* The router works on planarMap : the chain it returns is stored as lines joined at new (bend) points, checked again after rounding to ints */
+bool Bezier::route(int x, int y, int x1, int y1, int face)
+{
+	int *fromX, *fromY, *toX, *toY;
+	if( !nearSpot( x, y, fromX, fromY ) || !nearSpot( x1, y1, toX, toY ) )
+		return false;
+	if( fromX == toX ? lives( fromX ) < 2 : lives( fromX ) < 1 || lives( toX ) < 1 )
+		return false;
+	box screen = { 0, 0, (double)surface->w, (double)surface->h };
+	Router router( faces(), screen, &triangulation() );
+	std::vector<cubic> chain;
+	if( !router.route( spotIds[fromX], spotIds[toX], chain, face ) )
+		return false;
+	return placeChain( fromX, fromY, toX, toY, chain );
+}
+bool Bezier::placeChain(int *fromX, int *fromY, int *toX, int *toY, const std::vector<cubic> &chain)
+{
+	unsigned first = allLines.size();
+	for( unsigned k = 0; k < chain.size(); k++ )
+	{
+		bLine bl;
+		bl.activePoint = 0;
+		bl.xPoints[0] = k == 0 ? fromX : allLines.back().xPoints[3];
+		bl.yPoints[0] = k == 0 ? fromY : allLines.back().yPoints[3];
+		for( int i = 1; i < 4; i++ )
+		{
+			if( i == 3 && k + 1 == chain.size() )
+			{
+				bl.xPoints[3] = toX;
+				bl.yPoints[3] = toY;
+				break;
+			}
+			bl.xPoints[i] = new int( (int)floor( chain[k].x[i] + 0.5 ) );
+			bl.yPoints[i] = new int( (int)floor( chain[k].y[i] + 0.5 ) );
+		}
+		if( k + 1 < chain.size() )
+			bends.insert( bl.xPoints[3] );
+		allLines.push_back( bl );
+	}
+	for( unsigned i = first; i < allLines.size(); i++ )
+	{
+		if( crosses( i ) )		// rounding moved it onto something : take the whole chain back out
+		{
+			unroute( first );
+			return false;
+		}
+	}
+	for( unsigned i = first; i < allLines.size(); i++ )
+		mapLine( i );
+	unsigned middle = first + (allLines.size() - first)/2;		// the new spot goes half way along
+	double xSpot, ySpot;
+	evaluate( toCubic( allLines[middle] ), 0.5, xSpot, ySpot );
+	splitLine( middle, (int)floor( xSpot + 0.5 ), (int)floor( ySpot + 0.5 ) );
+	return true;
+}
+/* The points the lines from first on share with older lines (their spots) stay, the rest go with them */
+void Bezier::unroute(unsigned first)
+{
+	std::set<int*> kept, owned;
+	for( unsigned i = 0; i < first; i++ )
+		for( int k = 0; k < 4; k += 3 )
+			kept.insert( allLines[i].xPoints[k] );
+	for( unsigned s = 0; s < startSpots.size(); s++ )
+		kept.insert( startSpots[s].x );
+	for( unsigned i = first; i < allLines.size(); i++ )
+		for( int k = 0; k < 4; k++ )
+			if( !kept.count( allLines[i].xPoints[k] ) && owned.insert( allLines[i].xPoints[k] ).second )
+			{
+				bends.erase( allLines[i].xPoints[k] );
+				delete allLines[i].xPoints[k];
+				delete allLines[i].yPoints[k];
+			}
+	allLines.resize( first );
+	mapValid = meshValid = gridValid = false;		// the map, the mesh and the grid may hold the lines just removed
+}
+/* A line splitting the region is sent round the region's other boundaries as the move shares them out : the side of the
+ * new line a boundary ends up on is the parity of the line's crossings with a ray from one of its spots, against those
+ * of the arc u ... v the line closes into a loop. Which of the two new faces that loop bounds is the u ... v x side
+ * depends on which way the boundary winds, so both are tried - each checked on a copy of the map with the line added */
+bool Bezier::planMove(const sproutsMove &m, std::vector<cubic> &chain, Uint64 &key)
+{
+	position p, child, canon;
+	positionSource source;
+	Canonicalizer canonicalizer;
+	getPosition( p, &source );
+	if( m.region >= (int)p.regionEnd.size() || m.from >= (int)p.spots.size() || m.to >= (int)p.spots.size() )
+		return false;
+	applyMove( p, m, child );
+	canonicalizer.canonical( child, canon );
+	key = positionHash( canon );
+	const PlanarMap &map = faces();
+	int from = source.spot[m.from], to = source.spot[m.to], bi = boundaryOf( p, m.from );
+	std::vector<routeSide> sides;
+	if( bi == boundaryOf( p, m.to ) )
+	{
+		std::vector<cubic> arc;		// u ... v along the boundary : nothing for a loop
+		for( int h = source.edge[m.from]; h >= 0 && h != source.edge[m.to]; h = map.edge(h).next )
+			arc.push_back( map.edgeCurve( h ) );
+		for( int b = m.region ? p.regionEnd[m.region - 1] : 0, k = 0; b < p.regionEnd[m.region]; b++ )
+			if( b != bi )
+			{
+				const boardSpot &s = map.spot( source.spot[ b ? p.boundaryEnd[b - 1] : 0 ] );
+				int winding = 0;
+				for( unsigned i = 0; i < arc.size(); i++ )
+					winding += rayCrossings( arc[i], s.x, s.y );
+				bool in = k < movesMaxSplit && (m.inside >> k & 1);
+				routeSide side = { s.x, s.y, (winding & 1) != in };
+				sides.push_back( side );
+				k++;
+			}
+	}
+	box screen = { 0, 0, (double)surface->w, (double)surface->h };
+	Router router( map, screen, &triangulation() );
+	std::vector<bool> joint;
+	markBends( joint );
+	for( int turn = 0; turn < (sides.empty() ? 1 : 2); turn++ )
+	{
+		for( unsigned i = 0; turn && i < sides.size(); i++ )
+			sides[i].odd = !sides[i].odd;
+		if( !router.route( from, to, chain, source.face[m.region], &sides, source.edge[m.from], source.edge[m.to] ) )
+			continue;
+		PlanarMap after = map;		// the board with the line on it, as placeChain will leave it
+		std::vector<bool> afterJoint = joint;
+		unsigned middle = chain.size()/2;
+		int at = from, curve = -1;
+		for( unsigned k = 0; k < chain.size() && at >= 0; k++ )
+		{
+			int end = to;
+			if( k + 1 < chain.size() )
+			{
+				end = after.addSpot( chain[k].x[3], chain[k].y[3] );
+				afterJoint.push_back( true );
+			}
+			int c = after.addCurve( chain[k], at, end );
+			if( k == middle )
+				curve = c;
+			at = c < 0 ? -1 : end;
+		}
+		if( at < 0 )
+			continue;
+		cubic firstHalf, secondHalf;
+		subdivide( chain[middle], 0.5, firstHalf, secondHalf );
+		after.splitCurve( curve, firstHalf, secondHalf );
+		afterJoint.push_back( false );
+		extractPosition( after, afterJoint, p );
+		canonicalizer.canonical( p, canon );
+		if( positionHash( canon ) == key )
+			return true;
+	}
+	chain.clear();
+	return false;
+}
+/* The line is planned before anything is drawn, and checked again once it is : taken back out if rounding to ints moved it round a boundary */
+bool Bezier::playMove(const sproutsMove &m)
+{
+	std::vector<cubic> chain;
+	Uint64 key;
+	int *fromX, *fromY, *toX, *toY;
+	if( !planMove( m, chain, key )
+	 || !nearSpot( (int)floor( chain[0].x[0] + 0.5 ), (int)floor( chain[0].y[0] + 0.5 ), fromX, fromY )
+	 || !nearSpot( (int)floor( chain.back().x[3] + 0.5 ), (int)floor( chain.back().y[3] + 0.5 ), toX, toY ) )
+		return false;
+	unsigned first = allLines.size();
+	if( !placeChain( fromX, fromY, toX, toY, chain ) )
+		return false;
+	position p, canon;
+	Canonicalizer canonicalizer;
+	getPosition( p );
+	canonicalizer.canonical( p, canon );
+	if( positionHash( canon ) != key )
+	{
+		unroute( first );
+		return false;
+	}
+	return true;
+}
+/* The line itself, planned as playMove would draw it : two spots alone do not say which way round a split goes */
+bool Bezier::showHint(const sproutsMove &m, Uint32 color)
+{
+	Uint64 key;
+	hinted = planMove( m, hintChain, key );
+	hintColor = color;
+	return hinted;
+}
+/* Sprouts lines may meet only at spots : test the given line against itself and every other line
+ * Lines whose bounding boxes miss are rejected before any subdivision, so this is cheap enough to run on every mouse motion */
+bool Bezier::crosses(int lineIndex)
+{
+	return selfIntersects( toCubic( allLines[lineIndex] ) ) || crossesOthers( lineIndex );
+}
+/* The lines before this one are settled : keep them in lineGrid and only test those in the buckets it touches.
+ * Lines after it (the rest of a routed chain, a line still being drawn) are tested one by one */
+bool Bezier::crossesOthers(int lineIndex)
+{
+	cubic c = toCubic( allLines[lineIndex] ), other;
+	box b = bounds( c );
+	double sharedX[2], sharedY[2];
+	int shared;
+	std::vector<int> near;
+	if( !gridValid )
+	{
+		lineGrid.clear();
+		indexed = 0;
+		gridValid = true;
+	}
+	indexed = std::min( indexed, (unsigned)allLines.size() );
+	for( ; indexed < (unsigned)lineIndex; indexed++ )
+		lineGrid.insert( indexed, bounds( toCubic( allLines[indexed] ) ) );
+	lineGrid.query( b, near );
+	for( unsigned lineIterator = indexed; lineIterator < allLines.size(); lineIterator++ )
+		near.push_back( lineIterator );
+	for( unsigned k = 0; k < near.size(); k++ )
+	{
+		unsigned lineIterator = near[k];
+		if( (int)lineIterator == lineIndex || lineIterator >= allLines.size() )
+			continue;
+		other = toCubic( allLines[lineIterator] );
+		if( !overlaps( b, bounds(other) ) )
+			continue;
+		shared = 0;
+		for( int i = 0; i < 4; i += 3 )		// collect the endpoints (spots) both lines start or end on
+		{
+			for( int j = 0; j < 4; j += 3 )
+			{
+				if( c.x[i] == other.x[j] && c.y[i] == other.y[j] )
+				{
+					sharedX[shared] = c.x[i];
+					sharedY[shared] = c.y[i];
+					shared++;
+					break;
+				}
+			}
+		}
+		if( ::crosses( c, other, shared, sharedX, sharedY ) )
+			return true;
+	}
+	return false;
+}
+/* Whole board check (the board a replay leaves, positions from elsewhere) : one sweep over all tessellated lines instead of crosses() on every pair */
+int Bezier::auditCrossings(std::vector< std::pair<int,int> > &pairs, int threads)
+{
+	std::vector<segment> segs;
+	std::vector<sweepHit> hits;
+	std::set< std::pair<int,int> > found;
+	for( unsigned lineIterator = 0; lineIterator < allLines.size(); lineIterator++ )
+		tessellate( toCubic( allLines[lineIterator] ), lineIterator, curvePoints, segs );
+	sweepCrossings( segs, hits, threads );
+	for( unsigned i = 0; i < hits.size(); i++ )
+	{
+		int a = segs[hits[i].a].curve, b = segs[hits[i].b].curve;
+		found.insert( std::make_pair( std::min(a, b), std::max(a, b) ) );
+	}
+	pairs.assign( found.begin(), found.end() );
+	return pairs.size();
+}
+int Bezier::lives(int *spot, int skipLine)
+{
+	if( bends.count( spot ) )
+		return 0;
+	int left = spotLives;
+	for( unsigned lineIterator = 0; lineIterator < allLines.size(); lineIterator++ )
+		if( (int)lineIterator != skipLine )
+			for( int i = 0; i < 4; i += 3 )
+				if( allLines[lineIterator].xPoints[i] == spot )
+					left--;
+	return left;
+}
+Bezier::moveError Bezier::checkLine(int lineIndex)
+{
+	int *from = allLines[lineIndex].xPoints[0], *to = allLines[lineIndex].xPoints[3];
+	if( from == to ? lives( from, lineIndex ) < 2 : lives( from, lineIndex ) < 1 || lives( to, lineIndex ) < 1 )		// a loop uses two lives of its spot
+		return moveNoLives;
+	if( selfIntersects( toCubic( allLines[lineIndex] ) ) )
+		return moveCrossesItself;
+	if( crossesOthers( lineIndex ) )
+		return moveCrosses;
+	if( !isSpot( from, lineIndex ) || !isSpot( to, lineIndex ) )		// last : drawing checks the rest before the end is placed
+		return moveEndOffSpot;
+	return moveLegal;
+}
+Bezier::moveError Bezier::checkMove(int lineIndex, int x, int y)
+{
+	moveError error = checkLine( lineIndex );
+	if( error != moveLegal )
+		return error;
+	cubic c = toCubic( allLines[lineIndex] );
+	double t;
+	if( distanceTo( c, x, y, t ) > spotTolerance
+	 || dist( x, y, c.x[0], c.y[0] ) <= spotTolerance || dist( x, y, c.x[3], c.y[3] ) <= spotTolerance )	// on the line, and not on top of its ends
+		return moveSpotOffLine;
+	return moveLegal;
+}
+const char *Bezier::moveMessage(moveError error)
+{
+	static const char *messages[] = { "SDL sandbox application", "A spot has no lives left", "The line crosses another line", "The line crosses itself", "The new spot must be on the line", "A line must start and end on spots" };
+	return messages[error];
+}
+void Bezier::getBoard(board &bd)
+{
+	std::map<int*, int> &spotIndex = spotIds;		// connected endpoints share the same int : use it to name the spot
+	std::map<int*, int>::iterator found;
+	spotIndex.clear();
+	bd.spots.clear();
+	bd.curves.clear();
+	for( unsigned s = 0; s < startSpots.size(); s++ )		// first, so a start spot keeps its index whether or not a line ends at it
+	{
+		boardSpot spot = { (double)*startSpots[s].x, (double)*startSpots[s].y };
+		spotIndex[ startSpots[s].x ] = bd.spots.size();
+		bd.spots.push_back( spot );
+	}
+	for( unsigned lineIterator = 0; lineIterator < allLines.size(); lineIterator++ )
+	{
+		boardCurve c;
+		c.c = toCubic( allLines[lineIterator] );
+		for( int i = 0; i < 4; i += 3 )		// endpoints only - the middle control points are not spots
+		{
+			found = spotIndex.find( allLines[lineIterator].xPoints[i] );
+			if( found == spotIndex.end() )
+			{
+				boardSpot s = { c.c.x[i], c.c.y[i] };
+				found = spotIndex.insert( std::make_pair( allLines[lineIterator].xPoints[i], (int)bd.spots.size() ) ).first;
+				bd.spots.push_back( s );
+			}
+			( i == 0 ? c.from : c.to ) = found->second;
+		}
+		bd.curves.push_back( c );
+	}
+}
+const PlanarMap &Bezier::faces()
+{
+	if( !mapValid )
+	{
+		board bd;
+		getBoard( bd );
+		planarMap.build( bd );
+		mapValid = true;
+	}
+	return planarMap;
+}
+Triangulation &Bezier::triangulation()
+{
+	if( !meshValid )
+	{
+		box screen = { 0, 0, (double)surface->w, (double)surface->h };
+		mesh.clear( screen );
+		for( unsigned s = 0; s < startSpots.size(); s++ )		// spots no line reaches yet are points the paths go round
+			mesh.insertPoint( *startSpots[s].x, *startSpots[s].y );
+		for( unsigned lineIterator = 0; lineIterator < allLines.size(); lineIterator++ )
+			mesh.insertCurve( toCubic( allLines[lineIterator] ) );		// a line that crosses another stops at the crossing
+		meshValid = true;
+	}
+	return mesh;
+}
+void Bezier::getPosition(position &p, positionSource *source)
+{
+	std::vector<bool> joint;
+	markBends( joint );
+	extractPosition( faces(), joint, p, source );
+}
+void Bezier::markBends(std::vector<bool> &joint)
+{
+	const PlanarMap &map = faces();
+	joint.assign( map.spots(), false );
+	for( std::set<int*>::iterator bend = bends.begin(); bend != bends.end(); ++bend )		// the bends of routed lines are in the map, but are not spots
+	{
+		std::map<int*, int>::iterator found = spotIds.find( *bend );
+		if( found != spotIds.end() )
+			joint[found->second] = true;
+	}
 }
 void Bezier::drawLines(Uint32 color, bool redraw)
 {
@@ -509,6 +1155,24 @@ void Bezier::drawLines(Uint32 color, bool redraw)
 		if( active )	// dragging a point - highlight that point
 			circleRGBA( surface, *allLines[activeLine].xPoints[allLines[activeLine].activePoint], *allLines[activeLine].yPoints[allLines[activeLine].activePoint], 5, 255,0,255,255 );
 	}
+	for( unsigned s = 0; s < startSpots.size(); s++ )
+		filledCircleColor( surface, *startSpots[s].x, *startSpots[s].y, 3, color );
+	if( hinted )		// the suggested move : its line, and a ring on each of its spots (one for a loop)
+	{
+		for( unsigned i = 0; i < hintChain.size(); i++ )
+		{
+			double x0 = hintChain[i].x[0], y0 = hintChain[i].y[0], x1, y1;
+			for( int k = 1; k <= curvePoints; k++ )
+			{
+				evaluate( hintChain[i], (double)k/curvePoints, x1, y1 );
+				lineColor( surface, (Sint16)floor( x0 + 0.5 ), (Sint16)floor( y0 + 0.5 ), (Sint16)floor( x1 + 0.5 ), (Sint16)floor( y1 + 0.5 ), hintColor );
+				x0 = x1;
+				y0 = y1;
+			}
+		}
+		circleColor( surface, (Sint16)floor( hintChain[0].x[0] + 0.5 ), (Sint16)floor( hintChain[0].y[0] + 0.5 ), 9, hintColor );
+		circleColor( surface, (Sint16)floor( hintChain.back().x[3] + 0.5 ), (Sint16)floor( hintChain.back().y[3] + 0.5 ), 9, hintColor );
+	}
 	if( redraw )
 	{
 		SDL_UnlockSurface( surface );
@@ -565,6 +1229,16 @@ inline double Bezier::dist(int x0, int y0, int x1, int y1)
 {
 	return (sqrt((x1-x0)*(x1-x0) + (y1-y0)*(y1-y0)));
 }
+inline cubic Bezier::toCubic(const bLine &bl)
+{
+	cubic c;
+	for( int i = 0; i < 4; i++ )
+	{
+		c.x[i] = *bl.xPoints[i];
+		c.y[i] = *bl.yPoints[i];
+	}
+	return c;
+}
 inline double Bezier::distLine(int x, int y, int lineIndex, int pointIndex)
 {
 	return sqrt( (x-*allLines[lineIndex].xPoints[pointIndex])*(x-*allLines[lineIndex].xPoints[pointIndex]) + (y-*allLines[lineIndex].yPoints[pointIndex])*(y-*allLines[lineIndex].yPoints[pointIndex]) );
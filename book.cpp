@@ -0,0 +1,58 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <SDL/SDL.h>
+
+#include "book.h"
+
+using namespace std;
+
+/* Opening book generator - offline, no window
+ * Usage : sproutsBook [fewest spots] [most spots] [plies] [milliseconds per position] [threads] [normal|misere] [file]
+ * Every position fewer than plies moves from the starts of fewest .. most spots gets a move, written to file
+ * (opening.book, or opening-misere.book under misère rules). An endgame tablebase under the same rules
+ * (endgame.tb, endgame-misere.tb) is used by the solver if there is one */
+
+void bookProgress(const position &p, const bookEntry &e, void*)
+{
+	string text;
+	writePosition( p, text );
+	if( e.value )
+		printf( "ply %d  %-30s  %s\n", e.ply, text.c_str(), e.value > 0 ? "won" : "lost" );
+	else
+		printf( "ply %d  %-30s  %lu playouts, %d%% won\n", e.ply, text.c_str(), (unsigned long)e.playouts, 100*e.winRate/65535 );
+	fflush( stdout );
+}
+
+int main( int argc, char* argv[] )
+{
+	int fewest = argc > 1 ? atoi(argv[1]) : 2;
+	int most = argc > 2 ? atoi(argv[2]) : 8;
+	int plies = argc > 3 ? atoi(argv[3]) : 2;
+	Uint32 time = argc > 4 ? atoi(argv[4]) : 2000;
+	int threads = argc > 5 ? atoi(argv[5]) : 4;
+	bool misereRules = argc > 6 && !strcmp( argv[6], "misere" );
+	const char *path = argc > 7 ? argv[7] : misereRules ? "opening-misere.book" : "opening.book";
+
+	BookBuilder builder;
+	Tablebase endgames;
+	builder.rules = misereRules ? misere : normalPlay;
+	if( endgames.open( misereRules ? "endgame-misere.tb" : "endgame.tb" ) && endgames.rules() == builder.rules )
+		builder.tablebase = &endgames;
+	builder.progress = bookProgress;
+	Uint32 start = SDL_GetTicks();
+	if( !builder.build( fewest, most, plies, time, threads, path ) )
+	{
+		fprintf( stderr, "could not write %s\n", path );
+		return EXIT_FAILURE;
+	}
+	OpeningBook book;
+	if( !book.open( path ) )
+	{
+		fprintf( stderr, "could not read %s back\n", path );
+		return EXIT_FAILURE;
+	}
+	printf( "%lu positions in %s (%s) in %u ms\n", (unsigned long)book.count(), path, misereRules ? "misere" : "normal play", SDL_GetTicks() - start );
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,271 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <SDL/SDL.h>
+#include "canonical.h"
+#include "moves.h"
+#include "database.h"
+#include "solver.h"
+#include "mcts.h"
+
+/* Opening book : a move for every position in the first few moves of the n spot starts, worked out offline and read
+ * back mapped at startup, so the computer player and the hints answer at once while the game is young.
+ * An entry names its move by the canonical hash of the position it leads to : looking a position up turns that back
+ * into a move of the position as given (the move whose child has that hash), however the board has it drawn.
+ * A move is the solver's when it could decide the position in the time given (a winning move, or for a lost position the
+ * Monte Carlo choice), else the Monte Carlo choice alone.
+ * The GUI plays these starts when it is run with --spots n : its positions are then the book's for the first plies
+ * File : header, then the entries sorted by key */
+
+/* Global constants for opening books */
+static const Uint32 bookVersion = 2;			// 2 : keyed by the unique canonical forms
+static const char bookMagic[8] = { 'S','P','R','O','U','T','B','K' };
+/* End constants */
+
+struct bookHeader
+{
+	char magic[8];
+	Uint32 version, rules, plies, entrySize;	// rules : sproutsRules, plies : moves deep the book goes from each start
+	Uint64 count;
+	Uint8 padding[32];
+};
+struct bookEntry
+{
+	Uint64 key;			// canonical hash of the position (under the book's rules)
+	Uint64 child;		// canonical hash of the position the book's move leads to - 0 for a position with no move
+	Sint8 value;		// +1 / -1 : solved, won or lost for the player to move - 0 not solved
+	Uint8 ply;			// moves from the start
+	Uint16 winRate;		// playouts the move won, in 65535ths (not solved)
+	Uint32 playouts;
+};
+inline bool operator<(const bookEntry &a, const bookEntry &b) { return a.key < b.key; }
+
+class OpeningBook
+{
+	private:
+		MappedFile file;
+		const bookHeader *header;		// NULL while closed
+		const bookEntry *entries;
+		Canonicalizer canonicalizer;
+
+	public:
+		/* Constructors */
+		OpeningBook();
+
+		/* Construction */
+		bool open(const char*);		// map a book read-only, false if it is missing or not one
+		void close();
+
+		/* Queries */
+		bool isOpen() const { return header != NULL; }
+		const bookEntry *find(Uint64) const;		// entry for a canonical hash, NULL if not in the book
+		bool lookup(const position&, sproutsMove&, const bookEntry** =NULL);	// the book's move in the position's terms (and its entry), false if not in the book
+		bool lookup(const position&, sproutsMove&, Canonicalizer&, const bookEntry** =NULL) const;	// the same with the caller's canonicalizer : one book for several threads
+		sproutsRules rules() const { return header ? (sproutsRules)header->rules : normalPlay; }
+		Uint64 count() const { return header ? header->count : 0; }
+};
+OpeningBook::OpeningBook()
+{
+	header = NULL;
+	entries = NULL;
+}
+bool OpeningBook::open(const char *path)
+{
+	close();
+	if( !file.open( path ) || file.size() < sizeof(bookHeader) )
+	{
+		close();
+		return false;
+	}
+	const bookHeader *h = (const bookHeader*)file.data();
+	if( memcmp( h->magic, bookMagic, sizeof(bookMagic) ) || h->version != bookVersion || h->entrySize != sizeof(bookEntry)
+	 || file.size() < sizeof(bookHeader) + h->count*sizeof(bookEntry) )
+	{
+		close();
+		return false;
+	}
+	header = h;
+	entries = (const bookEntry*)(file.data() + sizeof(bookHeader));
+	return true;
+}
+void OpeningBook::close()
+{
+	file.close();
+	header = NULL;
+}
+const bookEntry *OpeningBook::find(Uint64 key) const
+{
+	if( !header )
+		return NULL;
+	bookEntry wanted;
+	wanted.key = key;
+	const bookEntry *found = std::lower_bound( entries, entries + header->count, wanted );
+	return found != entries + header->count && found->key == key ? found : NULL;
+}
+bool OpeningBook::lookup(const position &p, sproutsMove &move, const bookEntry **entry)
+{
+	return lookup( p, move, canonicalizer, entry );
+}
+bool OpeningBook::lookup(const position &p, sproutsMove &move, Canonicalizer &canonicalizer, const bookEntry **entry) const
+{
+	position canon, child;
+	std::vector<sproutsMove> moves;
+	canonicalizer.canonical( p, canon );
+	const bookEntry *e = find( positionHash( canon, rules() ) );
+	if( !e )
+		return false;
+	generateMoves( p, moves );
+	for( unsigned i = 0; i < moves.size(); i++ )
+	{
+		applyMove( p, moves[i], child );
+		canonicalizer.canonical( child, canon );
+		if( positionHash( canon, rules() ) == e->child )
+		{
+			move = moves[i];
+			if( entry )
+				*entry = e;
+			return true;
+		}
+	}
+	return false;		// the key is some other position's (64-bit hashes that met)
+}
+
+/* The generator, offline : every canonical position fewer than plies moves from a start, both sides' moves */
+class BookBuilder
+{
+	private:
+		static bool timeUp(void*);
+
+	public:
+		/* Constructors */
+		BookBuilder();
+
+		/* Public variables */
+		sproutsRules rules;
+		const Tablebase *tablebase;		// endgames for the solver, if set
+		void (*progress)(const position&, const bookEntry&, void*);		// after each entry, if set
+		void *progressData;
+
+		/* Construction */
+		bool build(int, int, int, Uint32, int, const char*);	// fewest and most spots, plies, milliseconds per position, threads, file - false if the file could not be written
+};
+BookBuilder::BookBuilder()
+{
+	rules = normalPlay;
+	tablebase = NULL;
+	progress = NULL;
+	progressData = NULL;
+}
+bool BookBuilder::timeUp(void *deadline)
+{
+	return SDL_GetTicks() >= *(Uint32*)deadline;
+}
+bool BookBuilder::build(int fewest, int most, int plies, Uint32 time, int threads, const char *path)
+{
+	std::vector<bookEntry> book;
+	std::vector<Uint64> seen;
+	std::vector<position> level, next;
+	std::vector<sproutsMove> moves;
+	Canonicalizer canonicalizer;
+	position child, canon;
+	Solver solver;
+	MonteCarlo player;
+	Uint32 deadline;
+	solver.rules = player.rules = rules;
+	solver.tablebase = tablebase;
+	solver.stop = timeUp;
+	solver.stopData = &deadline;
+	for( int n = fewest; n <= most; n++ )
+	{
+		position start;
+		start.labels = 0;
+		for( int i = 0; i < n; i++ )
+		{
+			start.spots.push_back( 0 );
+			start.boundaryEnd.push_back( i + 1 );
+		}
+		start.regionEnd.push_back( n );
+		canonicalizer.canonical( start, canon );
+		level.assign( 1, canon );
+		for( int ply = 0; ply < plies && !level.empty(); ply++ )
+		{
+			next.clear();
+			for( unsigned i = 0; i < level.size(); i++ )
+			{
+				const position &p = level[i];
+				Uint64 key = positionHash( p, rules );
+				if( std::find( seen.begin(), seen.end(), key ) != seen.end() )
+					continue;
+				seen.push_back( key );
+				bookEntry e;
+				sproutsMove best;
+				e.key = key;
+				e.ply = ply;
+				e.value = 0;
+				e.winRate = 0;
+				e.playouts = 0;
+				generateMoves( p, moves );
+				if( moves.empty() )		// decided by the rules, and no move to book
+				{
+					e.value = rules == misere ? 1 : -1;
+					e.winRate = rules == misere ? 65535 : 0;
+					e.child = 0;
+					book.push_back( e );
+					if( progress )
+						progress( p, e, progressData );
+					continue;
+				}
+				deadline = SDL_GetTicks() + time;
+				bool won = solver.solve( p, &best );
+				if( !solver.stopped() )
+					e.value = won ? 1 : -1;
+				if( !won || solver.stopped() )		// lost, or not known : the Monte Carlo choice
+				{
+					if( !player.choose( p, threads, time, 0, best ) )
+						continue;		// no playout finished : nothing to book
+					e.winRate = (Uint16)(65535*player.winRate);
+					e.playouts = (Uint32)player.playouts;
+				}
+				else
+					e.winRate = 65535;
+				applyMove( p, best, child );
+				canonicalizer.canonical( child, canon );
+				e.child = positionHash( canon, rules );
+				book.push_back( e );
+				if( progress )
+					progress( p, e, progressData );
+				for( unsigned m = 0; m < moves.size(); m++ )		// every reply is in the book's next ply
+				{
+					applyMove( p, moves[m], child );
+					canonicalizer.canonical( child, canon );
+					next.push_back( canon );
+				}
+			}
+			level.swap( next );
+		}
+	}
+
+	/* Written whole before it replaces the old one, so a reader never maps half a book */
+	std::sort( book.begin(), book.end() );
+	bookHeader h;
+	memset( &h, 0, sizeof(h) );
+	memcpy( h.magic, bookMagic, sizeof(bookMagic) );
+	h.version = bookVersion;
+	h.rules = rules;
+	h.plies = plies;
+	h.entrySize = sizeof(bookEntry);
+	h.count = book.size();
+	ReplacedFile out;
+	if( !out.open( path ) )
+		return false;
+	out.write( &h, sizeof(h), 1 );
+	if( !book.empty() )
+		out.write( &book[0], sizeof(bookEntry), book.size() );
+	return out.commit();
+}
+
+#endif
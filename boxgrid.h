@@ -0,0 +1,92 @@
+#ifndef BOXGRID_H
+#define BOXGRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+#include "geometry.h"
+
+/* Spatial index for the lines : a uniform grid of buckets, each item listed in every bucket its box touches,
+ * so the lines near a box are found by looking in a few buckets instead of testing every line */
+
+/* Global constants for the grid */
+static const double gridCell = 64;		// bucket size in pixels (about the box of one line on a typical board)
+/* End constants */
+
+class BoxGrid
+{
+	private:
+		std::map< std::pair<int,int>, std::vector<int> > buckets;	// only the buckets that hold something
+		std::vector<unsigned> stamp;		// query an item was last reported in, so an item in several buckets is reported once
+		unsigned queries;
+
+		/* Private functions */
+		void range(const box&, int&, int&, int&, int&) const;	// buckets a box touches
+
+	public:
+		/* Constructors */
+		BoxGrid();
+
+		/* Construction */
+		void clear();
+		void insert(int, const box&);		// list an item in the buckets its box touches (an item may be listed again with a new box)
+
+		/* Queries */
+		void query(const box&, std::vector<int>&);	// items sharing a bucket with the box - a superset, test their boxes after
+};
+BoxGrid::BoxGrid()
+{
+	queries = 0;
+}
+inline void BoxGrid::range(const box &b, int &i0, int &j0, int &i1, int &j1) const
+{
+	i0 = (int)floor( b.x0/gridCell );
+	j0 = (int)floor( b.y0/gridCell );
+	i1 = (int)floor( b.x1/gridCell );
+	j1 = (int)floor( b.y1/gridCell );
+}
+void BoxGrid::clear()
+{
+	buckets.clear();
+	stamp.clear();
+}
+void BoxGrid::insert(int item, const box &b)
+{
+	int i0, j0, i1, j1;
+	range( b, i0, j0, i1, j1 );
+	for( int j = j0; j <= j1; j++ )
+		for( int i = i0; i <= i1; i++ )
+			buckets[ std::make_pair( i, j ) ].push_back( item );
+	if( item >= (int)stamp.size() )
+		stamp.resize( item + 1, 0 );
+}
+void BoxGrid::query(const box &b, std::vector<int> &out)
+{
+	int i0, j0, i1, j1;
+	range( b, i0, j0, i1, j1 );
+	out.clear();
+	if( ++queries == 0 )		// wrapped : old stamps could match again
+	{
+		std::fill( stamp.begin(), stamp.end(), 0 );
+		queries = 1;
+	}
+	for( int j = j0; j <= j1; j++ )
+		for( int i = i0; i <= i1; i++ )
+		{
+			std::map< std::pair<int,int>, std::vector<int> >::const_iterator found = buckets.find( std::make_pair( i, j ) );
+			if( found == buckets.end() )
+				continue;
+			for( unsigned k = 0; k < found->second.size(); k++ )
+			{
+				int item = found->second[k];
+				if( stamp[item] != queries )
+				{
+					stamp[item] = queries;
+					out.push_back( item );
+				}
+			}
+		}
+}
+
+#endif
@@ -0,0 +1,643 @@
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <SDL/SDL.h>
+#include "position.h"
+
+/* One name for positions that play the same, so solvers and caches can share results
+ * The canonical form of a position :
+ *   - drops dead regions (fewer than two lives among its spots : no move can be made in them)
+ *   - writes a label met only once after that as 2 (a spot with one life, met once)
+ *   - turns each boundary to start where it is smallest, and each region the way round (or mirrored) that sorts first
+ *   - sorts the boundaries of each region, the regions of each group joined by labels, then the groups by what they write
+ *   - renames the labels in the order they are first met
+ * Sorting sees a label as its colour, a number for where it occurs that does not depend on its name. What it leaves tied
+ * (boundaries or regions sorting equal, a boundary that repeats, a region reading the same either way round) is settled
+ * by trying each way and keeping the one that writes smallest : equal positions get equal forms. A try that writes the
+ * best form again shows the two ways are the same up to renaming, so the rest of that way is skipped; past
+ * canonicalSearchLimit tries in one group (none met from the starts) the smallest form found so far is kept
+ * None of this depends on who wins when the moves run out, so the forms serve normal play and misère alike; results
+ * under the two rules are kept apart by the hash (positionHash with the rules), never by the form */
+
+/* Global constants for canonical forms */
+static const int canonicalBoundary = 0;			// tokens hashed between boundaries and regions (spot codes are hashed from canonicalSpot up)
+static const int canonicalRegion = 1;
+static const int canonicalSpot = 2;
+static const Uint64 canonicalMisere = ((Uint64)0x9E3779B9 << 32) | 0x7F4A7C15;	// mixed into misère hashes
+static const int canonicalSearchLimit = 4096;	// forms written out at most to settle the ties sorting leaves
+/* End constants */
+
+enum sproutsRules
+{
+	normalPlay,		// the player left without a move loses
+	misere			// the player who makes the last move loses
+};
+
+class Canonicalizer
+{
+	private:
+		struct boundaryRef			// one boundary read from some spot, either way round
+		{ int begin, length, start, step, labels; };	// labels : how many of its spots are labels
+		struct regionRef			// a region's boundaries, sorted, in refs[first .. first+count) - and in mirrored too if ways is 2
+		{ int first, count, ways, labels; };
+
+		std::vector<int> codes;			// spot codes after dropping labels met once
+		std::vector<int> lives, stamp, seen, rename;
+		std::vector<int> boundaryRegion, color;		// live region of each boundary (-1 if dead), colour of each label
+		std::vector<Uint64> boundaryHash, regionHash, occurrence, value, sorted;
+		std::vector<boundaryRef> refs, mirrored;
+		std::vector<int> refTie, mirroredTie;		// first boundary of the run sorting equal to each
+		std::vector<regionRef> regions;
+		std::vector<int> labelRegion, parent;		// first region of each label, and groups of regions joined by labels
+		std::vector<int> ranked, order, orderTie, groupBegin, groupOrder;	// regions sorted, then kept so within their groups
+		std::vector<int> forms, formBegin;		// the form of each group
+		unsigned groupEnd;
+		std::vector<int> tokens, best, written, named;		// the form being tried, the smallest so far
+		std::vector<char> regionUsed, boundaryUsed;
+		std::vector< std::vector<int> > tried, triedRegions;	// closed boundaries and regions written at each place so far
+		std::vector<int> path, bestPath;		// the choices made, at each tie on the way
+		bool hasBest, tied;
+		int leaves, improvements, back;		// back : the choice to go back to, -1 if none
+
+		/* Private functions */
+		int at(const boundaryRef &b, int k) const		// k-th spot of a boundary
+		{
+			int i = b.start + b.step*k;
+			return codes[ b.begin + (i >= b.length ? i - b.length : i < 0 ? i + b.length : i) ];
+		}
+		int kind(int code) const { return code < positionLabel ? code : positionLabel + color[code - positionLabel]; }	// what sorting sees : a digit or a label's colour
+		static Uint64 mix(Uint64 h, Uint64 v)
+		{
+			h = (h ^ v) * (((Uint64)0xFF51AFD7 << 32) | 0xED558CCD);
+			return h ^ (h >> 33);
+		}
+		int root(int r)
+		{
+			while( parent[r] != r )
+				r = parent[r] = parent[ parent[r] ];
+			return r;
+		}
+		void colorLabels(const position&);
+		int smallestStart(const boundaryRef&) const;	// rotation of a boundary that reads smallest
+		int period(const boundaryRef&) const;			// spots after which it reads the same again
+		int compare(const boundaryRef&, const boundaryRef&) const;
+		int compare(const boundaryRef*, const boundaryRef*, int, int) const;	// two sorted lists of boundaries
+		void sortBoundaries(boundaryRef*, int);
+		void markTies(const std::vector<boundaryRef>&, std::vector<int>&, const regionRef&);
+		bool write(int);				// false if the form being tried is worse than the best now
+		bool writeBoundary(const boundaryRef&, int&);
+		void unwriteBoundary(const boundaryRef&, int, unsigned, unsigned);
+		bool closed(const boundaryRef&) const;
+		bool repeated(std::vector<int>&, unsigned);
+		void searchRegion(unsigned, int);
+		void searchBoundary(unsigned, int, int, int, int, unsigned);
+
+	public:
+		/* Queries */
+		void canonical(const position&, position&);		// the canonical form of a position (in and out must differ)
+};
+
+/* 64-bit hash of a position (meant for canonical ones) : FNV-1a over the codes and separators, then a final mix
+ * so the low bits are good enough to index a table with */
+inline Uint64 positionHash(const position &p)
+{
+	const Uint64 prime = ((Uint64)0x100 << 32) | 0x1B3;
+	Uint64 h = ((Uint64)0xCBF29CE4 << 32) | 0x84222325;
+	unsigned spot = 0, bound = 0;
+	for( unsigned r = 0; r < p.regionEnd.size(); r++ )
+	{
+		for( ; bound < (unsigned)p.regionEnd[r]; bound++ )
+		{
+			for( ; spot < (unsigned)p.boundaryEnd[bound]; spot++ )
+				h = (h ^ (Uint64)(p.spots[spot] + canonicalSpot)) * prime;
+			h = (h ^ canonicalBoundary) * prime;
+		}
+		h = (h ^ canonicalRegion) * prime;
+	}
+	h ^= h >> 33;		// finalizer from MurmurHash3
+	h *= ((Uint64)0xFF51AFD7 << 32) | 0xED558CCD;
+	h ^= h >> 33;
+	h *= ((Uint64)0xC4CEB9FE << 32) | 0x1A85EC53;
+	h ^= h >> 33;
+	return h;
+}
+/* Hashes under misère rules are a separate key space : a table or database shared by both never mixes their results */
+inline Uint64 positionHash(const position &p, sproutsRules rules)
+{
+	Uint64 h = positionHash( p );
+	if( rules == misere )
+	{
+		h ^= canonicalMisere;
+		h *= ((Uint64)0xFF51AFD7 << 32) | 0xED558CCD;
+		h ^= h >> 33;
+	}
+	return h;
+}
+
+/* Labels coloured by where they occur, refined until the colours stop splitting. Only what renaming, turning and
+ * mirroring keep is looked at (the kinds in each boundary and the boundaries in each region, summed so their order
+ * does not count, and the neighbours of each occurrence either way round), so the colours of two equal positions are
+ * the same */
+void Canonicalizer::colorLabels(const position &p)
+{
+	int n = p.regionEnd.size(), bounds = p.boundaryEnd.size(), classes = 1;
+	color.assign( p.labels, 0 );
+	if( std::find( seen.begin(), seen.end(), 2 ) == seen.end() )		// no label left
+		return;
+	boundaryHash.assign( bounds, 0 );
+	regionHash.assign( n, 0 );
+	for( ;; )
+	{
+		for( int b = 0; b < bounds; b++ )
+		{
+			int begin = b ? p.boundaryEnd[b - 1] : 0;
+			if( boundaryRegion[b] < 0 )
+				continue;
+			Uint64 h = 0;
+			for( int s = begin; s < p.boundaryEnd[b]; s++ )
+				h += mix( 0, kind( codes[s] ) + 1 );
+			boundaryHash[b] = mix( h, p.boundaryEnd[b] - begin );
+		}
+		for( int r = 0, b = 0; r < n; r++ )
+		{
+			Uint64 h = 0;
+			int first = b;
+			for( ; b < p.regionEnd[r]; b++ )
+				h += boundaryHash[b];
+			regionHash[r] = mix( h, b - first );
+		}
+		occurrence.assign( 2*p.labels, 0 );
+		stamp.assign( p.labels, 0 );
+		for( int b = 0; b < bounds; b++ )
+		{
+			int begin = b ? p.boundaryEnd[b - 1] : 0, end = p.boundaryEnd[b];
+			if( boundaryRegion[b] < 0 )
+				continue;
+			for( int s = begin; s < end; s++ )
+				if( codes[s] >= positionLabel )
+				{
+					int before = kind( codes[ s > begin ? s - 1 : end - 1 ] ), after = kind( codes[ s + 1 < end ? s + 1 : begin ] );
+					int l = codes[s] - positionLabel;
+					occurrence[ 2*l + stamp[l]++ ] = mix( mix( mix( boundaryHash[b], regionHash[ boundaryRegion[b] ] ), std::min( before, after ) ), std::max( before, after ) );
+				}
+		}
+		sorted.clear();
+		value.assign( p.labels, 0 );
+		for( int l = 0; l < p.labels; l++ )
+			if( seen[l] == 2 )
+			{
+				Uint64 a = occurrence[2*l], c = occurrence[2*l + 1];
+				value[l] = mix( mix( color[l] + 1, std::min( a, c ) ), std::max( a, c ) );
+				sorted.push_back( value[l] );
+			}
+		std::sort( sorted.begin(), sorted.end() );
+		int found = std::unique( sorted.begin(), sorted.end() ) - sorted.begin();
+		if( found <= classes )
+			return;
+		classes = found;
+		for( int l = 0; l < p.labels; l++ )
+			if( seen[l] == 2 )
+				color[l] = std::lower_bound( sorted.begin(), sorted.begin() + found, value[l] ) - sorted.begin();
+	}
+}
+/* Least rotation by the two candidate walk : linear in the length of the boundary */
+int Canonicalizer::smallestStart(const boundaryRef &b) const
+{
+	int i = 0, j = 1, k = 0, n = b.length;
+	boundaryRef from = b;
+	from.start = 0;
+	while( i < n && j < n && k < n )
+	{
+		boundaryRef ri = from, rj = from;
+		ri.start = b.step > 0 ? i : (n - i) % n;		// read backwards, rotation i starts i before the first spot
+		rj.start = b.step > 0 ? j : (n - j) % n;
+		int a = kind( at( ri, k ) ), c = kind( at( rj, k ) );
+		if( a == c )
+		{
+			k++;
+			continue;
+		}
+		if( a > c )
+			i += k + 1;
+		else
+			j += k + 1;
+		if( i == j )
+			j++;
+		k = 0;
+	}
+	int s = std::min( i, j );
+	return b.step > 0 ? s : (n - s) % n;
+}
+int Canonicalizer::period(const boundaryRef &b) const
+{
+	for( int p = 1; p < b.length; p++ )
+	{
+		if( b.length % p )
+			continue;
+		int k = 0;
+		while( k + p < b.length && kind( at( b, k ) ) == kind( at( b, k + p ) ) )
+			k++;
+		if( k + p == b.length )
+			return p;
+	}
+	return b.length;
+}
+int Canonicalizer::compare(const boundaryRef &a, const boundaryRef &b) const
+{
+	int n = std::min( a.length, b.length );
+	for( int k = 0; k < n; k++ )
+	{
+		int x = kind( at( a, k ) ), y = kind( at( b, k ) );
+		if( x != y )
+			return x < y ? -1 : 1;
+	}
+	return a.length == b.length ? 0 : a.length < b.length ? -1 : 1;
+}
+int Canonicalizer::compare(const boundaryRef *a, const boundaryRef *b, int na, int nb) const
+{
+	for( int i = 0; i < std::min( na, nb ); i++ )
+	{
+		int c = compare( a[i], b[i] );
+		if( c )
+			return c;
+	}
+	return na == nb ? 0 : na < nb ? -1 : 1;
+}
+/* Insertion sort : regions have a handful of boundaries, and it needs no comparison object */
+void Canonicalizer::sortBoundaries(boundaryRef *b, int n)
+{
+	for( int i = 1; i < n; i++ )
+	{
+		boundaryRef key = b[i];
+		int j = i - 1;
+		for( ; j >= 0 && compare( key, b[j] ) < 0; j-- )
+			b[j + 1] = b[j];
+		b[j + 1] = key;
+	}
+}
+/* Runs of boundaries sorting equal, each pointing at the first of its run */
+void Canonicalizer::markTies(const std::vector<boundaryRef> &b, std::vector<int> &tie, const regionRef &region)
+{
+	for( int i = region.first; i < region.first + region.count; i++ )
+		tie[i] = i > region.first && !compare( b[i], b[i - 1] ) ? tie[i - 1] : i;
+}
+
+/* The search over ties : a branch and bound for the smallest form, tokens as positionHash takes them. tied says the
+ * tokens so far are the best's first ones, so a bigger one ends the branch and a smaller one makes it the new best */
+bool Canonicalizer::write(int token)
+{
+	if( hasBest && tied )
+	{
+		int b = best[ tokens.size() ];
+		if( token > b )
+			return false;
+		tied = token == b;
+	}
+	tokens.push_back( token );
+	return true;
+}
+/* Spots of a boundary, then its end : count is how many spots were written before it stopped */
+bool Canonicalizer::writeBoundary(const boundaryRef &b, int &count)
+{
+	for( count = 0; count < b.length; count++ )
+	{
+		int c = at( b, count ), token = c;
+		if( c >= positionLabel )
+		{
+			int &name = rename[c - positionLabel];
+			if( name < 0 )
+			{
+				name = named.size();
+				named.push_back( c - positionLabel );
+			}
+			token = positionLabel + name;
+		}
+		if( !write( token + canonicalSpot ) )
+			return false;
+		if( c >= positionLabel )
+			written[c - positionLabel]++;
+	}
+	return write( canonicalBoundary );
+}
+void Canonicalizer::unwriteBoundary(const boundaryRef &b, int count, unsigned names, unsigned size)
+{
+	for( int k = 0; k < count; k++ )
+		if( at( b, k ) >= positionLabel )
+			written[ at( b, k ) - positionLabel ]--;
+	for( ; named.size() > names; named.pop_back() )
+		rename[ named.back() ] = -1;
+	tokens.resize( size );
+}
+/* Both spots of every label in it written : a boundary or region like that writing the same as one tried before in
+ * its place holds labels of its own only, so it is the other one swapped - whatever follows goes the same way */
+bool Canonicalizer::closed(const boundaryRef &b) const
+{
+	for( int k = 0; k < b.length; k++ )
+		if( at( b, k ) >= positionLabel && written[ at( b, k ) - positionLabel ] < 2 )
+			return false;
+	return true;
+}
+bool Canonicalizer::repeated(std::vector<int> &before, unsigned size)
+{
+	unsigned length = tokens.size() - size;
+	for( unsigned i = 0; i + length <= before.size(); i += length )
+		if( std::equal( tokens.begin() + size, tokens.end(), before.begin() + i ) )
+			return true;
+	before.insert( before.end(), tokens.begin() + size, tokens.end() );
+	return false;
+}
+/* Regions from slot on : each unused one of the run sorting equal at the slot, either way round if both sort first */
+void Canonicalizer::searchRegion(unsigned slot, int depth)
+{
+	if( slot == groupEnd )
+	{
+		leaves++;
+		if( !hasBest || !tied )
+		{
+			best = tokens;
+			bestPath = path;
+			hasBest = true;
+			improvements++;
+		}
+		else		// the same form again : the choice where this path left the best's only renamed its labels
+			for( back = 0; path[back] == bestPath[back]; back++ )
+				;
+		return;
+	}
+	bool from = tied;
+	int seenImprovements = improvements;
+	triedRegions[slot].clear();
+	for( unsigned c = orderTie[slot]; c < groupEnd && orderTie[c] == orderTie[slot] && leaves < canonicalSearchLimit; c++ )
+	{
+		int r = order[c];
+		if( regionUsed[r] )
+			continue;
+		regionUsed[r] = 1;
+		for( int way = 0; way < regions[r].ways && back < 0; way++ )
+		{
+			tied = from;
+			path.push_back( 2*c + way );
+			searchBoundary( slot, r, way, 0, depth, tokens.size() );
+			path.pop_back();
+			if( improvements != seenImprovements )		// the best goes through here now
+			{
+				from = true;
+				seenImprovements = improvements;
+			}
+			if( back == (int)path.size() )		// the rest of that choice writes what the best's did, renamed
+				back = -1;
+		}
+		regionUsed[r] = 0;
+		if( back >= 0 )
+			return;
+		if( !regions[r].labels )		// regions without labels sorting equal all write the same
+			break;
+	}
+}
+/* Boundary j on of region r (read the way given) : each unused one of the run sorting equal at j, at each rotation that
+ * reads the same - then the next region, starting at depth boundaries and tokens[start] */
+void Canonicalizer::searchBoundary(unsigned slot, int r, int way, int j, int depth, unsigned start)
+{
+	const regionRef &region = regions[r];
+	const std::vector<boundaryRef> &b = way ? mirrored : refs;
+	const std::vector<int> &tie = way ? mirroredTie : refTie;
+	if( j == region.count )
+	{
+		if( !write( canonicalRegion ) )
+			return;
+		bool done = slot + 1 < groupEnd && orderTie[slot + 1] == orderTie[slot];		// another region could come here
+		for( int i = region.first; i < region.first + region.count && done; i++ )
+			done = closed( b[i] );
+		if( !done || !repeated( triedRegions[slot], start ) )
+			searchRegion( slot + 1, depth );
+		tokens.pop_back();
+		return;
+	}
+	bool from = tied;
+	int seenImprovements = improvements, g = tie[region.first + j];
+	tried[depth].clear();
+	for( int c = g; c < region.first + region.count && tie[c] == g && leaves < canonicalSearchLimit; c++ )
+	{
+		if( boundaryUsed[c] )
+			continue;
+		boundaryUsed[c] = 1;
+		boundaryRef turned = b[c];
+		int step = b[c].labels ? period( turned ) : b[c].length;
+		bool others = step < b[c].length || (region.first + j + 1 < region.first + region.count && tie[region.first + j + 1] == g);		// another boundary could come here
+		for( int k = 0; k < b[c].length && back < 0; k += step )
+		{
+			turned.start = ((b[c].start + b[c].step*k) % b[c].length + b[c].length) % b[c].length;
+			tied = from;
+			unsigned size = tokens.size(), names = named.size();
+			int count;
+			path.push_back( c*b[c].length + k );
+			if( writeBoundary( turned, count ) && !(others && closed( turned ) && repeated( tried[depth], size )) )
+				searchBoundary( slot, r, way, j + 1, depth + 1, start );
+			unwriteBoundary( turned, count, names, size );
+			path.pop_back();
+			if( improvements != seenImprovements )
+			{
+				from = true;
+				seenImprovements = improvements;
+			}
+			if( back == (int)path.size() )
+				back = -1;
+		}
+		boundaryUsed[c] = 0;
+		if( back >= 0 )
+			return;
+		if( !b[c].labels )
+			break;
+	}
+}
+
+void Canonicalizer::canonical(const position &p, position &out)
+{
+	int n = p.regionEnd.size();
+	codes = p.spots;
+	stamp.assign( p.labels, -1 );
+	seen.assign( p.labels, 0 );
+	refs.clear();
+	mirrored.clear();
+	regions.clear();
+
+	/* Dead regions : count each spot's lives once per region (a label met twice in a region is still one life) */
+	int bound = 0, spot = 0;
+	lives.assign( n, 0 );
+	boundaryRegion.resize( p.boundaryEnd.size() );
+	for( int r = 0; r < n; r++ )
+	{
+		int spotStart = spot, boundStart = bound;
+		for( ; bound < p.regionEnd[r]; bound++ )
+			for( ; spot < p.boundaryEnd[bound]; spot++ )
+			{
+				int c = codes[spot];
+				if( c < positionLabel )
+					lives[r] += positionLives - c;
+				else if( stamp[c - positionLabel] != r )
+				{
+					stamp[c - positionLabel] = r;
+					lives[r]++;
+				}
+			}
+		for( int b = boundStart; b < bound; b++ )
+			boundaryRegion[b] = lives[r] >= 2 ? r : -1;
+		if( lives[r] >= 2 )
+			for( int s = spotStart; s < spot; s++ )
+				if( codes[s] >= positionLabel )
+					seen[ codes[s] - positionLabel ]++;
+	}
+	for( unsigned s = 0; s < codes.size(); s++ )
+		if( codes[s] >= positionLabel && seen[ codes[s] - positionLabel ] == 1 )
+			codes[s] = 2;
+	colorLabels( p );
+
+	/* Each live region : boundaries turned to their smallest start, sorted, whichever way round sorts first - and
+	 * joined to the group of the regions it shares labels with */
+	bound = spot = 0;
+	labelRegion.assign( p.labels, -1 );
+	parent.clear();
+	for( int r = 0; r < n; r++ )
+	{
+		int first = bound;
+		spot = first ? p.boundaryEnd[first - 1] : 0;
+		bound = p.regionEnd[r];
+		if( lives[r] < 2 )
+			continue;
+		parent.push_back( regions.size() );
+		regionRef region = { (int)refs.size(), bound - first, 1, 0 };
+		for( int b = first; b < bound; b++ )
+		{
+			int begin = b ? p.boundaryEnd[b - 1] : 0;
+			boundaryRef forward = { begin, p.boundaryEnd[b] - begin, 0, 1, 0 }, backward;
+			for( int s = begin; s < p.boundaryEnd[b]; s++ )
+				if( codes[s] >= positionLabel )
+				{
+					int &other = labelRegion[ codes[s] - positionLabel ];
+					if( other < 0 )
+						other = regions.size();
+					else
+						parent[ root( other ) ] = root( regions.size() );
+					forward.labels++;
+				}
+			region.labels += forward.labels;
+			backward = forward;
+			backward.step = -1;
+			forward.start = smallestStart( forward );
+			backward.start = smallestStart( backward );
+			refs.push_back( forward );
+			mirrored.push_back( backward );
+		}
+		sortBoundaries( &refs[region.first], region.count );
+		sortBoundaries( &mirrored[region.first], region.count );
+		int c = compare( &mirrored[region.first], &refs[region.first], region.count, region.count );
+		if( c < 0 )
+			std::copy( mirrored.begin() + region.first, mirrored.end(), refs.begin() + region.first );
+		else if( !c && region.labels )
+			region.ways = 2;
+		regions.push_back( region );
+	}
+	refTie.resize( refs.size() );
+	mirroredTie.resize( refs.size() );
+	for( unsigned r = 0; r < regions.size(); r++ )
+	{
+		markTies( refs, refTie, regions[r] );
+		markTies( mirrored, mirroredTie, regions[r] );
+	}
+
+	/* Regions sorted, then kept in that order within each group, the groups in the order their first regions come */
+	ranked.resize( regions.size() );
+	for( unsigned r = 0; r < regions.size(); r++ )
+	{
+		unsigned j = r;
+		for( ; j > 0 && compare( &refs[regions[r].first], &refs[regions[ranked[j - 1]].first], regions[r].count, regions[ranked[j - 1]].count ) < 0; j-- )
+			ranked[j] = ranked[j - 1];
+		ranked[j] = r;
+	}
+	order.clear();
+	groupBegin.clear();
+	regionUsed.assign( regions.size(), 0 );
+	for( unsigned i = 0; i < ranked.size(); i++ )
+	{
+		int g = root( ranked[i] );
+		if( regionUsed[g] )
+			continue;
+		regionUsed[g] = 1;
+		groupBegin.push_back( order.size() );
+		for( unsigned j = i; j < ranked.size(); j++ )
+			if( root( ranked[j] ) == g )
+				order.push_back( ranked[j] );
+	}
+	groupBegin.push_back( order.size() );
+	orderTie.resize( order.size() );
+	for( unsigned g = 0; g + 1 < groupBegin.size(); g++ )
+		for( int i = groupBegin[g]; i < groupBegin[g + 1]; i++ )
+			orderTie[i] = i > groupBegin[g] && !compare( &refs[regions[order[i]].first], &refs[regions[order[i - 1]].first], regions[order[i]].count, regions[order[i - 1]].count ) ? orderTie[i - 1] : i;
+
+	/* Each group settled apart (its labels are its own) with its labels named from 0, then the groups sorted by the
+	 * forms they wrote and written out, the labels of each numbered on from the ones before */
+	rename.assign( p.labels, -1 );
+	written.assign( p.labels, 0 );
+	named.clear();
+	tokens.clear();
+	regionUsed.assign( regions.size(), 0 );
+	boundaryUsed.assign( refs.size(), 0 );
+	if( tried.size() < refs.size() )
+		tried.resize( refs.size() );
+	if( triedRegions.size() < regions.size() )
+		triedRegions.resize( regions.size() );
+	forms.clear();
+	formBegin.clear();
+	for( unsigned g = 0; g + 1 < groupBegin.size(); g++ )
+	{
+		groupEnd = groupBegin[g + 1];
+		hasBest = false;
+		tied = true;
+		leaves = improvements = 0;
+		back = -1;
+		path.clear();
+		searchRegion( groupBegin[g], 0 );
+		formBegin.push_back( forms.size() );
+		forms.insert( forms.end(), best.begin(), best.end() );
+	}
+	formBegin.push_back( forms.size() );
+	int groups = formBegin.size() - 1;
+	groupOrder.resize( groups );
+	for( int g = 0; g < groups; g++ )
+	{
+		int j = g;
+		for( ; j > 0 && std::lexicographical_compare( forms.begin() + formBegin[g], forms.begin() + formBegin[g + 1],
+			forms.begin() + formBegin[groupOrder[j - 1]], forms.begin() + formBegin[groupOrder[j - 1] + 1] ); j-- )
+			groupOrder[j] = groupOrder[j - 1];
+		groupOrder[j] = g;
+	}
+
+	out.spots.clear();
+	out.boundaryEnd.clear();
+	out.regionEnd.clear();
+	out.labels = 0;
+	for( int g = 0; g < groups; g++ )
+	{
+		int base = out.labels;
+		for( int i = formBegin[groupOrder[g]]; i < formBegin[groupOrder[g] + 1]; i++ )
+			if( forms[i] == canonicalBoundary )
+				out.boundaryEnd.push_back( out.spots.size() );
+			else if( forms[i] == canonicalRegion )
+				out.regionEnd.push_back( out.boundaryEnd.size() );
+			else
+			{
+				int c = forms[i] - canonicalSpot;
+				if( c >= positionLabel )
+				{
+					c += base;
+					out.labels = std::max( out.labels, c - positionLabel + 1 );
+				}
+				out.spots.push_back( c );
+			}
+	}
+}
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <SDL/SDL.h>
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/file.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+/* A whole file mapped into memory : read-only, or read-write and created at a given size (zero filled) if missing.
+ * Several processes may map one file; the pages are shared, so nothing is read until it is touched. Only one of them
+ * may have it writable : a writer holds an exclusive lock on the file while it is open, and a second writer fails */
+class MappedFile
+{
+	private:
+		char *base;
+		size_t length;
+		bool writable;
+#ifdef _WIN32
+		HANDLE file, mapping;
+#else
+		int file;
+#endif
+
+	public:
+		/* Constructors */
+		MappedFile();
+		~MappedFile();
+
+		/* Public variables */
+		bool created;				// the last open made the file
+
+		/* Construction */
+		bool open(const char*, bool=false, size_t=0);	// path, writable, size for a new file (0 : the file must exist) - true if mapped, false too if another writer has it
+		void close();
+		void flush();				// push written pages to disk now
+
+		/* Queries */
+		bool isOpen() const { return base != NULL; }
+		char *data() const { return base; }
+		size_t size() const { return length; }
+};
+MappedFile::MappedFile()
+{
+	base = NULL;
+	length = 0;
+	writable = created = false;
+#ifdef _WIN32
+	file = mapping = NULL;
+#else
+	file = -1;
+#endif
+}
+MappedFile::~MappedFile()
+{
+	close();
+}
+bool MappedFile::open(const char *path, bool write, size_t newSize)
+{
+	close();
+	created = false;
+	if( write && newSize )
+	{
+		FILE *existing = fopen( path, "rb" );
+		if( existing )
+			fclose( existing );
+		else
+			created = true;
+	}
+	size_t size = created ? newSize : 0;
+#ifdef _WIN32
+	file = CreateFileA( path, write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, write ? FILE_SHARE_READ : FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, write ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );	// a writer shares with readers only
+	if( file == INVALID_HANDLE_VALUE )
+	{
+		file = NULL;
+		return false;
+	}
+	if( !size )
+	{
+		LARGE_INTEGER fileSize;
+		if( !GetFileSizeEx( file, &fileSize ) )
+		{
+			close();
+			return false;
+		}
+		size = (size_t)fileSize.QuadPart;
+	}
+	if( size )
+		mapping = CreateFileMappingA( file, NULL, write ? PAGE_READWRITE : PAGE_READONLY, (DWORD)((Uint64)size >> 32), (DWORD)size, NULL );
+	if( mapping )
+		base = (char*)MapViewOfFile( mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size );
+#else
+	file = ::open( path, write ? O_RDWR | O_CREAT : O_RDONLY, 0644 );
+	if( file < 0 )
+		return false;
+	if( write && flock( file, LOCK_EX | LOCK_NB ) != 0 )		// another writer : released when it closes the file
+	{
+		close();
+		return false;
+	}
+	struct stat info;
+	if( fstat( file, &info ) != 0 || (size && (size_t)info.st_size < size && ftruncate( file, size ) != 0) )		// a new file : grown with zeros
+	{
+		close();
+		return false;
+	}
+	if( !size )
+		size = info.st_size;
+	if( size )
+	{
+		void *mapped = mmap( NULL, size, write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0 );
+		base = mapped == MAP_FAILED ? NULL : (char*)mapped;
+	}
+#endif
+	if( !base )
+	{
+		close();
+		return false;
+	}
+	length = size;
+	writable = write;
+	return true;
+}
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if( base )
+		UnmapViewOfFile( base );
+	if( mapping )
+		CloseHandle( mapping );
+	if( file )
+		CloseHandle( file );
+	file = mapping = NULL;
+#else
+	if( base )
+		munmap( base, length );
+	if( file >= 0 )
+		::close( file );
+	file = -1;
+#endif
+	base = NULL;
+	length = 0;
+}
+void MappedFile::flush()
+{
+	if( !base || !writable )
+		return;
+#ifdef _WIN32
+	FlushViewOfFile( base, length );
+#else
+	msync( base, length, MS_SYNC );
+#endif
+}
+
+/* A file written whole before it is put in place : written under a temporary name and renamed over the old one at the
+ * end, so a reader (mapping it, say) sees the old file or the new one, never half of one. Tables and books are written so */
+class ReplacedFile
+{
+	private:
+		FILE *out;
+		std::string path, temporary;
+		bool failed;
+
+	public:
+		/* Constructors */
+		ReplacedFile();
+		~ReplacedFile();			// throws away a file not committed
+
+		/* Construction */
+		bool open(const char*);
+		void write(const void*, size_t, size_t);	// items, the size of one, how many (a failure shows at commit)
+		bool commit();				// true if all of it was written and it is in place of the old file
+};
+ReplacedFile::ReplacedFile()
+{
+	out = NULL;
+	failed = false;
+}
+ReplacedFile::~ReplacedFile()
+{
+	if( out )
+	{
+		fclose( out );
+		remove( temporary.c_str() );
+	}
+}
+bool ReplacedFile::open(const char *name)
+{
+	path = name;
+	temporary = path + ".tmp";
+	out = fopen( temporary.c_str(), "wb" );
+	failed = false;
+	return out != NULL;
+}
+void ReplacedFile::write(const void *data, size_t size, size_t count)
+{
+	if( out && !failed && count && fwrite( data, size, count, out ) != count )
+		failed = true;
+}
+bool ReplacedFile::commit()
+{
+	if( !out )
+		return false;
+	bool written = fclose( out ) == 0 && !failed;
+	out = NULL;
+	if( !written )
+	{
+		remove( temporary.c_str() );
+		return false;
+	}
+#ifdef _WIN32
+	remove( path.c_str() );		// rename does not replace a file here
+#endif
+	return rename( temporary.c_str(), path.c_str() ) == 0;
+}
+
+/* Solved positions on disk : an open addressing hash table in one file, keyed by canonical hash, mapped into memory
+ * so a lookup reads the mapped pages directly and opening the file reads nothing but the header.
+ * Records are written once and never changed (append-only) : a writer only fills empty slots, writing the checksum
+ * last, so a record torn by a crash fails its checksum and is skipped, and readers in other processes (mapping the
+ * file read-only) never see half a record. One writer at a time */
+
+/* Global constants for the database */
+static const int databaseBits = 22;				// 4M records, 64MB
+static const int databaseProbes = 64;			// slots looked at before a key is taken to be missing, or the table full
+static const Uint32 databaseVersion = 2;		// 2 : keyed by the unique canonical forms
+static const char databaseMagic[8] = { 'S','P','R','O','U','T','D','B' };
+/* End constants */
+
+enum databaseKind { databaseOutcome = 1, databaseNimber = 2 };
+
+struct databaseHeader
+{
+	char magic[8];
+	Uint32 version, bits, recordSize, reserved;
+	Uint64 count;			// records written, a hint only (not updated atomically with them)
+	Uint8 padding[32];
+};
+struct databaseRecord
+{
+	Uint64 key;
+	Uint8 kind;				// databaseKind, 0 in an empty slot
+	Sint8 value;			// outcome +1 / -1 for the player to move, or a nimber
+	Uint16 depth;			// lives left in the position : the most moves the game can still last
+	Uint32 check;			// checksum of the rest, never 0 in a written record
+};
+
+class PositionDatabase
+{
+	private:
+		MappedFile file;
+		char *base;					// file.data(), NULL while closed
+		Uint64 mask;
+		bool writable;
+
+		/* Private functions */
+		static Uint32 checksum(const databaseRecord&);
+		databaseHeader &header() const { return *(databaseHeader*)base; }
+		databaseRecord &slot(Uint64 i) const { return ((databaseRecord*)(base + sizeof(databaseHeader)))[i & mask]; }
+
+	public:
+		/* Constructors */
+		PositionDatabase();
+		~PositionDatabase();
+
+		/* Construction */
+		bool open(const char*, bool=false, int=databaseBits);	// map a database (read-only, or writable : created with 2^bits slots if missing)
+		void close();
+		bool store(Uint64, int, int, int);		// key, kind, value, depth - false if read-only, full, or already stored
+		void flush() { file.flush(); }			// push written records to disk now
+
+		/* Queries */
+		bool isOpen() const { return base != NULL; }
+		bool find(Uint64, int, int&, int&) const;	// key and kind : value and depth
+		Uint64 records() const { return base ? header().count : 0; }
+};
+PositionDatabase::PositionDatabase()
+{
+	base = NULL;
+	writable = false;
+}
+PositionDatabase::~PositionDatabase()
+{
+	close();
+}
+Uint32 PositionDatabase::checksum(const databaseRecord &r)
+{
+	Uint64 h = r.key ^ ((Uint64)r.kind << 56) ^ ((Uint64)(Uint8)r.value << 40) ^ ((Uint64)r.depth << 16);
+	h *= ((Uint64)0xFF51AFD7 << 32) | 0xED558CCD;
+	h ^= h >> 33;
+	return (Uint32)h | 1;
+}
+/* A new file gets its header once its size is set, magic last : a file without the magic is not a database */
+bool PositionDatabase::open(const char *path, bool write, int bits)
+{
+	close();
+	if( !file.open( path, write, sizeof(databaseHeader) + ((size_t)1 << bits)*sizeof(databaseRecord) ) || file.size() < sizeof(databaseHeader) )
+	{
+		close();
+		return false;
+	}
+	base = file.data();
+	databaseHeader &h = header();
+	if( file.created )
+	{
+		h.version = databaseVersion;
+		h.bits = bits;
+		h.recordSize = sizeof(databaseRecord);
+		h.count = 0;
+		flush();
+		memcpy( h.magic, databaseMagic, sizeof(databaseMagic) );
+		flush();
+	}
+	if( memcmp( h.magic, databaseMagic, sizeof(databaseMagic) ) || h.version != databaseVersion || h.recordSize != sizeof(databaseRecord)
+	 || file.size() < sizeof(databaseHeader) + ((size_t)1 << h.bits)*sizeof(databaseRecord) )
+	{
+		close();
+		return false;
+	}
+	mask = ((Uint64)1 << h.bits) - 1;
+	writable = write;
+	return true;
+}
+void PositionDatabase::close()
+{
+	file.close();
+	base = NULL;
+}
+bool PositionDatabase::find(Uint64 key, int kind, int &value, int &depth) const
+{
+	if( !base )
+		return false;
+	for( int i = 0; i < databaseProbes; i++ )
+	{
+		const databaseRecord &r = slot( key + i );
+		Uint32 check = __atomic_load_n( &r.check, __ATOMIC_ACQUIRE );
+		if( !check )		// empty : the key would have gone here
+			return false;
+		if( r.key == key && r.kind == kind && check == checksum( r ) )
+		{
+			value = r.value;
+			depth = r.depth;
+			return true;
+		}
+	}
+	return false;
+}
+bool PositionDatabase::store(Uint64 key, int kind, int value, int depth)
+{
+	if( !base || !writable )
+		return false;
+	for( int i = 0; i < databaseProbes; i++ )
+	{
+		databaseRecord &r = slot( key + i );
+		if( r.check )		// written, or torn by a crash : never written over
+		{
+			if( r.key == key && r.kind == kind && r.check == checksum( r ) )
+				return false;
+			continue;
+		}
+		r.key = key;
+		r.kind = kind;
+		r.value = value;
+		r.depth = depth;
+		__atomic_store_n( &r.check, checksum( r ), __ATOMIC_RELEASE );		// last : the record counts once this is in
+		header().count++;
+		return true;
+	}
+	return false;
+}
+
+#endif
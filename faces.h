@@ -0,0 +1,508 @@
+#ifndef FACES_H
+#define FACES_H
+
+#include <algorithm>
+#include <vector>
+#include "geometry.h"
+
+/* Regions of the board : a doubly connected edge list (DCEL) built from the curves
+ * This is the "right-hand rule" walk from gamePlan.txt - the curves leaving each spot are sorted by the direction
+ * from the spot to its control point, and a boundary is followed by always taking the next curve around the spot */
+
+struct boardSpot				// a spot (curve endpoint or isolated spot)
+{ double x, y; };
+
+struct boardCurve				// a curve between spots from and to (from == to for a loop)
+{ cubic c; int from, to; };
+
+struct board					// the drawn game, without any of the drawing state
+{
+	std::vector<boardSpot> spots;
+	std::vector<boardCurve> curves;
+};
+
+class PlanarMap
+{
+	public:
+		struct halfEdge
+		{
+			int origin;				// spot this half-edge leaves from
+			int twin, next, prev;	// the same curve the other way, and the neighbours along its boundary
+			int face;				// face on the left of it
+			int cycle;				// boundary cycle it belongs to
+			double angle;			// direction it leaves origin in
+			double tie;				// direction to a point a quarter of the way along, for curves leaving along the same tangent
+		};
+
+	private:
+		struct faceData
+		{ std::vector<int> boundaries; };	// one half-edge on each boundary cycle, or ~spot for an isolated spot
+
+		std::vector<boardSpot> spotList;
+		std::vector<cubic> curves;			// half-edge 2i traces curves[i], half-edge 2i+1 traces it backwards
+		std::vector<halfEdge> edges;
+		std::vector<faceData> faceList;		// face 0 is the unbounded face
+		std::vector<int> spotEdge;			// one half-edge leaving each spot, -1 for an isolated spot
+		std::vector<int> isolatedFace;		// face holding each isolated spot
+		std::vector<int> cycleEdge;			// one half-edge on each cycle
+		std::vector<double> cycleArea;		// signed area of each cycle (positive : the cycle is the outside of a bounded face)
+		std::vector<box> cycleBox;
+		std::vector<int> cycleRoot;			// connected piece of the drawing each cycle belongs to (named by one of its spots)
+
+		/* Private functions */
+		void traceCycle(int, int);			// number the cycle through a half-edge, measure its area and box
+		int findRoot(std::vector<int>&, int);
+		bool inCycle(int, double, double) const;	// nonzero winding number of the cycle around the point
+		int containingFace(int, double, double) const;	// smallest bounded face of another piece of the drawing around the point
+		void setFace(int, int);				// assign a face to every half-edge of a cycle
+		void initEdge(int, int);			// fill in origin, twin and direction of a half-edge of a stored curve
+		int clockwiseOf(int) const;			// half-edge at the same spot just clockwise of the given one (-1 : spot has no other curves)
+		int insert(int);					// link a half-edge into the order around its spot, returns the boundary it was drawn from
+		bool inBoundary(int, int) const;	// true if a boundary (half-edge or ~spot) lies inside a cycle
+		void moveBoundary(int, int);		// give a boundary a new face
+
+	public:
+		/* Constructors */
+		PlanarMap();
+
+		/* Construction */
+		void build(const board&);			// throw away the old structure and extract faces from the board
+
+		/* Moves - local updates, O(size of the face the move is in) */
+		int addSpot(double, double);		// new isolated spot, returns its index
+		int addCurve(const cubic&, int, int);	// new curve between two spots in one face, returns its index (-1 : the ends are in different faces - rebuild instead)
+		int splitCurve(int, const cubic&, const cubic&);	// replace a curve by its two halves (the first keeps the index, the second is added), returns the new middle spot
+
+		/* Queries */
+		int faces() const { return faceList.size(); }
+		int edgeCount() const { return edges.size(); }
+		const halfEdge &edge(int h) const { return edges[h]; }
+		const std::vector<int> &boundaries(int f) const { return faceList[f].boundaries; }
+		int faceOf(int h) const { return edges[h].face; }
+		int spots() const { return spotList.size(); }
+		const boardSpot &spot(int s) const { return spotList[s]; }
+		int leaving(int s) const { return spotEdge[s]; }		// one half-edge leaving the spot, -1 for an isolated spot
+		int counterClockwiseOf(int h) const { return edges[ edges[h].prev ].twin; }	// next half-edge around the same spot : the face left of h lies between them
+		int curveCount() const { return curves.size(); }
+		int spotFace(int) const;			// face an isolated spot lies in, or the face left of one of the spot's curves
+		cubic edgeCurve(int) const;			// the curve a half-edge traces, in its direction
+		void boundarySpots(int, std::vector<int>&) const;	// spots in order around a boundary (as stored in boundaries())
+		bool inFace(int, double, double) const;	// true if a point (not on a curve) lies in the face : inside its outside, outside its holes
+		int faceAt(double x, double y) const { return containingFace( -2, x, y ); }	// face a point (not on a curve) lies in
+};
+PlanarMap::PlanarMap()
+{
+	faceList.resize(1);		// an empty board is one unbounded face
+}
+inline cubic PlanarMap::edgeCurve(int h) const
+{
+	return h & 1 ? reverse( curves[h/2] ) : curves[h/2];
+}
+inline int PlanarMap::spotFace(int s) const
+{
+	return spotEdge[s] < 0 ? isolatedFace[s] : edges[spotEdge[s]].face;
+}
+void PlanarMap::boundarySpots(int boundary, std::vector<int> &out) const
+{
+	out.clear();
+	if( boundary < 0 )		// isolated spot
+	{
+		out.push_back( ~boundary );
+		return;
+	}
+	int h = boundary;
+	do
+	{
+		out.push_back( edges[h].origin );
+		h = edges[h].next;
+	} while( h != boundary );
+}
+
+/* Counter-clockwise order of half-edges leaving one spot */
+inline bool counterClockwise(const PlanarMap::halfEdge &a, const PlanarMap::halfEdge &b)
+{
+	if( a.angle != b.angle )
+		return a.angle < b.angle;
+	return a.tie < b.tie;
+}
+/* Ordering of half-edges around all spots : by origin, then counter-clockwise */
+struct halfEdgeOrder
+{
+	const std::vector<PlanarMap::halfEdge> *edges;
+	bool operator()(int a, int b) const
+	{
+		const PlanarMap::halfEdge &ea = (*edges)[a], &eb = (*edges)[b];
+		if( ea.origin != eb.origin )
+			return ea.origin < eb.origin;
+		return counterClockwise( ea, eb );
+	}
+};
+void PlanarMap::initEdge(int h, int origin)
+{
+	cubic c = edgeCurve(h);
+	double x, y;
+	edges[h].origin = origin;
+	edges[h].twin = h ^ 1;
+	edges[h].angle = tangentAngle( c );
+	evaluate( c, 0.25, x, y );
+	edges[h].tie = atan2( y - c.y[0], x - c.x[0] );
+	edges[h].cycle = edges[h].face = -1;
+}
+void PlanarMap::traceCycle(int start, int cycle)
+{
+	double a = 0;
+	box b = bounds( edgeCurve(start) );
+	int h = start;
+	do
+	{
+		cubic c = edgeCurve(h);
+		box cb = bounds(c);
+		edges[h].cycle = cycle;
+		a += area(c);
+		b.x0 = std::min( b.x0, cb.x0 );	b.y0 = std::min( b.y0, cb.y0 );
+		b.x1 = std::max( b.x1, cb.x1 );	b.y1 = std::max( b.y1, cb.y1 );
+		h = edges[h].next;
+	} while( h != start );
+	cycleEdge.push_back( start );
+	cycleArea.push_back( a );
+	cycleBox.push_back( b );
+	cycleRoot.push_back( -1 );		// filled in by build() (only needed while building)
+}
+int PlanarMap::findRoot(std::vector<int> &parent, int s)
+{
+	while( parent[s] != s )
+		s = parent[s] = parent[parent[s]];
+	return s;
+}
+/* Winding number of the cycle around (x,y) from signed crossings of one ray - this replaces the column scan in gamePlan.txt
+ * A curve travelled both ways (a dangling line inside a face) cancels itself out */
+bool PlanarMap::inCycle(int cycle, double x, double y) const
+{
+	const box &b = cycleBox[cycle];
+	if( x < b.x0 || x > b.x1 || y < b.y0 || y > b.y1 )
+		return false;
+	int winding = 0, h = cycleEdge[cycle];
+	do
+	{
+		winding += rayCrossings( edgeCurve(h), x, y );
+		h = edges[h].next;
+	} while( h != cycleEdge[cycle] );
+	return winding != 0;
+}
+bool PlanarMap::inFace(int f, double x, double y) const
+{
+	const std::vector<int> &b = faceList[f].boundaries;
+	for( unsigned i = 0; i < b.size(); i++ )
+	{
+		if( b[i] < 0 )		// isolated spot : no area
+			continue;
+		bool in = inCycle( edges[b[i]].cycle, x, y );
+		if( i == 0 && f != 0 ? !in : in )		// outside the outside, or inside a hole
+			return false;
+	}
+	return true;
+}
+void PlanarMap::setFace(int cycle, int f)
+{
+	int h = cycleEdge[cycle];
+	do
+	{
+		edges[h].face = f;
+		h = edges[h].next;
+	} while( h != cycleEdge[cycle] );
+}
+int PlanarMap::containingFace(int root, double x, double y) const
+{
+	int best = 0;
+	double bestArea = 0;
+	for( unsigned f = 1; f < faceList.size(); f++ )
+	{
+		int cycle = edges[ faceList[f].boundaries[0] ].cycle;	// a bounded face's first boundary is its outside
+		if( cycleRoot[cycle] == root )	// the point is on this piece, not inside it
+			continue;
+		if( (best == 0 || cycleArea[cycle] < bestArea) && inCycle( cycle, x, y ) )
+		{
+			best = f;
+			bestArea = cycleArea[cycle];
+		}
+	}
+	return best;
+}
+void PlanarMap::build(const board &bd)
+{
+	int n = bd.spots.size(), m = bd.curves.size();
+	spotList = bd.spots;
+	curves.resize( m );
+	edges.resize( 2*m );
+	faceList.assign( 1, faceData() );
+	spotEdge.assign( n, -1 );
+	isolatedFace.assign( n, 0 );
+	cycleEdge.clear();
+	cycleArea.clear();
+	cycleBox.clear();
+	cycleRoot.clear();
+
+	/* Two half-edges per curve, sorted around their spots */
+	std::vector<int> order( 2*m );
+	for( int i = 0; i < m; i++ )
+	{
+		curves[i] = bd.curves[i].c;
+		for( int k = 0; k < 2; k++ )
+		{
+			int h = 2*i + k;
+			initEdge( h, k ? bd.curves[i].to : bd.curves[i].from );
+			order[h] = h;
+			spotEdge[ edges[h].origin ] = h;
+		}
+	}
+	halfEdgeOrder byAngle = { &edges };
+	std::sort( order.begin(), order.end(), byAngle );
+	for( int first = 0, last; first < 2*m; first = last )
+	{
+		for( last = first + 1; last < 2*m && edges[order[last]].origin == edges[order[first]].origin; last++ )
+			;
+		for( int k = first; k < last; k++ )		// arriving along the twin of order[k], keep the face on the left : leave along the next one clockwise
+		{
+			int in = edges[order[k]].twin, out = order[ k > first ? k - 1 : last - 1 ];
+			edges[in].next = out;
+			edges[out].prev = in;
+		}
+	}
+
+	/* Boundary cycles */
+	for( int h = 0; h < 2*m; h++ )
+		if( edges[h].cycle < 0 )
+			traceCycle( h, cycleEdge.size() );
+
+	/* Connected pieces of the drawing : every piece has one outside cycle (least area), the rest bound faces */
+	std::vector<int> parent( n ), outside( n, -1 );
+	for( int s = 0; s < n; s++ )
+		parent[s] = s;
+	for( int i = 0; i < m; i++ )
+		parent[ findRoot( parent, bd.curves[i].from ) ] = findRoot( parent, bd.curves[i].to );
+	for( unsigned c = 0; c < cycleEdge.size(); c++ )
+	{
+		int root = findRoot( parent, edges[cycleEdge[c]].origin );
+		if( outside[root] < 0 || cycleArea[c] < cycleArea[outside[root]] )
+			outside[root] = c;
+	}
+	for( unsigned c = 0; c < cycleEdge.size(); c++ )
+	{
+		int root = findRoot( parent, edges[cycleEdge[c]].origin );
+		cycleRoot[c] = root;
+		if( outside[root] == (int)c )
+			continue;
+		faceData f;
+		f.boundaries.push_back( cycleEdge[c] );
+		faceList.push_back( f );
+		setFace( c, faceList.size() - 1 );
+	}
+
+	/* Each piece's outside cycle (or the isolated spot itself) is an extra boundary of the face it sits in */
+	for( int s = 0; s < n; s++ )
+	{
+		if( findRoot( parent, s ) != s )
+			continue;
+		int c = outside[s], f;
+		if( c < 0 )		// isolated spot
+		{
+			f = containingFace( s, spotList[s].x, spotList[s].y );
+			faceList[f].boundaries.push_back( ~s );
+			isolatedFace[s] = f;
+			continue;
+		}
+		const boardSpot &p = spotList[ edges[cycleEdge[c]].origin ];
+		f = containingFace( s, p.x, p.y );
+		faceList[f].boundaries.push_back( cycleEdge[c] );
+		setFace( c, f );
+	}
+}
+
+/* Incremental updates
+ * A Sprouts move draws one curve inside one face. If its ends are on two different boundaries of the face (or an end
+ * is an isolated spot) the boundaries merge into one and the face count stays the same; if both ends are on the same
+ * boundary the face is cut in two and only that face's other boundaries need to be sorted between the halves */
+
+int PlanarMap::clockwiseOf(int h) const
+{
+	int v = edges[h].origin, first = spotEdge[v], best = -1, last = -1;
+	if( first < 0 )
+		return -1;
+	int e = first;
+	do		// visit the curves around v clockwise (the face on the left of e continues out along next(twin(e)))
+	{
+		if( e != h )
+		{
+			if( counterClockwise( edges[e], edges[h] ) && (best < 0 || counterClockwise( edges[best], edges[e] )) )
+				best = e;		// largest angle below h
+			if( last < 0 || counterClockwise( edges[last], edges[e] ) )
+				last = e;		// largest angle overall : h is below everything, so wrap around to it
+		}
+		e = edges[ edges[e].twin ].next;
+	} while( e != first );
+	return best >= 0 ? best : last;
+}
+int PlanarMap::insert(int h)
+{
+	int v = edges[h].origin, t = edges[h].twin;
+	int cw = clockwiseOf(h), from;
+	if( cw < 0 )		// first curve at an isolated spot
+	{
+		from = ~v;
+		edges[t].next = h;
+		edges[h].prev = t;
+	}
+	else		// the new curve goes between cw and the curve counter-clockwise of it, in the face left of cw
+	{
+		int in = edges[cw].prev;		// arrives at v and continued out along cw
+		from = edges[cw].cycle;
+		edges[in].next = h;
+		edges[h].prev = in;
+		edges[t].next = cw;
+		edges[cw].prev = t;
+	}
+	spotEdge[v] = h;
+	return from;
+}
+/* A boundary that is not the one being cut lies wholly on one side of the cut : test one of its spots */
+bool PlanarMap::inBoundary(int boundary, int cycle) const
+{
+	const boardSpot &p = spotList[ boundary < 0 ? ~boundary : edges[boundary].origin ];
+	return inCycle( cycle, p.x, p.y );
+}
+void PlanarMap::moveBoundary(int boundary, int f)
+{
+	if( boundary < 0 )
+		isolatedFace[~boundary] = f;
+	else
+		setFace( edges[boundary].cycle, f );
+}
+int PlanarMap::addSpot(double x, double y)
+{
+	boardSpot s = { x, y };
+	int f = containingFace( -2, x, y );
+	spotList.push_back( s );
+	spotEdge.push_back( -1 );
+	isolatedFace.push_back( f );
+	faceList[f].boundaries.push_back( ~(int)(spotList.size() - 1) );
+	return spotList.size() - 1;
+}
+int PlanarMap::addCurve(const cubic &c, int from, int to)
+{
+	int i = curves.size(), h = 2*i, t = h + 1;
+	curves.push_back( c );
+	edges.resize( edges.size() + 2 );
+	initEdge( h, from );
+	initEdge( t, to );
+
+	/* Both ends must open into the same face */
+	int cwFrom = clockwiseOf(h), cwTo = clockwiseOf(t);
+	int f = cwFrom < 0 ? isolatedFace[from] : edges[cwFrom].face;
+	if( f != (cwTo < 0 ? isolatedFace[to] : edges[cwTo].face) )
+	{
+		curves.pop_back();
+		edges.resize( edges.size() - 2 );
+		return -1;
+	}
+	int boundaryFrom = insert(h), boundaryTo = insert(t);
+	if( from == to )		// both ends of a loop open into one face at one spot : that is one boundary
+		boundaryTo = boundaryFrom;
+	std::vector<int> &bounds = faceList[f].boundaries;
+	int cycleFrom = cycleEdge.size();
+	traceCycle( h, cycleFrom );
+	if( edges[t].cycle == cycleFrom )		// merge : two boundaries of f became one
+	{
+		bool outside = false;
+		unsigned k = 0;
+		for( unsigned b = 0; b < bounds.size(); b++ )
+		{
+			if( bounds[b] < 0 ? bounds[b] == boundaryFrom || bounds[b] == boundaryTo : edges[bounds[b]].cycle == cycleFrom )
+			{
+				outside = outside || (f != 0 && b == 0);	// the outside of a bounded face merged with a piece inside it : still its outside
+				continue;
+			}
+			bounds[k++] = bounds[b];
+		}
+		bounds.resize( k );
+		bounds.insert( outside ? bounds.begin() : bounds.end(), h );
+		setFace( cycleFrom, f );
+		return i;
+	}
+
+	/* Split : f keeps one side, a new face g gets the other */
+	int cycleTo = cycleEdge.size();
+	traceCycle( t, cycleTo );
+	unsigned cut = 0;		// the boundary that was cut (its half-edges are on one of the new cycles now)
+	while( cut < bounds.size() && (bounds[cut] < 0 ? bounds[cut] != boundaryFrom : edges[bounds[cut]].cycle != cycleFrom && edges[bounds[cut]].cycle != cycleTo) )
+		cut++;
+	int g = faceList.size(), inner, outer;		// inner : the cycle that becomes g's outside
+	faceList.push_back( faceData() );
+	std::vector<int> &oldBounds = faceList[f].boundaries, &newBounds = faceList[g].boundaries;
+	if( f != 0 && cut == 0 )		// cut across f's own outside : both halves are bounded faces
+	{
+		inner = cycleTo;
+		outer = cycleFrom;
+	}
+	else		// cut from a piece inside f back to itself : the side with positive area is a new bounded face
+	{
+		inner = cycleArea[cycleFrom] > cycleArea[cycleTo] ? cycleFrom : cycleTo;
+		outer = inner == cycleFrom ? cycleTo : cycleFrom;
+	}
+	oldBounds[cut] = cycleEdge[outer];
+	newBounds.push_back( cycleEdge[inner] );
+	setFace( outer, f );
+	setFace( inner, g );
+	unsigned k = 0;
+	for( unsigned b = 0; b < oldBounds.size(); b++ )
+	{
+		if( b != cut && inBoundary( oldBounds[b], inner ) )
+		{
+			newBounds.push_back( oldBounds[b] );
+			moveBoundary( oldBounds[b], g );
+		}
+		else
+			oldBounds[k++] = oldBounds[b];
+	}
+	oldBounds.resize( k );
+	return i;
+}
+int PlanarMap::splitCurve(int i, const cubic &first, const cubic &second)
+{
+	int s = spotList.size(), j = curves.size();
+	int h = 2*i, t = h + 1, h2 = 2*j, t2 = h2 + 1;
+	int to = edges[t].origin, next = edges[h].next, prev = edges[t].prev;
+	boardSpot p = { first.x[3], first.y[3] };
+	spotList.push_back( p );
+	isolatedFace.push_back( 0 );
+	spotEdge.push_back( t );
+	curves[i] = first;
+	curves.push_back( second );
+	edges.resize( edges.size() + 2 );
+
+	/* h : from -> s, then h2 : s -> to  |  t2 : to -> s, then t : s -> from */
+	initEdge( h2, s );
+	initEdge( t2, to );
+	edges[h2].face = edges[h].face;		edges[h2].cycle = edges[h].cycle;
+	edges[t2].face = edges[t].face;		edges[t2].cycle = edges[t].cycle;
+	int from = edges[h].origin, face = edges[h].face, cycle = edges[h].cycle;
+	initEdge( h, from );
+	edges[h].face = face;	edges[h].cycle = cycle;
+	face = edges[t].face;	cycle = edges[t].cycle;
+	initEdge( t, s );
+	edges[t].face = face;	edges[t].cycle = cycle;
+
+	if( next == t )			// the curve was a dead end at to : it now turns around on the second half
+	{
+		next = t2;
+		prev = h2;
+	}
+	edges[h].next = h2;		edges[h2].prev = h;
+	edges[h2].next = next;	edges[next].prev = h2;
+	edges[prev].next = t2;	edges[t2].prev = prev;
+	edges[t2].next = t;		edges[t].prev = t2;
+	if( spotEdge[to] == t )
+		spotEdge[to] = t2;
+	return s;
+}
+
+#endif
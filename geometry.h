@@ -0,0 +1,437 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/* Floating point geometry on cubic Bezier curves - the drawing code in bezier.h works on the int control points,
+ * everything that has to be exact-ish (crossings, regions, routing) works on a cubic copied out of a bLine */
+
+/* Global constants for the geometric tests */
+static const double flatTolerance = 0.2;		// control points within this many pixels of the chord : treat curve as a line segment
+static const double touchTolerance = 2.0;		// crossings within this many pixels of a shared spot are the spot itself, not a crossing
+static const int maxSubdivision = 32;			// recursion limit for subdivision (2^-32 of a curve is far below a pixel)
+/* End constants */
+
+struct cubic				// control points P0..P3 of a cubic Bezier curve
+{ double x[4], y[4]; };
+
+struct box					// axis aligned bounding box
+{ double x0, y0, x1, y1; };
+
+struct crossing				// a point where curve a (at parameter s) meets curve b (at parameter t)
+{ double s, t, x, y; };
+
+/* Point on the curve at parameter t (de Casteljau, same polynomial as drawLines) */
+inline void evaluate(const cubic &c, double t, double &x, double &y)
+{
+	double u = 1 - t;
+	x = u*u*u*c.x[0] + 3*u*u*t*c.x[1] + 3*u*t*t*c.x[2] + t*t*t*c.x[3];
+	y = u*u*u*c.y[0] + 3*u*u*t*c.y[1] + 3*u*t*t*c.y[2] + t*t*t*c.y[3];
+}
+
+/* Box around the control polygon - the curve lies inside its convex hull, so this always contains the curve */
+inline box bounds(const cubic &c)
+{
+	box b = { c.x[0], c.y[0], c.x[0], c.y[0] };
+	for( int i = 1; i < 4; i++ )
+	{
+		if( c.x[i] < b.x0 ) b.x0 = c.x[i];
+		if( c.x[i] > b.x1 ) b.x1 = c.x[i];
+		if( c.y[i] < b.y0 ) b.y0 = c.y[i];
+		if( c.y[i] > b.y1 ) b.y1 = c.y[i];
+	}
+	return b;
+}
+
+inline bool overlaps(const box &a, const box &b, double tolerance = 0)
+{
+	return a.x0 <= b.x1 + tolerance && b.x0 <= a.x1 + tolerance && a.y0 <= b.y1 + tolerance && b.y0 <= a.y1 + tolerance;
+}
+
+/* Split c at t into [P0 .. c(t)] and [c(t) .. P3] - the same construction as Bezier::splitLine, without rounding */
+inline void subdivide(const cubic &c, double t, cubic &left, cubic &right)
+{
+	double u = 1 - t;
+	for( int k = 0; k < 2; k++ )
+	{
+		const double *p = k ? c.y : c.x;
+		double *l = k ? left.y : left.x,
+			   *r = k ? right.y : right.x;
+		double p01 = u*p[0] + t*p[1], p12 = u*p[1] + t*p[2], p23 = u*p[2] + t*p[3];
+		double p012 = u*p01 + t*p12, p123 = u*p12 + t*p23;
+		l[0] = p[0];	l[1] = p01;		l[2] = p012;	l[3] = u*p012 + t*p123;
+		r[0] = l[3];	r[1] = p123;	r[2] = p23;		r[3] = p[3];
+	}
+}
+
+/* The same curve traced from P3 back to P0 */
+inline cubic reverse(const cubic &c)
+{
+	cubic r;
+	for( int i = 0; i < 4; i++ )
+	{
+		r.x[i] = c.x[3 - i];
+		r.y[i] = c.y[3 - i];
+	}
+	return r;
+}
+
+/* Direction the curve leaves P0 in : towards the first control point that is not on top of P0 */
+inline double tangentAngle(const cubic &c)
+{
+	for( int i = 1; i < 4; i++ )
+		if( c.x[i] != c.x[0] || c.y[i] != c.y[0] )
+			return atan2( c.y[i] - c.y[0], c.x[i] - c.x[0] );
+	return 0;
+}
+
+/* Signed area swept between the curve and the origin : (1/2) integral of x dy - y dx
+ * Summed around a closed chain of curves this is the enclosed area (positive when traced counter-clockwise in x,y)
+ * The integrand is a degree 5 polynomial, so 3 point Gauss-Legendre quadrature is exact */
+inline double area(const cubic &c)
+{
+	static const double nodes[3] = { 0.5 - 0.3872983346207417, 0.5, 0.5 + 0.3872983346207417 },
+						weights[3] = { 5.0/18, 8.0/18, 5.0/18 };
+	double sum = 0;
+	for( int i = 0; i < 3; i++ )
+	{
+		double t = nodes[i], u = 1 - t, x, y;
+		evaluate( c, t, x, y );
+		double dx = 3*( u*u*(c.x[1] - c.x[0]) + 2*u*t*(c.x[2] - c.x[1]) + t*t*(c.x[3] - c.x[2]) ),
+			   dy = 3*( u*u*(c.y[1] - c.y[0]) + 2*u*t*(c.y[2] - c.y[1]) + t*t*(c.y[3] - c.y[2]) );
+		sum += weights[i]*(x*dy - y*dx);
+	}
+	return sum/2;
+}
+
+/* True if both inner control points lie within tolerance of the chord P0-P3 */
+inline bool flat(const cubic &c, double tolerance = flatTolerance)
+{
+	double dx = c.x[3] - c.x[0], dy = c.y[3] - c.y[0];
+	double len2 = dx*dx + dy*dy;
+	for( int i = 1; i < 3; i++ )
+	{
+		double ex = c.x[i] - c.x[0], ey = c.y[i] - c.y[0];
+		double d2;
+		if( len2 == 0 )		// chord is a point : use distance to it
+			d2 = ex*ex + ey*ey;
+		else
+		{
+			double cross = dx*ey - dy*ex;
+			d2 = cross*cross / len2;
+		}
+		if( d2 > tolerance*tolerance )
+			return false;
+	}
+	return true;
+}
+
+/* Intersect segments (ax0,ay0)-(ax1,ay1) and (bx0,by0)-(bx1,by1) : on success s and t are the parameters along each
+ * Collinear segments that overlap cross too (two lines drawn along one another share a stretch, not just a point) :
+ * s and t are then where the overlap starts along a */
+inline bool segmentsCross(double ax0, double ay0, double ax1, double ay1, double bx0, double by0, double bx1, double by1, double &s, double &t)
+{
+	double rx = ax1 - ax0, ry = ay1 - ay0,
+		   qx = bx1 - bx0, qy = by1 - by0;
+	double denom = rx*qy - ry*qx;
+	double wx = bx0 - ax0, wy = by0 - ay0;
+	if( denom == 0 )	// parallel, or a degenerate segment
+	{
+		double rr = rx*rx + ry*ry, qq = qx*qx + qy*qy;
+		if( rr == 0 || qq == 0 || wx*ry - wy*rx != 0 )		// a point, or parallel on different lines
+			return false;
+		double t0 = (wx*rx + wy*ry) / rr, t1 = t0 + (qx*rx + qy*ry) / rr;	// b's ends along a
+		double lo = std::max( 0.0, std::min( t0, t1 ) ), hi = std::min( 1.0, std::max( t0, t1 ) );
+		if( lo > hi )
+			return false;
+		s = lo;
+		t = ((ax0 + rx*s - bx0)*qx + (ay0 + ry*s - by0)*qy) / qq;
+		return true;
+	}
+	s = (wx*qy - wy*qx) / denom;
+	t = (wx*ry - wy*rx) / denom;
+	return s >= 0 && s <= 1 && t >= 0 && t <= 1;
+}
+
+/* Recursive part of intersect() : a covers parameters [a0,a1] of the original first curve, b covers [b0,b1] of the second */
+inline void intersectPieces(const cubic &a, double a0, double a1, const cubic &b, double b0, double b1, int depth, std::vector<crossing> &hits, unsigned maxHits)
+{
+	if( hits.size() >= maxHits || !overlaps( bounds(a), bounds(b) ) )
+		return;
+	bool aFlat = flat(a), bFlat = flat(b);
+	if( (aFlat && bFlat) || depth >= maxSubdivision )	// both pieces are (nearly) straight : intersect their chords
+	{
+		double s, t;
+		if( segmentsCross( a.x[0],a.y[0], a.x[3],a.y[3], b.x[0],b.y[0], b.x[3],b.y[3], s, t ) )
+		{
+			crossing c;
+			c.s = a0 + (a1 - a0)*s;
+			c.t = b0 + (b1 - b0)*t;
+			c.x = a.x[0] + (a.x[3] - a.x[0])*s;
+			c.y = a.y[0] + (a.y[3] - a.y[0])*s;
+			for( unsigned i = 0; i < hits.size(); i++ )		// a crossing on a subdivision boundary is found by both halves
+				if( fabs(hits[i].x - c.x) < flatTolerance && fabs(hits[i].y - c.y) < flatTolerance )
+					return;
+			hits.push_back( c );
+		}
+		return;
+	}
+	cubic l, r;
+	double am = (a0 + a1)/2, bm = (b0 + b1)/2;
+	if( aFlat )				// only b needs splitting
+	{
+		subdivide( b, 0.5, l, r );
+		intersectPieces( a, a0, a1, l, b0, bm, depth + 1, hits, maxHits );
+		intersectPieces( a, a0, a1, r, bm, b1, depth + 1, hits, maxHits );
+	}
+	else if( bFlat )		// only a needs splitting
+	{
+		subdivide( a, 0.5, l, r );
+		intersectPieces( l, a0, am, b, b0, b1, depth + 1, hits, maxHits );
+		intersectPieces( r, am, a1, b, b0, b1, depth + 1, hits, maxHits );
+	}
+	else
+	{
+		cubic bl, br;
+		subdivide( a, 0.5, l, r );
+		subdivide( b, 0.5, bl, br );
+		intersectPieces( l, a0, am, bl, b0, bm, depth + 1, hits, maxHits );
+		intersectPieces( l, a0, am, br, bm, b1, depth + 1, hits, maxHits );
+		intersectPieces( r, am, a1, bl, b0, bm, depth + 1, hits, maxHits );
+		intersectPieces( r, am, a1, br, bm, b1, depth + 1, hits, maxHits );
+	}
+}
+
+/* Find up to maxHits points where a and b meet (bounding box pruning + recursive subdivision)
+ * Returns the number of crossings appended to hits */
+inline int intersect(const cubic &a, const cubic &b, std::vector<crossing> &hits, unsigned maxHits = 16)
+{
+	unsigned before = hits.size();
+	intersectPieces( a, 0, 1, b, 0, 1, 0, hits, before + maxHits );
+	return hits.size() - before;
+}
+
+/* True if c passes through (x,y) : within touchTolerance */
+inline bool touches(const crossing &c, double x, double y)
+{
+	return (c.x - x)*(c.x - x) + (c.y - y)*(c.y - y) <= touchTolerance*touchTolerance;
+}
+
+/* True if a and b cross anywhere other than at the spots they share (curves joined at a spot always "meet" there)
+ * sharedX/sharedY hold the coordinates of up to two shared spots */
+inline bool crosses(const cubic &a, const cubic &b, int shared = 0, const double *sharedX = 0, const double *sharedY = 0)
+{
+	std::vector<crossing> hits;
+	if( !overlaps( bounds(a), bounds(b) ) )
+		return false;
+	intersect( a, b, hits, 32 );
+	for( unsigned i = 0; i < hits.size(); i++ )
+	{
+		bool atSpot = false;
+		for( int k = 0; k < shared; k++ )
+			if( touches( hits[i], sharedX[k], sharedY[k] ) )
+				atSpot = true;
+		if( !atSpot )
+			return true;
+	}
+	return false;
+}
+
+/* Parameters in (0,1) where x'(t) = 0 or y'(t) = 0, sorted : between them the curve is monotone in both x and y */
+inline int extrema(const cubic &c, double *ts)
+{
+	int n = 0;
+	for( int k = 0; k < 2; k++ )
+	{
+		const double *p = k ? c.y : c.x;
+		/* derivative / 3 = A t^2 + B t + C */
+		double A = -p[0] + 3*p[1] - 3*p[2] + p[3],
+			   B = 2*(p[0] - 2*p[1] + p[2]),
+			   C = p[1] - p[0];
+		if( fabs(A) < 1e-12 )
+		{
+			if( fabs(B) > 1e-12 )
+				ts[n++] = -C/B;
+		}
+		else
+		{
+			double disc = B*B - 4*A*C;
+			if( disc >= 0 )
+			{
+				double sq = sqrt(disc);
+				ts[n++] = (-B + sq)/(2*A);
+				ts[n++] = (-B - sq)/(2*A);
+			}
+		}
+	}
+	int m = 0;
+	for( int i = 0; i < n; i++ )		// keep only interior parameters
+		if( ts[i] > 1e-9 && ts[i] < 1 - 1e-9 )
+			ts[m++] = ts[i];
+	std::sort( ts, ts + m );
+	return m;
+}
+
+/* True if the curve crosses itself (a loop)
+ * A loop needs the curve to turn back in both x and y, so it never lies within two neighbouring monotone pieces :
+ * split at the extrema and test every pair of pieces that are not neighbours */
+inline bool selfIntersects(const cubic &c)
+{
+	double ts[6];
+	int n = extrema( c, ts );
+	if( n < 2 )
+		return false;
+	cubic pieces[5], rest = c, r;
+	double done = 0;
+	int m = 0;
+	for( int i = 0; i < n; i++ )
+	{
+		if( ts[i] - done < 1e-9 )	// x and y turn at the same parameter
+			continue;
+		subdivide( rest, (ts[i] - done)/(1 - done), pieces[m++], r );
+		rest = r;
+		done = ts[i];
+	}
+	pieces[m] = rest;
+	n = m;
+	bool closed = c.x[0] == c.x[3] && c.y[0] == c.y[3];	// loop from a spot back to itself : the ends may touch
+	for( int i = 0; i <= n; i++ )
+		for( int j = i + 2; j <= n; j++ )
+			if( closed && i == 0 && j == n ? crosses( pieces[i], pieces[j], 1, c.x, c.y ) : crosses( pieces[i], pieces[j] ) )
+				return true;
+	return false;
+}
+
+/* Distance from a point to the curve, and the parameter of the nearest point on it :
+ * the best of a few samples, then a ternary search between its neighbours (one minimum that close) */
+inline double distanceTo(const cubic &c, double x, double y, double &t)
+{
+	const int samples = 32;
+	double best = -1, cx, cy;
+	for( int i = 0; i <= samples; i++ )
+	{
+		evaluate( c, (double)i/samples, cx, cy );
+		double d = (cx - x)*(cx - x) + (cy - y)*(cy - y);
+		if( best < 0 || d < best )
+		{
+			best = d;
+			t = (double)i/samples;
+		}
+	}
+	double lo = std::max( 0.0, t - 1.0/samples ), hi = std::min( 1.0, t + 1.0/samples );
+	for( int i = 0; i < 40; i++ )
+	{
+		double m1 = lo + (hi - lo)/3, m2 = hi - (hi - lo)/3, x1, y1, x2, y2;
+		evaluate( c, m1, x1, y1 );
+		evaluate( c, m2, x2, y2 );
+		if( (x1 - x)*(x1 - x) + (y1 - y)*(y1 - y) < (x2 - x)*(x2 - x) + (y2 - y)*(y2 - y) )
+			hi = m2;
+		else
+			lo = m1;
+	}
+	t = (lo + hi)/2;
+	evaluate( c, t, cx, cy );
+	return sqrt( (cx - x)*(cx - x) + (cy - y)*(cy - y) );
+}
+
+/* Real roots of a t^3 + b t^2 + c t + d = 0 (Cardano, or the trigonometric form when there are three), returns how many */
+inline int solveCubic(double a, double b, double c, double d, double *roots)
+{
+	if( fabs(a) < 1e-12 )		// quadratic (or linear) : the curve's y is at most a parabola
+	{
+		if( fabs(b) < 1e-12 )
+		{
+			if( fabs(c) < 1e-12 )
+				return 0;
+			roots[0] = -d/c;
+			return 1;
+		}
+		double disc = c*c - 4*b*d;
+		if( disc < 0 )
+			return 0;
+		double sq = sqrt(disc);
+		roots[0] = (-c + sq)/(2*b);
+		roots[1] = (-c - sq)/(2*b);
+		return 2;
+	}
+	b /= a;	c /= a;	d /= a;
+	double p = c - b*b/3, q = 2*b*b*b/27 - b*c/3 + d, shift = -b/3;	// t = s + shift gives s^3 + p s + q = 0
+	double disc = q*q/4 + p*p*p/27;
+	if( disc > 0 )		// one real root
+	{
+		double sq = sqrt(disc), u = -q/2 + sq, v = -q/2 - sq;
+		roots[0] = (u < 0 ? -pow(-u, 1.0/3) : pow(u, 1.0/3)) + (v < 0 ? -pow(-v, 1.0/3) : pow(v, 1.0/3)) + shift;
+		return 1;
+	}
+	if( p > -1e-300 )	// p == 0 and q == 0 : a triple root
+	{
+		roots[0] = shift;
+		return 1;
+	}
+	double r = 2*sqrt(-p/3), cosine = 3*q/(p*r);
+	double phi = acos( std::max( -1.0, std::min( 1.0, cosine ) ) )/3;
+	for( int k = 0; k < 3; k++ )
+		roots[k] = r*cos( phi - 2.0943951023931957*k ) + shift;	// 2 pi / 3 apart
+	return 3;
+}
+
+/* Signed crossings of the ray from (x,y) towards +x with the curve : +1 for each place it passes upwards (towards +y), -1 downwards
+ * The curve is cut where y turns, and each y-monotone piece counts when its ends lie on opposite sides of y (half open : y <= ray
+ * is one side), so two curves joined end to end count a crossing at their shared spot exactly once.
+ * Summed around a closed boundary this is its winding number around the point */
+inline int rayCrossings(const cubic &c, double x, double y)
+{
+	box b = bounds(c);
+	if( y < b.y0 || y > b.y1 || x > b.x1 )		// the ray misses the curve's box
+		return 0;
+	if( x < b.x0 )		// the whole curve is right of the point : every crossing counts, and they add up to where the ends lie
+		return (c.y[3] > y) - (c.y[0] > y);
+	/* y(t) in power form : a t^3 + b t^2 + c t + d */
+	double ya = -c.y[0] + 3*c.y[1] - 3*c.y[2] + c.y[3],
+		   yb = 3*c.y[0] - 6*c.y[1] + 3*c.y[2],
+		   yc = 3*c.y[1] - 3*c.y[0],
+		   yd = c.y[0];
+	double ts[4], ys[4];			// ends of the monotone pieces and y at them
+	int n = 0;
+	ts[n++] = 0;
+	double turns[2];
+	int m = solveCubic( 0, 3*ya, 2*yb, yc, turns );		// dy/dt = 0
+	if( m == 2 && turns[0] > turns[1] )
+		std::swap( turns[0], turns[1] );
+	for( int i = 0; i < m; i++ )
+		if( turns[i] > 1e-9 && turns[i] < 1 - 1e-9 && turns[i] > ts[n-1] )
+			ts[n++] = turns[i];
+	ts[n++] = 1;
+	ys[0] = c.y[0];
+	ys[n-1] = c.y[3];
+	for( int i = 1; i < n - 1; i++ )
+		ys[i] = ((ya*ts[i] + yb)*ts[i] + yc)*ts[i] + yd;
+
+	double roots[3];
+	int k = -1, winding = 0;		// roots solved on the first straddling piece only
+	for( int i = 0; i + 1 < n; i++ )
+	{
+		if( (ys[i] <= y) == (ys[i+1] <= y) )
+			continue;
+		if( k < 0 )
+			k = solveCubic( ya, yb, yc, yd - y, roots );
+		double t = (ts[i] + ts[i+1])/2, best = 2;	// the piece is monotone, so exactly one root lies in it : take the nearest
+		for( int j = 0; j < k; j++ )
+		{
+			double off = roots[j] < ts[i] ? ts[i] - roots[j] : roots[j] > ts[i+1] ? roots[j] - ts[i+1] : 0;
+			if( off < best )
+			{
+				best = off;
+				t = std::max( ts[i], std::min( ts[i+1], roots[j] ) );
+			}
+		}
+		double u = 1 - t;
+		if( u*u*u*c.x[0] + 3*u*u*t*c.x[1] + 3*u*t*t*c.x[2] + t*t*t*c.x[3] > x )
+			winding += ys[i+1] > ys[i] ? 1 : -1;
+	}
+	return winding;
+}
+
+#endif
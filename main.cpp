@@ -1,19 +1,120 @@
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <iostream>
 #include <SDL/SDL.h>
 #include <SDL/SDL_gfxPrimitives.h>
 
 #include "bezier.h"
+#include "canonical.h"
+#include "solver.h"
+#include "nimber.h"
+#include "mcts.h"
+#include "book.h"
+#include "analysis.h"
+#include "recorder.h"
 
 using namespace std;
 
+/* Solver progress, streamed to the console while a big position is searched */
+void solverProgress(const Solver &solver, int depth, void*)
+{
+	Uint32 time = SDL_GetTicks() - solver.started;
+	cout << "  " << (unsigned long)solver.nodes << " positions, " << (unsigned long)(time ? solver.nodes*1000/time : 0) << " per second, at depth " << depth << endl;
+}
+
+/* Hints from the background analysis : the board is handed over whenever its position changes, and the newest
+ * result is drawn on it as the line that plays it - green for a proven winning move, yellow for a Monte Carlo guess */
+struct hintState
+{
+	Analyzer analyzer;
+	string text;				// position being analysed
+	sproutsRules rules, analysed;	// rules played, and those the analysis is under
+	bool off;					// no hints : during a replay, where they would redraw the board at different times every run
+};
+void refreshHint(Bezier &curves, hintState &hint)
+{
+	position p;
+	string text;
+	analysisResult r;
+	if( hint.off || curves.busy() )		// half a move on the board : wait until it is played or given up
+		return;
+	curves.getPosition( p );
+	writePosition( p, text );
+	if( text != hint.text || hint.rules != hint.analysed )
+	{
+		hint.text = text;
+		hint.analysed = hint.rules;
+		hint.analyzer.submit( p, hint.rules );
+		curves.clearHint();
+		curves.drawLines();
+		return;
+	}
+	if( !hint.analyzer.result( r ) )
+		return;
+	char caption[80];
+	if( !r.hasMove )
+	{
+		curves.clearHint();
+		sprintf( caption, r.won ? "Hint : no move left, the player to move wins" : "Hint : the player to move loses" );
+	}
+	else if( !curves.showHint( r.move, r.solved ? 0x00FF00FF : 0xFFFF00FF ) )
+		sprintf( caption, "Hint : no room to draw the move found" );
+	else if( r.solved )
+		sprintf( caption, "Hint : the player to move wins with the marked move" );
+	else
+		sprintf( caption, "Hint : the marked move wins %d%% of random games", (int)(100*r.winRate) );
+	SDL_WM_SetCaption( caption, NULL );
+	curves.drawLines();
+}
+
+/* Searches asked for by a key (S, N, M), run off the GUI thread : the window keeps going meanwhile, and the result is
+ * printed (and the computer's move played) when its user event comes in */
+struct taskState
+{
+	AnalysisTask task;
+	string text;				// position it was started on
+};
+void startTask(Bezier &curves, taskState &t, analysisTaskKind kind, sproutsRules rules)
+{
+	position p;
+	if( t.task.busy() )
+	{
+		cout << "Still searching : wait for the last search to finish" << endl;
+		return;
+	}
+	curves.getPosition( p );
+	writePosition( p, t.text );
+	if( !t.task.start( kind, p, rules ) )
+		cout << "Could not start the search" << endl;
+}
+void finishTask(Bezier &curves, taskState &t)
+{
+	position p;
+	string text;
+	taskResult r;
+	if( !t.task.finish( r ) )
+		return;
+	cout << r.report << endl;
+	if( r.kind != taskMove || !r.hasMove )
+		return;
+	curves.getPosition( p );		// the same position, though its points may have been moved
+	writePosition( p, text );
+	if( curves.busy() || text != t.text )
+		cout << "The board has changed since : the move is not played" << endl;
+	else if( curves.playMove( r.move ) )
+		curves.drawLines();
+	else
+		cout << "No room to draw the move so it reaches the position chosen" << endl;
+}
+
 int main( int argc, char* argv[] )
 {
 	/* Variables */
 	bool gameRunning = true, clicked = false;
 	int xMouse, yMouse, downX, downY, downRtX, downRtY;
 	int lineIndex, pointIndex;
-	SDL_Event event;			// dump event polls into this
+	SDL_Event event, later;		// dump event polls into this, and peek at the queue with later
 
 
 	/* Initialize SDL */
@@ -24,10 +125,39 @@ int main( int argc, char* argv[] )
 	}
     atexit(SDL_Quit);	// push SDL_Quit onto stack to be executed at program end
 
+	/* Input recording : sproutsGUI [--spots n] [--record file] [--replay file [--fast]] (see recorder.h) [--write-db]
+	 * A game starts from n spots (the opening book's starts), else the board begins with a random line.
+	 * The position databases are only read unless --write-db is given : then they are made if missing and fed the
+	 * solver's results, by this one instance (another writing them already leaves them read-only here) */
+	EventRecorder recorder;
+	EventReplayer replayer;
+	const char *recordFile = NULL;
+	bool replaying = false, writeDatabases = false;
+	int spots = 0;
+	for( int i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "--spots" ) && i + 1 < argc )
+			spots = std::max( 0, atoi( argv[++i] ) );
+		else if( !strcmp( argv[i], "--record" ) && i + 1 < argc )
+			recordFile = argv[++i];
+		else if( !strcmp( argv[i], "--replay" ) && i + 1 < argc )
+		{
+			replaying = replayer.open( argv[++i] );
+			if( !replaying )
+				cout << "Could not read the recording " << argv[i] << endl;
+		}
+		else if( !strcmp( argv[i], "--fast" ) )
+			replayer.fast = true;
+		else if( !strcmp( argv[i], "--write-db" ) )
+			writeDatabases = true;
+	}
+
 	/* Initialize SDL window */
 	const SDL_VideoInfo* myPointer = SDL_GetVideoInfo();	// get current display information (for height, width, color depth, etc.)
 	// set new window to half current screen size, as a hardware surface, enable double buffering[, without a frame]
-	SDL_Surface *screen = SDL_SetVideoMode( myPointer->current_w/2, myPointer->current_h/2, 0, SDL_HWSURFACE|SDL_DOUBLEBUF );		/* End SDL initialization */
+	// or the size recorded in, for a replay
+	int width = replaying ? replayer.header.width : myPointer->current_w/2, height = replaying ? replayer.header.height : myPointer->current_h/2;
+	SDL_Surface *screen = SDL_SetVideoMode( width, height, 0, SDL_HWSURFACE|SDL_DOUBLEBUF );		/* End SDL initialization */
 	// SDL_Surface *button = SDL_CreateRGBSurface( SDL_HWSURFACE|SDL_SRCALPHA, 
 	
 	/* Set window icon and title */
@@ -46,14 +176,78 @@ int main( int argc, char* argv[] )
 	
 
 	/* Game loop */
-	Bezier curves(screen);	// create new Bezier curve object on the current screen
-	curves.drawLines();
+	Uint32 seed = replaying ? replayer.header.seed : (Uint32)time(NULL);
+	if( replaying )
+		spots = replayer.header.spots;
+	Bezier curves(screen, seed, spots);	// create new Bezier curve object on the current screen
+	PositionDatabase databases[2];	// solved positions kept between runs, a file for each rules
+	const char *databaseFiles[2] = { "positions.db", "misere.db" };
+	for( int i = 0; i < 2; i++ )
+	{
+		if( writeDatabases && databases[i].open( databaseFiles[i], true ) )
+			continue;
+		if( writeDatabases )
+			cout << databaseFiles[i] << " could not be opened for writing (another instance may be writing it) : read only" << endl;
+		databases[i].open( databaseFiles[i] );		// if there is one
+	}
+	Tablebase tablebases[2];		// endgames, if they have been generated (see tablebase.cpp)
+	tablebases[normalPlay].open( "endgame.tb" );
+	tablebases[misere].open( "endgame-misere.tb" );
+	OpeningBook books[2];			// opening moves, if they have been generated (see book.cpp)
+	books[normalPlay].open( "opening.book" );
+	books[misere].open( "opening-misere.book" );
+	hintState hint;
+	hint.rules = hint.analysed = normalPlay;
+	hint.off = replaying;
+	taskState task;
+	task.task.progress = solverProgress;
+	for( int i = 0; i < 2; i++ )		// a file built under the other rules would give wrong answers : not used
+	{
+		if( tablebases[i].isOpen() && tablebases[i].rules() != i )
+		{
+			cout << "Endgame tablebase built under the wrong rules, not used" << endl;
+			tablebases[i].close();
+		}
+		if( books[i].isOpen() && books[i].rules() != i )
+		{
+			cout << "Opening book built under the wrong rules, not used" << endl;
+			books[i].close();
+		}
+		if( tablebases[i].isOpen() )
+			hint.analyzer.tablebases[i] = task.task.tablebases[i] = &tablebases[i];
+		if( books[i].isOpen() )
+			hint.analyzer.books[i] = task.task.books[i] = &books[i];
+		if( databases[i].isOpen() )
+			task.task.databases[i] = &databases[i];
+	}
+	refreshHint( curves, hint );
+	if( recordFile && !recorder.open( recordFile, seed, screen->w, screen->h, spots ) )
+		cout << "Could not record to " << recordFile << endl;
+	if( replaying )
+	{
+		xMouse = replayer.header.mouseX;
+		yMouse = replayer.header.mouseY;
+		replayer.start();
+	}
+	else
+		SDL_GetMouseState( &xMouse, &yMouse );
 	// SDL_BlitSurface( button, NULL, screen, NULL );
 	// SDL_Flip( screen );
 	while( gameRunning )
 	{
-		while( SDL_PollEvent(&event) )
+		if( SDL_WaitEvent(&event) )		// asleep until there is something to do : input, or the analysis posting a result (a user event)
 		{
+			recorder.record( event );
+			if( event.type == SDL_MOUSEMOTION )		// where a new line starts
+			{
+				xMouse = event.motion.x;
+				yMouse = event.motion.y;
+			}
+			if( curves.handleEvent( event ) )		// a move being drawn, a line being split or routed : the input is for that
+			{
+				refreshHint( curves, hint );		// the board may have changed (once it is over)
+				continue;
+			}
 			switch( event.type )
 			{
 				case SDL_ACTIVEEVENT:		// see http://www.libsdl.org/cgi/docwiki.cgi/SDL_ActiveEvent
@@ -65,13 +259,46 @@ int main( int argc, char* argv[] )
 						gameRunning = false;
 					else if( event.key.keysym.sym == SDLK_RETURN )
 					{
-						curves.addLine();
+						curves.addLine( xMouse, yMouse );
 					}
 					else if( event.key.keysym.sym == SDLK_SPACE )
 					{
 						curves.splitLine();
-						curves.drawLines();
 					}
+					else if( event.key.keysym.sym == SDLK_r )		// route a line between two clicked spots
+					{
+						curves.routeLine();
+					}
+					else if( event.key.keysym.sym == SDLK_p )		// print the position in the usual Sprouts notation, then its canonical form and hash
+					{
+						position p, canon;
+						Canonicalizer canonicalizer;
+						string text, key;
+						char hash[20];
+						curves.getPosition( p );
+						writePosition( p, text );
+						canonicalizer.canonical( p, canon );
+						writePosition( canon, key );
+						sprintf( hash, "%08X%08X", (Uint32)(positionHash( canon ) >> 32), (Uint32)positionHash( canon ) );
+						cout << text << "  " << key << "  " << hash << endl;
+					}
+					else if( event.key.keysym.sym == SDLK_s )		// solve the position : who wins, and a winning move
+						startTask( curves, task, taskSolve, hint.rules );
+					else if( event.key.keysym.sym == SDLK_n )		// nimber of the position, its independent parts searched apart
+					{
+						if( hint.rules == misere )
+							cout << "Nimbers are for normal play only" << endl;
+						else
+							startTask( curves, task, taskNimber, normalPlay );
+					}
+					else if( event.key.keysym.sym == SDLK_t )		// toggle the rules : normal play or misère
+					{
+						hint.rules = hint.rules == normalPlay ? misere : normalPlay;
+						cout << (hint.rules == misere ? "Misere : the player who moves last loses" : "Normal play : the player who moves last wins") << endl;
+					}
+					else if( event.key.keysym.sym == SDLK_m )		// the computer moves : the opening book's move, else two seconds of Monte Carlo search, then the line routed on the board
+						startTask( curves, task, taskMove, hint.rules );
+					refreshHint( curves, hint );		// the board may have changed
 					break;
 				case SDL_MOUSEBUTTONDOWN:	// mouse pressed
 					if( event.button.button == SDL_BUTTON_LEFT )
@@ -144,8 +371,11 @@ int main( int argc, char* argv[] )
 							curves.drawLines();
 						}	
 					}
+					refreshHint( curves, hint );
 					break;
 				case SDL_MOUSEMOTION:		// mouse moved
+					if( SDL_PeepEvents( &later, 1, SDL_PEEKEVENT, SDL_MOUSEMOTIONMASK ) > 0 )	// a newer position is queued already : draw that one instead
+						break;
 					if( curves.active )		// moving a point
 					{
 						xMouse = event.motion.x;	// get mouse click location
@@ -158,6 +388,27 @@ int main( int argc, char* argv[] )
 						curves.highlightNear( event.motion.x, event.motion.y );
 					}
 					break;
+				case SDL_USEREVENT:			// the analysis has something new
+					if( event.user.code == analysisEventCode )
+						refreshHint( curves, hint );
+					else if( event.user.code == taskEventCode )		// a key's search is done
+					{
+						finishTask( curves, task );
+						refreshHint( curves, hint );
+					}
+					else if( event.user.code == replayEventCode )		// every replayed event has been handled : then the board it left is checked whole
+					{
+						vector< pair<int,int> > crossings;
+						cout << "Replayed " << replayer.count() << " events in " << SDL_GetTicks() - replayer.started << " ms" << endl;
+						if( curves.auditCrossings( crossings, 4 ) )		// moves are checked as they are drawn : only lines made at random, or a recording this build draws differently
+						{
+							cout << "The replayed board has " << crossings.size() << " pairs of crossing lines :";
+							for( unsigned i = 0; i < crossings.size() && i < 10; i++ )
+								cout << " " << crossings[i].first << "-" << crossings[i].second;
+							cout << (crossings.size() > 10 ? " ..." : "") << endl;
+						}
+					}
+					break;
 				case SDL_QUIT:				// top-right X clicked
 					gameRunning = false;
 					break;
@@ -0,0 +1,241 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include "xorRNG.h"
+#include "canonical.h"
+#include "moves.h"
+
+/* A player for positions too big to solve : Monte Carlo tree search with UCT. Every thread grows a tree of its own
+ * from the root with its own random numbers (root parallel : nothing shared, no locks), and the move played is the one
+ * with the most playouts over all the trees. Moves leading to the same canonical position are kept once in the tree;
+ * playouts are random games to the end on the raw positions, which allocate nothing once their buffers have grown.
+ * No RAVE : a Sprouts move is named by where its spots are in one position, so it means nothing in another */
+
+/* Global constants for Monte Carlo search */
+static const double mctsExploration = 0.7;		// UCT constant : higher tries the less played moves more
+static const int mctsMaxNodes = 1 << 18;		// nodes in one thread's tree : past this only playouts go on
+static const int mctsCheckEvery = 64;			// playouts between looks at the clock
+/* End constants */
+
+class MonteCarlo
+{
+	private:
+		struct node
+		{
+			sproutsMove move;			// from the parent, in the terms of the parent's position as reached from the root
+			int firstChild, children;	// firstChild -1 : not expanded
+			Uint32 visits;
+			double wins;				// playouts won by the player who made the move into this node
+		};
+		struct worker
+		{
+			MonteCarlo *owner;
+			std::vector<node> tree;
+			xorShiftState random;
+			Uint64 playouts;
+			std::vector<sproutsMove> moves;
+			std::vector<Uint64> keys;
+			std::vector<int> path;
+			position positions[2], canon;
+			Canonicalizer canonicalizer;
+		};
+
+		position root;
+		Uint32 deadline;
+		Uint64 budget;				// playouts for each thread
+		std::vector<worker> workers;
+
+		/* Private functions */
+		void expand(worker&, int, const position&);
+		int select(const worker&, int) const;		// child to walk down to, by UCT
+		bool playout(worker&, int);					// random game from the worker's position at the index : true if the player to move there wins
+		void iterate(worker&);
+		static int run(void*);
+
+	public:
+		/* Constructors */
+		MonteCarlo();
+
+		/* Public variables */
+		Uint64 playouts;			// in the last search, over all threads
+		Uint32 elapsed;				// milliseconds the last search took
+		double winRate;				// share of the chosen move's playouts won by the player making it
+		sproutsRules rules;			// normalPlay unless set
+		bool (*stop)(void*);		// polled with the clock, if set : true ends the search early
+		void *stopData;
+
+		/* Queries */
+		bool choose(const position&, int, Uint32, Uint64, sproutsMove&);	// position, threads, milliseconds, playouts (0 : no limit) - false if there is no move
+		double rate() const { return elapsed ? 1000.0*playouts/elapsed : 0; }	// playouts per second
+};
+MonteCarlo::MonteCarlo()
+{
+	playouts = 0;
+	elapsed = 0;
+	winRate = 0;
+	rules = normalPlay;
+	stop = NULL;
+	stopData = NULL;
+}
+/* Children of a node, one for each canonical position the moves lead to */
+void MonteCarlo::expand(worker &w, int n, const position &p)
+{
+	generateMoves( p, w.moves );
+	w.keys.clear();
+	int first = w.tree.size();
+	for( unsigned i = 0; i < w.moves.size(); i++ )
+	{
+		applyMove( p, w.moves[i], w.positions[1] );		// the worker's spare position : iterate walks in positions[0]
+		w.canonicalizer.canonical( w.positions[1], w.canon );
+		Uint64 key = positionHash( w.canon );
+		if( std::find( w.keys.begin(), w.keys.end(), key ) != w.keys.end() )
+			continue;
+		w.keys.push_back( key );
+		node c = { w.moves[i], -1, 0, 0, 0 };
+		w.tree.push_back( c );
+	}
+	w.tree[n].firstChild = first;
+	w.tree[n].children = w.tree.size() - first;
+}
+int MonteCarlo::select(const worker &w, int n) const
+{
+	const node &parent = w.tree[n];
+	double logVisits = log( (double)parent.visits + 1 ), bestScore = -1;
+	int best = parent.firstChild;
+	for( int c = parent.firstChild; c < parent.firstChild + parent.children; c++ )
+	{
+		const node &child = w.tree[c];
+		if( !child.visits )		// every move once before any twice
+			return c;
+		double score = child.wins/child.visits + mctsExploration*sqrt( logVisits/child.visits );
+		if( score > bestScore )
+		{
+			bestScore = score;
+			best = c;
+		}
+	}
+	return best;
+}
+bool MonteCarlo::playout(worker &w, int at)
+{
+	for( int turn = 0; ; turn++, at ^= 1 )
+	{
+		generateMoves( w.positions[at], w.moves );
+		if( w.moves.empty() )		// the player to move now loses in normal play, wins in misère
+			return ((turn & 1) != 0) == (w.owner->rules == normalPlay);
+		applyMove( w.positions[at], w.moves[ XORshiftRNG( w.random ) % w.moves.size() ], w.positions[at ^ 1] );
+	}
+}
+/* Walk down by UCT, add a node's children the second time it is reached, play one random game and count it all the way up */
+void MonteCarlo::iterate(worker &w)
+{
+	int n = 0, at = 0;
+	w.positions[0] = root;
+	w.path.assign( 1, 0 );
+	while( w.tree[n].firstChild >= 0 && w.tree[n].children )
+	{
+		n = select( w, n );
+		applyMove( w.positions[at], w.tree[n].move, w.positions[at ^ 1] );
+		at ^= 1;
+		w.path.push_back( n );
+	}
+	if( w.tree[n].firstChild < 0 && (w.tree[n].visits || n == 0) && (int)w.tree.size() < mctsMaxNodes )
+	{
+		if( at )		// expand works in positions[1]
+		{
+			w.positions[0] = w.positions[1];
+			at = 0;
+		}
+		expand( w, n, w.positions[0] );
+		if( w.tree[n].children )
+		{
+			n = w.tree[n].firstChild + XORshiftRNG( w.random ) % w.tree[n].children;
+			applyMove( w.positions[0], w.tree[n].move, w.positions[1] );
+			at = 1;
+			w.path.push_back( n );
+		}
+	}
+	bool moverWins = !playout( w, at );		// for the player who moved into n
+	for( int i = w.path.size() - 1; i >= 0; i--, moverWins = !moverWins )
+	{
+		w.tree[ w.path[i] ].visits++;
+		if( moverWins )
+			w.tree[ w.path[i] ].wins++;
+	}
+	w.playouts++;
+}
+int MonteCarlo::run(void *data)
+{
+	worker &w = *(worker*)data;
+	MonteCarlo &owner = *w.owner;
+	while( !owner.budget || w.playouts < owner.budget )
+	{
+		owner.iterate( w );
+		if( w.playouts % mctsCheckEvery == 0 && (SDL_GetTicks() >= owner.deadline || (owner.stop && owner.stop( owner.stopData ))) )
+			break;
+	}
+	return 0;
+}
+/* The root is searched as given (not canonical), so the move is in its terms */
+bool MonteCarlo::choose(const position &p, int threads, Uint32 time, Uint64 limit, sproutsMove &best)
+{
+	Uint32 start = SDL_GetTicks();
+	threads = std::max( threads, 1 );
+	std::vector<SDL_Thread*> running( threads );
+	root = p;
+	deadline = start + time;
+	budget = limit ? (limit + threads - 1)/threads : 0;
+	workers.assign( threads, worker() );
+	for( int i = 0; i < threads; i++ )
+	{
+		node top = { sproutsMove(), -1, 0, 0, 0 };
+		workers[i].owner = this;
+		workers[i].tree.assign( 1, top );
+		workers[i].playouts = 0;
+		XORshiftSeed( workers[i].random, start + 7919*i );
+	}
+	for( int i = 0; i < threads; i++ )
+		running[i] = SDL_CreateThread( run, &workers[i] );
+	playouts = 0;
+	for( int i = 0; i < threads; i++ )
+	{
+		if( running[i] )
+			SDL_WaitThread( running[i], NULL );
+		else		// could not start a thread : its share is played here
+			run( &workers[i] );
+		playouts += workers[i].playouts;
+	}
+	elapsed = SDL_GetTicks() - start;
+
+	/* Every tree opens the root the same way, so the children line up across threads */
+	const worker &first = workers[0];
+	if( first.tree[0].firstChild < 0 || !first.tree[0].children )
+		return false;
+	Uint64 mostVisits = 0;
+	for( int c = 0; c < first.tree[0].children; c++ )
+	{
+		Uint64 visits = 0;
+		double wins = 0;
+		for( int i = 0; i < threads; i++ )
+			if( workers[i].tree[0].firstChild >= 0 )
+			{
+				visits += workers[i].tree[ workers[i].tree[0].firstChild + c ].visits;
+				wins += workers[i].tree[ workers[i].tree[0].firstChild + c ].wins;
+			}
+		if( c == 0 || visits > mostVisits )
+		{
+			mostVisits = visits;
+			best = first.tree[ first.tree[0].firstChild + c ].move;
+			winRate = visits ? wins/visits : 0;
+		}
+	}
+	workers.clear();
+	return true;
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef MOVES_H
+#define MOVES_H
+
+#include <vector>
+#include "position.h"
+
+/* Sprouts moves on a position (see position.h) : a line from one spot to another (or to itself) inside one region,
+ * with a new spot x on it
+ *   - spots on two boundaries of the region : the boundaries become one, u ... u x v ... v x
+ *   - spots on one boundary : the region splits in two, u ... v x and v ... u x, and every other boundary
+ *     of the region ends up on one side or the other - each way of sharing them out is a move
+ * The spot occurrence a line leaves from is split in two (one each side of the line), except an isolated spot's */
+
+struct sproutsMove
+{
+	int region;			// region the line is drawn in
+	int from, to;		// occurrences (indices in position::spots) the line joins, from == to for a loop
+	unsigned inside;	// for a line splitting the region : bit k set puts the k-th other boundary on the u ... v x side
+};
+
+/* Global constants for moves */
+static const int movesMaxSplit = 20;		// boundaries in a region split by a move before the ways of sharing them out are not all listed
+/* End constants */
+
+/* Lives of a spot code, and the lines at it */
+inline int codeLives(int code)
+{
+	return code < positionLabel ? positionLives - code : 1;
+}
+inline int codeLines(int code)
+{
+	return code < positionLabel ? code : positionLives - 1;
+}
+/* Lives summed over every occurrence : at least the lives left (a label met twice counts twice), so at least the
+ * moves the game can still last */
+inline int livesBound(const position &p)
+{
+	int lives = 0;
+	for( unsigned i = 0; i < p.spots.size(); i++ )
+		lives += codeLives( p.spots[i] );
+	return lives;
+}
+/* Lives left, a label counted once (a label is met exactly twice : its spot's two wedges) : every move takes one
+ * (two used at its ends, one left on the new spot), so a child always has fewer than its parent */
+inline int livesLeft(const position &p)
+{
+	int lives = 0, labels = 0;
+	for( unsigned i = 0; i < p.spots.size(); i++ )
+		if( p.spots[i] < positionLabel )
+			lives += positionLives - p.spots[i];
+		else
+			labels++;
+	return lives + (labels + 1)/2;
+}
+/* Boundary an occurrence is on, by a walk over boundaryEnd (positions are small) */
+inline int boundaryOf(const position &p, int occurrence)
+{
+	int b = 0;
+	while( p.boundaryEnd[b] <= occurrence )
+		b++;
+	return b;
+}
+
+void generateMoves(const position &p, std::vector<sproutsMove> &moves)
+{
+	moves.clear();
+	int bound = 0;
+	for( unsigned r = 0; r < p.regionEnd.size(); r++ )
+	{
+		int firstBound = bound, lastBound = p.regionEnd[r];
+		int first = firstBound ? p.boundaryEnd[firstBound - 1] : 0, last = p.boundaryEnd[lastBound - 1];
+		int others = lastBound - firstBound - 1;
+		unsigned shares = others < movesMaxSplit ? 1u << others : 1u << movesMaxSplit;
+		bound = lastBound;
+		for( int i = first, bi = firstBound; i < last; i++ )
+		{
+			while( p.boundaryEnd[bi] <= i )
+				bi++;
+			for( int j = i, bj = bi; j < last; j++ )
+			{
+				while( p.boundaryEnd[bj] <= j )
+					bj++;
+				int u = p.spots[i], v = p.spots[j];
+				if( i == j ? codeLives( u ) < 2 : u == v && u >= positionLabel )		// a loop needs two lives, and a label's two occurrences are one spot with one life
+					continue;
+				sproutsMove m = { (int)r, i, j, 0 };
+				if( bi != bj )
+					moves.push_back( m );
+				else
+					for( m.inside = 0; m.inside < shares; m.inside++ )
+						moves.push_back( m );
+			}
+		}
+	}
+}
+
+/* Copy an occurrence the line does not touch, leaving out labels the move used up */
+inline void copySpot(position &out, int code, int deadU, int deadV)
+{
+	if( code != deadU && code != deadV )
+		out.spots.push_back( code );
+}
+inline void endBoundary(position &out)
+{
+	if( out.spots.size() > (out.boundaryEnd.empty() ? 0 : (unsigned)out.boundaryEnd.back()) )
+		out.boundaryEnd.push_back( out.spots.size() );
+}
+inline void endRegion(position &out)
+{
+	if( out.boundaryEnd.size() > (out.regionEnd.empty() ? 0 : (unsigned)out.regionEnd.back()) )
+		out.regionEnd.push_back( out.boundaryEnd.size() );
+}
+
+/* The position after a move : new labels are numbered from p.labels, so the result wants canonicalizing */
+void applyMove(const position &p, const sproutsMove &m, position &out)
+{
+	int x = positionLabel + p.labels, next = p.labels + 1;
+	int u = p.spots[m.from], v = p.spots[m.to];
+	int newU, newV;
+	bool loop = m.from == m.to;
+	out.spots.clear();
+	out.boundaryEnd.clear();
+	out.regionEnd.clear();
+
+	/* New codes : 1 line is written 1, 2 lines a label (the spot now has two wedges), 3 lines dead */
+	int lines = codeLines( u ) + (loop ? 2 : 1);
+	newU = lines >= positionLives ? -1 : lines == 1 ? 1 : positionLabel + next++;
+	newV = newU;
+	if( !loop )
+	{
+		lines = codeLines( v ) + 1;
+		newV = lines >= positionLives ? -1 : lines == 1 ? 1 : positionLabel + next++;
+	}
+	int deadU = u >= positionLabel ? u : -1, deadV = v >= positionLabel ? v : -1;	// a label used up : all its occurrences go, in every region
+	out.labels = next;
+
+	int bi = boundaryOf( p, m.from ), bj = boundaryOf( p, m.to );
+	int bound = 0;
+	for( unsigned r = 0; r < p.regionEnd.size(); r++ )
+	{
+		int firstBound = bound;
+		bound = p.regionEnd[r];
+		if( (int)r != m.region )		// untouched, apart from dead labels
+		{
+			for( int b = firstBound; b < bound; b++ )
+			{
+				for( int s = b ? p.boundaryEnd[b - 1] : 0; s < p.boundaryEnd[b]; s++ )
+					copySpot( out, p.spots[s], deadU, deadV );
+				endBoundary( out );
+			}
+			endRegion( out );
+			continue;
+		}
+
+		int startI = bi ? p.boundaryEnd[bi - 1] : 0, endI = p.boundaryEnd[bi];
+		int startJ = bj ? p.boundaryEnd[bj - 1] : 0, endJ = p.boundaryEnd[bj];
+		if( bi != bj )		// two boundaries become one : u P u x v Q v x
+		{
+			if( newU >= 0 )
+				out.spots.push_back( newU );
+			for( int s = m.from + 1; s < endI; s++ )
+				copySpot( out, p.spots[s], deadU, deadV );
+			for( int s = startI; s < m.from; s++ )
+				copySpot( out, p.spots[s], deadU, deadV );
+			if( newU >= 0 && u != 0 )		// an isolated spot had no wedge to split
+				out.spots.push_back( newU );
+			out.spots.push_back( x );
+			if( newV >= 0 )
+				out.spots.push_back( newV );
+			for( int s = m.to + 1; s < endJ; s++ )
+				copySpot( out, p.spots[s], deadU, deadV );
+			for( int s = startJ; s < m.to; s++ )
+				copySpot( out, p.spots[s], deadU, deadV );
+			if( newV >= 0 && v != 0 )
+				out.spots.push_back( newV );
+			out.spots.push_back( x );
+			endBoundary( out );
+			for( int b = firstBound; b < bound; b++ )
+				if( b != bi && b != bj )
+				{
+					for( int s = b ? p.boundaryEnd[b - 1] : 0; s < p.boundaryEnd[b]; s++ )
+						copySpot( out, p.spots[s], deadU, deadV );
+					endBoundary( out );
+				}
+			endRegion( out );
+			continue;
+		}
+
+		/* One boundary split in two : u A v x on the inside, v C u x on the outside (a loop : u x, and u C u x) */
+		for( int side = 0; side < 2; side++ )
+		{
+			if( side == 0 )
+			{
+				if( newU >= 0 )
+					out.spots.push_back( newU );
+				for( int s = m.from + 1; s < m.to; s++ )
+					copySpot( out, p.spots[s], deadU, deadV );
+				if( !loop && newV >= 0 )
+					out.spots.push_back( newV );
+			}
+			else
+			{
+				if( newV >= 0 )
+					out.spots.push_back( newV );
+				if( !loop || u != 0 )
+				{
+					for( int s = m.to + 1; s < endI; s++ )
+						copySpot( out, p.spots[s], deadU, deadV );
+					for( int s = startI; s < m.from; s++ )
+						copySpot( out, p.spots[s], deadU, deadV );
+					if( newU >= 0 )
+						out.spots.push_back( newU );
+				}
+			}
+			out.spots.push_back( x );
+			endBoundary( out );
+			int k = 0;
+			for( int b = firstBound; b < bound; b++ )
+				if( b != bi )
+				{
+					bool in = k < movesMaxSplit && (m.inside >> k & 1);
+					k++;
+					if( in != (side == 0) )
+						continue;
+					for( int s = b ? p.boundaryEnd[b - 1] : 0; s < p.boundaryEnd[b]; s++ )
+						copySpot( out, p.spots[s], deadU, deadV );
+					endBoundary( out );
+				}
+			endRegion( out );
+		}
+	}
+}
+
+/* The children of a position, written into scratch the caller keeps : every vector (the children's included) only
+ * grows, so once it has room for the largest position met, listing children allocates nothing */
+struct moveList
+{
+	std::vector<sproutsMove> moves;
+	std::vector<position> children;		// children[i] is the position after moves[i], for i < moves.size() (the rest is spare)
+};
+int generateChildren(const position &p, moveList &list)
+{
+	generateMoves( p, list.moves );
+	if( list.children.size() < list.moves.size() )
+		list.children.resize( list.moves.size() );
+	for( unsigned i = 0; i < list.moves.size(); i++ )
+		applyMove( p, list.moves[i], list.children[i] );
+	return list.moves.size();
+}
+
+#endif
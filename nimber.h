@@ -0,0 +1,278 @@
+#ifndef NIMBER_H
+#define NIMBER_H
+
+#include <algorithm>
+#include <vector>
+#include <SDL/SDL.h>
+#include "solver.h"
+
+/* Sprouts as a sum of games : regions that share no spot are played independently, so a position is the sum of its
+ * components (regions joined by the labels between them) and its nimber is the XOR of theirs - the player to move
+ * wins when that is not 0. Each component is searched on its own, which is usually far smaller than the whole tree.
+ * Whole nimbers are only worked out for the small components : to decide a sum, the largest component is only asked
+ * "is your nimber n ?" (n the XOR of the others), which stops at the first child showing it is not.
+ * Normal play only : under misère rules a sum is not decided by the XOR of its parts */
+
+/* Global constants for nimbers */
+static const int nimberTableBits = 20;
+static const int nimberMax = 62;			// nimbers above this are not looked for (Sprouts positions stay far below)
+/* End constants */
+
+class NimberSolver
+{
+	private:
+		struct frame
+		{
+			std::vector<sproutsMove> moves;
+			std::vector<Uint64> children;
+			std::vector<position> parts;
+			position child;
+		};
+
+		TranspositionTable nimbers;		// nimber + 1 of canonical components
+		TranspositionTable tests;		// +1 / -1 : whether a component has a given nimber, keyed on the hash mixed with it
+		std::vector<frame> frames;
+		Canonicalizer canonicalizer;
+		std::vector<int> parent, labelRegion;
+		bool aborted;
+
+		/* Private functions */
+		int findRoot(int);
+		bool hasNimber(const position&, Uint64, int, int);
+		int childParts(const position&, const sproutsMove&, int, int&);	// split a child into parts, returns the largest part (or -1) and the XOR of the others
+		int nimberAt(const position&, int);
+		void sizeFrames(const position&);
+		static Uint64 testKey(Uint64 key, int n) { return key ^ ((Uint64)(n + 1) * (((Uint64)0x9E3779B9 << 32) | 0x7F4A7C15)); }
+
+	public:
+		/* Constructors */
+		NimberSolver(int=nimberTableBits);
+
+		/* Public variables */
+		Uint64 nodes;
+		PositionDatabase *database;		// nimbers of components kept between runs, if set
+		bool (*stop)(void*);			// polled every few hundred positions, if set : true gives the search up
+		void *stopData;
+
+		/* Construction */
+		void split(const position&, std::vector<position>&);	// independent components, each canonical
+
+		/* Queries */
+		int nimber(const position&);		// nimber of a position (any number of components) - 0 if stopped
+		bool solve(const position&, sproutsMove* =NULL);	// true if the player to move wins, and a winning move in the position's terms - false if stopped
+		void clear() { nimbers.clear(); tests.clear(); }
+		bool stopped() const { return aborted; }	// the last search was given up (its answer means nothing)
+};
+NimberSolver::NimberSolver(int bits) : nimbers( bits ), tests( bits )
+{
+	nodes = 0;
+	database = NULL;
+	stop = NULL;
+	stopData = NULL;
+	aborted = false;
+}
+int NimberSolver::findRoot(int r)
+{
+	while( parent[r] != r )
+		r = parent[r] = parent[parent[r]];
+	return r;
+}
+/* Regions that share a label go together (union-find over the regions), every other region stands alone */
+void NimberSolver::split(const position &p, std::vector<position> &parts)
+{
+	int n = p.regionEnd.size();
+	position part;
+	parts.clear();
+	parent.resize( n );
+	labelRegion.assign( p.labels, -1 );
+	for( int r = 0; r < n; r++ )
+		parent[r] = r;
+	int bound = 0;
+	for( int r = 0, s = 0; r < n; r++ )
+		for( ; bound < p.regionEnd[r]; bound++ )
+			for( ; s < p.boundaryEnd[bound]; s++ )
+			{
+				int c = p.spots[s];
+				if( c < positionLabel )
+					continue;
+				int &other = labelRegion[c - positionLabel];
+				if( other < 0 )
+					other = r;
+				else
+					parent[ findRoot( r ) ] = findRoot( other );
+			}
+	std::vector<int> partOf( n, -1 );
+	std::vector<position> raw;
+	for( int r = 0; r < n; r++ )
+	{
+		int root = findRoot( r );
+		if( partOf[root] < 0 )
+		{
+			partOf[root] = raw.size();
+			raw.push_back( position() );
+			raw.back().labels = p.labels;
+		}
+		position &q = raw[ partOf[root] ];
+		for( int b = r ? p.regionEnd[r - 1] : 0; b < p.regionEnd[r]; b++ )
+		{
+			for( int s = b ? p.boundaryEnd[b - 1] : 0; s < p.boundaryEnd[b]; s++ )
+				q.spots.push_back( p.spots[s] );
+			q.boundaryEnd.push_back( q.spots.size() );
+		}
+		q.regionEnd.push_back( q.boundaryEnd.size() );
+	}
+	for( unsigned i = 0; i < raw.size(); i++ )
+	{
+		canonicalizer.canonical( raw[i], part );
+		if( !part.regionEnd.empty() )		// all dead : nothing left to play
+			parts.push_back( part );
+	}
+}
+int NimberSolver::childParts(const position &p, const sproutsMove &m, int depth, int &others)
+{
+	frame &f = frames[depth];
+	applyMove( p, m, f.child );
+	split( f.child, f.parts );
+	int largest = -1;
+	for( unsigned i = 0; i < f.parts.size(); i++ )
+		if( largest < 0 || f.parts[i].spots.size() > f.parts[largest].spots.size() )
+			largest = i;
+	others = 0;
+	for( unsigned i = 0; i < f.parts.size(); i++ )
+		if( (int)i != largest )
+			others ^= nimberAt( f.parts[i], depth + 1 );
+	return largest;
+}
+/* True if a canonical component has nimber n : no child has nimber n, and children have every nimber below it.
+ * A child is a sum : its nimber is n only if its largest part's nimber is n XOR the others'. A search given up returns
+ * false all the way back and stores nothing, so every true and everything stored is exact */
+bool NimberSolver::hasNimber(const position &p, Uint64 key, int n, int depth)
+{
+	int known = nimbers.probe( key );
+	if( known )
+		return known - 1 == n;
+	known = tests.probe( testKey( key, n ) );
+	if( known )
+		return known > 0;
+	if( (++nodes & 0xFF) == 0 && stop && stop( stopData ) )
+		aborted = true;
+	if( aborted )
+		return false;
+	generateMoves( p, frames[depth].moves );
+	frames[depth].children.clear();
+	Uint64 found = 0;
+	bool result = true;
+	for( unsigned i = 0; i < frames[depth].moves.size() && result && !aborted; i++ )		// first pass : any child with nimber n settles it
+	{
+		int others, largest = childParts( p, frames[depth].moves[i], depth, others );
+		if( largest < 0 )
+		{
+			if( others == n )
+				result = false;
+			else if( others < n )
+				found |= (Uint64)1 << others;
+			continue;
+		}
+		position &part = frames[depth].parts[largest];
+		Uint64 partKey = positionHash( part ) ^ (Uint64)others;
+		if( std::find( frames[depth].children.begin(), frames[depth].children.end(), partKey ) != frames[depth].children.end() )
+			continue;
+		frames[depth].children.push_back( partKey );
+		position largestPart = part;		// the frame is reused below
+		if( hasNimber( largestPart, positionHash( largestPart ), n ^ others, depth + 1 ) )
+			result = false;
+	}
+	for( unsigned i = 0; i < frames[depth].moves.size() && result && found != ((Uint64)1 << n) - 1 && !aborted; i++ )	// second pass : every nimber below n
+	{
+		int others, largest = childParts( p, frames[depth].moves[i], depth, others );
+		if( largest < 0 )
+			continue;
+		position largestPart = frames[depth].parts[largest];
+		Uint64 partKey = positionHash( largestPart );
+		for( int m = 0; m < n; m++ )
+			if( !(found >> m & 1) && hasNimber( largestPart, partKey, m ^ others, depth + 1 ) )
+				found |= (Uint64)1 << m;
+	}
+	if( aborted )
+		return false;
+	result = result && found == ((Uint64)1 << n) - 1;
+	tests.store( testKey( key, n ), result ? 1 : -1 );
+	return result;
+}
+/* Every move uses up a life, so the search is never deeper than the lives left - sized before searching, since frames
+ * are referenced down the recursion */
+void NimberSolver::sizeFrames(const position &p)
+{
+	int lives = livesBound( p );
+	if( (int)frames.size() < lives + 2 )
+		frames.resize( lives + 2 );
+}
+int NimberSolver::nimber(const position &p)
+{
+	aborted = false;
+	sizeFrames( p );
+	return nimberAt( p, 0 );
+}
+/* Nimber of each component by asking 0, 1, 2 ... in turn, XORed together */
+int NimberSolver::nimberAt(const position &p, int depth)
+{
+	std::vector<position> parts;
+	split( p, parts );
+	int total = 0;
+	for( unsigned i = 0; i < parts.size(); i++ )
+	{
+		Uint64 key = positionHash( parts[i] );
+		int value = nimbers.probe( key ) - 1, depthStored;
+		if( value < 0 && database && database->find( key, databaseNimber, value, depthStored ) )
+			nimbers.store( key, value + 1 );
+		for( int n = 0; value < 0 && n <= nimberMax && !aborted; n++ )
+			if( hasNimber( parts[i], key, n, depth ) )
+			{
+				value = n;
+				nimbers.store( key, value + 1 );
+				if( database )
+					database->store( key, databaseNimber, value, livesBound( parts[i] ) );
+			}
+		total ^= value;
+	}
+	return aborted ? 0 : total;
+}
+/* The position wins if its nimber is not 0 : only the small components get whole nimbers, the largest is asked about
+ * the one nimber that would make the sum 0. A winning move leads to a child whose nimber is 0 */
+bool NimberSolver::solve(const position &p, sproutsMove *best)
+{
+	std::vector<sproutsMove> moves;
+	std::vector<position> parts;
+	position child;
+	aborted = false;
+	sizeFrames( p );
+	split( p, parts );
+	int largest = -1, others = 0;
+	for( unsigned i = 0; i < parts.size(); i++ )
+		if( largest < 0 || parts[i].spots.size() > parts[largest].spots.size() )
+			largest = i;
+	for( unsigned i = 0; i < parts.size(); i++ )
+		if( (int)i != largest )
+			others ^= nimberAt( parts[i], 1 );
+	if( largest < 0 || hasNimber( parts[largest], positionHash( parts[largest] ), others, 1 ) || aborted )
+		return false;
+	if( best )
+	{
+		generateMoves( p, moves );
+		for( unsigned i = 0; i < moves.size() && !aborted; i++ )
+		{
+			int childOthers, childLargest = childParts( p, moves[i], 0, childOthers );
+			position part;
+			if( childLargest >= 0 )
+				part = frames[0].parts[childLargest];
+			if( childLargest < 0 ? childOthers == 0 : hasNimber( part, positionHash( part ), childOthers, 1 ) )
+			{
+				*best = moves[i];
+				break;
+			}
+		}
+	}
+	return !aborted;
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <SDL/SDL.h>
+#include "position.h"
+
+/* Positions packed into a few bytes each, for keeping millions of them (the tablebase generator's groups) : a position
+ * struct costs three heap blocks and four bytes a code, a packed one a byte or two a boundary
+ * The codes are read most significant bit first, one after another, with no gaps :
+ *   10			spot 2				00			end of a boundary
+ *   110		spot 1				1111		end of a region (twice : end of the position - no region is empty)
+ *   1110		spot 0
+ *   010		a label met for the first time
+ *   011 i		a label met before, i its number in the order labels are first met (as few bits as that many labels need)
+ * then zero bits to the end of the byte. The labels come back numbered in the order they are met, which is how
+ * canonical forms have them already, so a canonical position packs and unpacks to itself; any position unpacks to
+ * the same position. Equal positions pack to equal bytes, so packed ones are hashed and ordered as they are (memcmp) */
+
+/* Global constants for packed positions */
+static const Uint32 packedBoundary = 0x0, packedBoundaryBits = 2;	// code, and its length
+static const Uint32 packedRegion = 0xF, packedRegionBits = 4;
+static const Uint32 packedNewLabel = 0x2, packedOldLabel = 0x3, packedLabelBits = 3;
+static const Uint32 packedSpot[positionLabel] = { 0xE, 0x6, 0x2 }, packedSpotBits[positionLabel] = { 4, 3, 2 };	// by digit
+/* End constants */
+
+/* Bits appended to a byte vector */
+struct packedWriter
+{
+	std::vector<Uint8> &out;
+	Uint32 bits;		// not yet written, in the low count bits
+	int count;
+
+	packedWriter(std::vector<Uint8> &o) : out( o ), bits( 0 ), count( 0 ) {}
+	void put(Uint32 code, int length)
+	{
+		bits = (bits << length) | code;
+		count += length;
+		while( count >= 8 )
+		{
+			count -= 8;
+			out.push_back( (Uint8)(bits >> count) );
+		}
+	}
+	void finish()		// pad the last byte
+	{
+		if( count )
+			out.push_back( (Uint8)(bits << (8 - count)) );
+		count = 0;
+	}
+};
+/* Bits read back */
+struct packedReader
+{
+	const Uint8 *at;
+	Uint32 bits;
+	int count;
+
+	packedReader(const Uint8 *from) : at( from ), bits( 0 ), count( 0 ) {}
+	Uint32 get(int length)
+	{
+		while( count < length )
+		{
+			bits = (bits << 8) | *at++;
+			count += 8;
+		}
+		count -= length;
+		return (bits >> count) & ((1u << length) - 1);
+	}
+};
+
+/* Bits needed to tell apart n labels */
+inline int labelBits(int n)
+{
+	int bits = 0;
+	while( (1 << bits) < n )
+		bits++;
+	return bits;
+}
+
+/* Appends the position, packed */
+void packPosition(const position &p, std::vector<Uint8> &out)
+{
+	int few[64];		// labels renamed in the order met : on the stack unless there are many (packing runs on several threads)
+	std::vector<int> many;
+	int *rename = few;
+	if( p.labels > 64 )
+	{
+		many.resize( p.labels );
+		rename = &many[0];
+	}
+	std::fill( rename, rename + p.labels, -1 );
+	packedWriter w( out );
+	int met = 0;
+	unsigned spot = 0, bound = 0;
+	for( unsigned r = 0; r < p.regionEnd.size(); r++ )
+	{
+		for( ; bound < (unsigned)p.regionEnd[r]; bound++ )
+		{
+			for( ; spot < (unsigned)p.boundaryEnd[bound]; spot++ )
+			{
+				int code = p.spots[spot];
+				if( code < positionLabel )
+					w.put( packedSpot[code], packedSpotBits[code] );
+				else if( rename[ code - positionLabel ] < 0 )
+				{
+					rename[ code - positionLabel ] = met++;
+					w.put( packedNewLabel, packedLabelBits );
+				}
+				else
+				{
+					w.put( packedOldLabel, packedLabelBits );
+					w.put( rename[ code - positionLabel ], labelBits( met ) );
+				}
+			}
+			w.put( packedBoundary, packedBoundaryBits );
+		}
+		w.put( packedRegion, packedRegionBits );
+	}
+	w.put( packedRegion, packedRegionBits );
+	w.finish();
+}
+/* Unpacks the position at the bytes given : returns the byte after it */
+const Uint8 *unpackPosition(const Uint8 *from, position &p)
+{
+	packedReader r( from );
+	bool regionDone = true;		// a region end here ends the position (no regions at all)
+	p.spots.clear();
+	p.boundaryEnd.clear();
+	p.regionEnd.clear();
+	p.labels = 0;
+	for( ;; )
+	{
+		if( !r.get( 1 ) )
+		{
+			if( !r.get( 1 ) )		// 00
+				p.boundaryEnd.push_back( p.spots.size() );
+			else if( !r.get( 1 ) )	// 010
+				p.spots.push_back( positionLabel + p.labels++ );
+			else					// 011 i
+				p.spots.push_back( positionLabel + r.get( labelBits( p.labels ) ) );
+		}
+		else if( !r.get( 1 ) )		// 10
+			p.spots.push_back( 2 );
+		else if( !r.get( 1 ) )		// 110
+			p.spots.push_back( 1 );
+		else if( !r.get( 1 ) )		// 1110
+			p.spots.push_back( 0 );
+		else						// 1111
+		{
+			if( regionDone )
+				return r.at;
+			p.regionEnd.push_back( p.boundaryEnd.size() );
+			regionDone = true;
+			continue;
+		}
+		regionDone = false;
+	}
+}
+
+/* 64-bit hash of packed bytes : FNV-1a, then the same final mix as positionHash - not the same value as it, so not for
+ * anything kept in files, which are keyed by positionHash */
+inline Uint64 packedHash(const Uint8 *bytes, size_t length)
+{
+	const Uint64 prime = ((Uint64)0x100 << 32) | 0x1B3;
+	Uint64 h = ((Uint64)0xCBF29CE4 << 32) | 0x84222325;
+	for( size_t i = 0; i < length; i++ )
+		h = (h ^ bytes[i]) * prime;
+	h ^= h >> 33;
+	h *= ((Uint64)0xFF51AFD7 << 32) | 0xED558CCD;
+	h ^= h >> 33;
+	h *= ((Uint64)0xC4CEB9FE << 32) | 0x1A85EC53;
+	h ^= h >> 33;
+	return h;
+}
+/* Byte order, the shorter first when one starts the other : <0, 0, >0 */
+inline int comparePacked(const Uint8 *a, size_t aLength, const Uint8 *b, size_t bLength)
+{
+	int c = memcmp( a, b, std::min( aLength, bLength ) );
+	return c ? c : aLength < bLength ? -1 : aLength > bLength ? 1 : 0;
+}
+
+/* A list of packed positions, all in one block */
+class PackedPositions
+{
+	private:
+		std::vector<Uint8> bytes;
+		std::vector<size_t> starts;		// of each position in bytes
+
+	public:
+		/* Construction */
+		void push_back(const position &p) { starts.push_back( bytes.size() ); packPosition( p, bytes ); }
+		void push_back(const Uint8 *packed, size_t length) { starts.push_back( bytes.size() ); bytes.insert( bytes.end(), packed, packed + length ); }	// packed already
+		void clear() { std::vector<Uint8>().swap( bytes ); std::vector<size_t>().swap( starts ); }	// and give the memory back
+
+		/* Queries */
+		size_t size() const { return starts.size(); }
+		bool empty() const { return starts.empty(); }
+		void get(size_t i, position &p) const { unpackPosition( &bytes[ starts[i] ], p ); }
+		const Uint8 *data(size_t i) const { return &bytes[ starts[i] ]; }
+		size_t length(size_t i) const { return (i + 1 < starts.size() ? starts[i + 1] : bytes.size()) - starts[i]; }
+		size_t memory() const { return bytes.capacity() + starts.capacity()*sizeof(size_t); }	// bytes held
+};
+
+#endif
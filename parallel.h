@@ -0,0 +1,275 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <deque>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+#include "solver.h"
+
+/* The solver on several threads : the top of the game tree is opened up into tasks (the positions a few moves down),
+ * every thread searches tasks with its own Solver on one shared lock-free TranspositionTable, and a thread that runs
+ * out of tasks steals from the others. Each thread keeps its tasks in tree order and starts from the front, so the
+ * eldest brother of a family is searched before its younger brothers (Young Brothers Wait); thieves take from the back.
+ * Results are passed up the open tree as they come in : a lost child wins its parent at once, and every task below a
+ * decided position is given up */
+
+/* Global constants for the parallel solver */
+static const int parallelTasks = 32;		// tasks per thread the top of the tree is opened up into
+static const int parallelMaxDepth = 4;		// moves deep the top of the tree may be opened
+/* End constants */
+
+class ParallelSolver
+{
+	private:
+		struct node					// a position in the open top of the tree
+		{
+			int parent, firstChild, children;	// a node's children are stored together
+			sproutsMove move;		// the move from the parent, in the caller's terms for children of the root
+			position canon;			// canonical, except the root (kept as given)
+			Uint64 key;
+			volatile int value;		// +1 win, -1 loss for the player to move, 0 not decided yet
+			volatile int pending;	// children still to come back won (for the node to be lost)
+		};
+		struct worker
+		{
+			ParallelSolver *owner;
+			int index;
+			Solver *solver;
+			std::deque<int> tasks;	// nodes to search, in tree order
+			volatile int queued;	// tasks.size(), for thieves to read without the lock
+			SDL_mutex *lock;
+			int task;				// node being searched
+		};
+
+		TranspositionTable table;
+		std::vector<node> tree;
+		std::vector<worker> workers;
+
+		/* Private functions */
+		void open(const position&, int);		// open the top of the tree into tasks, dealt out to the threads
+		void finish(int, int);					// a node's value is known : pass it up
+		bool decided(int) const;				// true once the node or one of its ancestors has a value
+		bool nextTask(worker&);
+		static int run(void*);
+		static bool cancelled(void*);
+
+	public:
+		/* Constructors */
+		ParallelSolver(int=solverTableBits);
+
+		/* Public variables */
+		Uint64 nodes;					// positions searched by all threads in the last solve
+		sproutsRules rules;				// normalPlay unless set
+		const Tablebase *tablebase;		// endgame outcomes for every thread, if set
+
+		/* Queries */
+		bool solve(const position&, int, sproutsMove* =NULL, int* =NULL);	// true if the player to move wins, searched on the given number of threads - as Solver::solve
+		void clear() { table.clear(); }
+};
+ParallelSolver::ParallelSolver(int bits) : table( bits )
+{
+	nodes = 0;
+	rules = normalPlay;
+	tablebase = NULL;
+}
+bool ParallelSolver::decided(int n) const
+{
+	for( ; n >= 0; n = tree[n].parent )
+		if( tree[n].value )
+			return true;
+	return false;
+}
+/* The first value in sticks : a node decided by one child is not decided again by another */
+void ParallelSolver::finish(int n, int value)
+{
+	while( __sync_bool_compare_and_swap( &tree[n].value, 0, value ) )
+	{
+		int parent = tree[n].parent;
+		if( parent < 0 )
+			return;
+		table.store( tree[n].key, value );
+		if( value < 0 )		// the parent can move here and win
+		{
+			n = parent;
+			value = 1;
+		}
+		else if( __sync_sub_and_fetch( &tree[parent].pending, 1 ) == 0 )	// every child won : the parent is lost
+		{
+			n = parent;
+			value = -1;
+		}
+		else
+			return;
+	}
+}
+void ParallelSolver::open(const position &root, int threads)
+{
+	Canonicalizer canonicalizer;
+	std::vector<sproutsMove> moves;
+	std::vector<Uint64> children;
+	std::vector<int> level, nextLevel, leaves;
+	position child;
+	node top;
+	top.parent = -1;
+	top.firstChild = top.children = 0;
+	top.canon = root;
+	top.key = 0;
+	top.value = top.pending = 0;
+	tree.assign( 1, top );
+	level.push_back( 0 );
+	for( int depth = 0; !level.empty() && depth < parallelMaxDepth && (int)level.size() < parallelTasks*threads; depth++ )
+	{
+		nextLevel.clear();
+		for( unsigned i = 0; i < level.size(); i++ )
+		{
+			int n = level[i];
+			generateMoves( tree[n].canon, moves );
+			children.clear();
+			tree[n].firstChild = tree.size();
+			for( unsigned m = 0; m < moves.size(); m++ )
+			{
+				node c = top;
+				c.parent = n;
+				c.move = moves[m];
+				applyMove( tree[n].canon, moves[m], child );
+				canonicalizer.canonical( child, c.canon );
+				c.key = positionHash( c.canon, rules );
+				if( std::find( children.begin(), children.end(), c.key ) != children.end() )
+					continue;
+				children.push_back( c.key );
+				tree.push_back( c );
+				nextLevel.push_back( tree.size() - 1 );
+			}
+			tree[n].children = tree[n].pending = children.size();
+			if( children.empty() )		// no move : decided by the rules, and nothing to search
+				leaves.push_back( n );
+		}
+		level.swap( nextLevel );
+	}
+	for( unsigned i = 0; i < leaves.size(); i++ )
+		finish( leaves[i], rules == misere ? 1 : -1 );
+
+	/* Deal the unopened positions out depth first, eldest child first, a run of neighbours to each thread */
+	std::vector<int> order, stack( 1, 0 );
+	while( !stack.empty() )
+	{
+		int n = stack.back();
+		stack.pop_back();
+		if( tree[n].value )
+			continue;
+		if( !tree[n].children )
+			order.push_back( n );
+		for( int c = tree[n].firstChild + tree[n].children - 1; c >= tree[n].firstChild; c-- )
+			stack.push_back( c );
+	}
+	for( unsigned i = 0; i < order.size(); i++ )
+		workers[ i*threads/order.size() ].tasks.push_back( order[i] );
+	for( int i = 0; i < threads; i++ )
+		workers[i].queued = workers[i].tasks.size();
+}
+/* Own tasks from the front, else steal from the back of the fullest other thread */
+bool ParallelSolver::nextTask(worker &w)
+{
+	SDL_mutexP( w.lock );
+	bool own = !w.tasks.empty();
+	if( own )
+	{
+		w.task = w.tasks.front();
+		w.tasks.pop_front();
+		w.queued = w.tasks.size();
+	}
+	SDL_mutexV( w.lock );
+	while( !own )
+	{
+		int victim = -1, most = 0;
+		for( unsigned i = 0; i < workers.size(); i++ )
+			if( workers[i].queued > most )		// may be stale : checked again under the lock
+			{
+				most = workers[i].queued;
+				victim = i;
+			}
+		if( victim < 0 )
+			return false;
+		worker &v = workers[victim];
+		SDL_mutexP( v.lock );
+		own = !v.tasks.empty();
+		if( own )
+		{
+			w.task = v.tasks.back();
+			v.tasks.pop_back();
+			v.queued = v.tasks.size();
+		}
+		SDL_mutexV( v.lock );
+	}
+	return true;
+}
+bool ParallelSolver::cancelled(void *data)
+{
+	worker *w = (worker*)data;
+	return w->owner->decided( w->task );
+}
+int ParallelSolver::run(void *data)
+{
+	worker &w = *(worker*)data;
+	ParallelSolver &owner = *w.owner;
+	while( !owner.tree[0].value && owner.nextTask( w ) )
+	{
+		if( owner.decided( w.task ) )
+			continue;
+		int value = w.solver->search( owner.tree[w.task].canon, owner.tree[w.task].key );
+		if( value )		// 0 : given up, a position above it was decided
+			owner.finish( w.task, value );
+	}
+	return 0;
+}
+/* The root's children are opened first, so the winning move is in the caller's terms as with Solver::solve - and as
+ * there, a misère win with no move leaves best as it was */
+bool ParallelSolver::solve(const position &p, int threads, sproutsMove *best, int *moveCount)
+{
+	std::vector<SDL_Thread*> running( threads );
+	workers.assign( threads, worker() );
+	for( int i = 0; i < threads; i++ )
+	{
+		workers[i].owner = this;
+		workers[i].index = i;
+		workers[i].solver = new Solver( table );
+		workers[i].solver->rules = rules;
+		workers[i].solver->tablebase = tablebase;
+		workers[i].solver->stop = cancelled;
+		workers[i].solver->stopData = &workers[i];
+		workers[i].lock = SDL_CreateMutex();
+		workers[i].task = 0;
+	}
+	open( p, threads );
+	if( moveCount )
+	{
+		std::vector<sproutsMove> moves;
+		generateMoves( p, moves );
+		*moveCount = moves.size();
+	}
+	for( int i = 0; i < threads; i++ )
+		running[i] = SDL_CreateThread( run, &workers[i] );
+	nodes = tree.size();
+	for( int i = 0; i < threads; i++ )
+	{
+		if( running[i] )
+			SDL_WaitThread( running[i], NULL );
+		else		// could not start a thread : the others steal its tasks, or they are run here
+			run( &workers[i] );
+		nodes += workers[i].solver->nodes;
+		delete workers[i].solver;
+		SDL_DestroyMutex( workers[i].lock );
+	}
+	if( tree[0].value > 0 && best )
+		for( int c = tree[0].firstChild; c < tree[0].firstChild + tree[0].children; c++ )
+			if( tree[c].value < 0 )
+			{
+				*best = tree[c].move;
+				break;
+			}
+	return tree[0].value > 0;
+}
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "faces.h"
+
+/* The board as a Sprouts position : what is left to play, without the curves
+ * A position is a list of regions (faces), each a list of boundaries, each the live spots met walking around it.
+ * Written in the usual notation : a boundary ends with '.', a region with '}', the position with '!'
+ * and a spot is
+ *   0, 1 or 2	a spot met once on the whole board, by the number of lines at it (0 : isolated, 3 lives left)
+ *   A-Z, a-z	a spot met more than once (a spot with one life between two regions, or twice on one boundary)
+ *   [n]		the same, once the 52 letters are used up
+ * Spots with no lives left are left out, and so are boundaries and regions left with no spots :
+ * "0.0.}!" is the two spot start, "1A1A.}!" the board after joining the two spots with a line */
+
+/* Global constants for positions */
+static const int positionLives = 3;			// lines a spot may have
+static const int positionLabel = 3;			// spot codes below this are the digits 0, 1, 2 : from here up they are labels
+static const int positionLetters = 52;		// labels written as a single letter
+/* End constants */
+
+struct position
+{
+	std::vector<int> spots;			// every boundary's spot codes one after the other : digit, or positionLabel + label
+	std::vector<int> boundaryEnd;	// end of each boundary in spots
+	std::vector<int> regionEnd;		// end of each region in boundaryEnd
+	int labels;						// labels used (0 .. labels-1)
+};
+
+/* Where a position came from on the board, to play its moves there */
+struct positionSource
+{
+	std::vector<int> spot;		// map spot of each occurrence in position::spots
+	std::vector<int> edge;		// half-edge leaving it along its boundary (-1 : an isolated spot)
+	std::vector<int> face;		// map face of each region
+};
+
+/* Walk every boundary of every face once : linear in the size of the board
+ * joint marks map spots that are not Sprouts spots (bends inside a routed line) - they are passed over like dead spots */
+void extractPosition(const PlanarMap &map, const std::vector<bool> &joint, position &p, positionSource *source = NULL)
+{
+	std::vector<int> lines( map.spots(), 0 ), label( map.spots(), -1 ), boundary;
+	p.spots.clear();
+	p.boundaryEnd.clear();
+	p.regionEnd.clear();
+	p.labels = 0;
+	if( source )
+	{
+		source->spot.clear();
+		source->edge.clear();
+		source->face.clear();
+	}
+	for( int h = 0; h < map.edgeCount(); h++ )		// a loop leaves its spot twice : two lines' worth
+		lines[ map.edge(h).origin ]++;
+	for( int f = 0; f < map.faces(); f++ )
+	{
+		const std::vector<int> &b = map.boundaries(f);
+		for( unsigned i = 0; i < b.size(); i++ )
+		{
+			map.boundarySpots( b[i], boundary );
+			int h = b[i];		// boundary[j] leaves along h
+			for( unsigned j = 0; j < boundary.size(); j++, h = h < 0 ? h : map.edge(h).next )
+			{
+				int s = boundary[j];
+				if( (s < (int)joint.size() && joint[s]) || lines[s] >= positionLives )
+					continue;
+				if( lines[s] < 2 )		// 0 or 1 line : one wedge, met only here
+					p.spots.push_back( lines[s] );
+				else
+				{
+					if( label[s] < 0 )
+						label[s] = p.labels++;
+					p.spots.push_back( positionLabel + label[s] );
+				}
+				if( source )
+				{
+					source->spot.push_back( s );
+					source->edge.push_back( h < 0 ? -1 : h );
+				}
+			}
+			if( p.spots.size() > (p.boundaryEnd.empty() ? 0 : (unsigned)p.boundaryEnd.back()) )
+				p.boundaryEnd.push_back( p.spots.size() );
+		}
+		if( p.boundaryEnd.size() > (p.regionEnd.empty() ? 0 : (unsigned)p.regionEnd.back()) )
+		{
+			p.regionEnd.push_back( p.boundaryEnd.size() );
+			if( source )
+				source->face.push_back( f );
+		}
+	}
+}
+
+void writeSpot(int code, std::string &out)
+{
+	int label = code - positionLabel;
+	if( code < positionLabel )
+		out += (char)('0' + code);
+	else if( label < 26 )
+		out += (char)('A' + label);
+	else if( label < positionLetters )
+		out += (char)('a' + label - 26);
+	else
+	{
+		char buffer[16];
+		sprintf( buffer, "[%d]", label );
+		out += buffer;
+	}
+}
+void writePosition(const position &p, std::string &out)
+{
+	out.clear();
+	unsigned spot = 0, bound = 0;
+	for( unsigned r = 0; r < p.regionEnd.size(); r++ )
+	{
+		for( ; bound < (unsigned)p.regionEnd[r]; bound++ )
+		{
+			for( ; spot < (unsigned)p.boundaryEnd[bound]; spot++ )
+				writeSpot( p.spots[spot], out );
+			out += '.';
+		}
+		out += '}';
+	}
+	out += '!';
+}
+/* Read the notation back - false if the text is not a position (anything after the '!' is ignored) */
+bool readPosition(const char *text, position &p)
+{
+	p.spots.clear();
+	p.boundaryEnd.clear();
+	p.regionEnd.clear();
+	p.labels = 0;
+	for( const char *c = text; ; c++ )
+	{
+		int label = -1;
+		if( *c >= '0' && *c <= '2' )
+			p.spots.push_back( *c - '0' );
+		else if( *c >= 'A' && *c <= 'Z' )
+			label = *c - 'A';
+		else if( *c >= 'a' && *c <= 'z' )
+			label = *c - 'a' + 26;
+		else if( *c == '[' )
+		{
+			char *end;
+			label = (int)strtol( c + 1, &end, 10 );
+			if( end == c + 1 || *end != ']' || label < 0 )
+				return false;
+			c = end;
+		}
+		else if( *c == '.' )
+			p.boundaryEnd.push_back( p.spots.size() );
+		else if( *c == '}' )
+		{
+			if( (p.boundaryEnd.empty() ? 0 : p.boundaryEnd.back()) != (int)p.spots.size() )		// spots after the last '.'
+				return false;
+			p.regionEnd.push_back( p.boundaryEnd.size() );
+		}
+		else if( *c == '!' )
+			return (p.regionEnd.empty() ? 0 : p.regionEnd.back()) == (int)p.boundaryEnd.size()
+				&& (p.boundaryEnd.empty() ? 0 : p.boundaryEnd.back()) == (int)p.spots.size();
+		else
+			return false;
+		if( label >= 0 )
+		{
+			p.spots.push_back( positionLabel + label );
+			p.labels = std::max( p.labels, label + 1 );
+		}
+	}
+}
+
+#endif
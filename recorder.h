@@ -0,0 +1,283 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+
+/* Input recorded to a file and played back, so the drawing code can be timed on the same clicks and drags every run.
+ * Every event the main loop takes from the queue is written with the milliseconds since recording started - input and
+ * window events only : the analysis' user events come from a thread and are not input. Played back, the events are
+ * pushed onto the queue from a thread of their own, at the recorded times or as fast as the main loop takes them, and a
+ * user event (replayEventCode) says when the last one is in. The events that ended the recording (the window closed, or
+ * Escape) are held back until after it, so the replayed board is reported on before the program quits.
+ * The same board comes back only from the same start : the header keeps the seed the first random line was drawn with
+ * (or the number of spots the game started from), the window size and where the mouse was. The computer's moves (Monte Carlo) are not seeded from it, so a replay
+ * follows a recording exactly only if they were not used. The board a replay leaves is checked for crossing lines.
+ * File : header, then one 16 byte record an event */
+
+/* Global constants for input recording */
+static const Uint32 recorderVersion = 1;
+static const char recorderMagic[8] = { 'S','P','R','O','U','T','E','V' };
+static const int replayEventCode = 2;		// SDL_UserEvent code of the end of a replay, data1 holding the EventReplayer
+/* End constants */
+
+struct recorderHeader
+{
+	char magic[8];
+	Uint32 version, recordSize;
+	Uint32 seed;				// for srand before the board is made
+	Uint16 width, height;		// of the window recorded in
+	Uint16 mouseX, mouseY;		// where the mouse was when recording started
+	Uint16 spots;				// spots the game started from, 0 for a random line
+	Uint8 padding[34];
+};
+struct recordedEvent
+{
+	Uint32 time;				// milliseconds since recording started
+	Uint8 type;					// SDL event type
+	Uint8 a, b, c;				// keys : state / buttons : button, state / motion : button state / active : gain, state
+	Uint16 x, y;				// mouse position - keys : symbol, modifiers
+	Sint16 dx, dy;				// motion : relative movement - keys : unicode
+};
+
+class EventRecorder
+{
+	private:
+		FILE *file;
+		Uint32 start;
+
+	public:
+		/* Constructors */
+		EventRecorder();
+		~EventRecorder() { close(); }
+
+		/* Construction */
+		bool open(const char*, Uint32, int, int, int=0);	// start a recording : file, seed, window width and height, start spots - false if it cannot be written
+		void record(const SDL_Event&);				// input events only, the rest are passed over
+		void close();
+
+		/* Queries */
+		bool isOpen() const { return file != NULL; }
+};
+EventRecorder::EventRecorder()
+{
+	file = NULL;
+	start = 0;
+}
+bool EventRecorder::open(const char *path, Uint32 seed, int width, int height, int spots)
+{
+	close();
+	recorderHeader h;
+	int x, y;
+	memset( &h, 0, sizeof(h) );
+	memcpy( h.magic, recorderMagic, sizeof(recorderMagic) );
+	h.version = recorderVersion;
+	h.recordSize = sizeof(recordedEvent);
+	h.seed = seed;
+	h.width = width;
+	h.height = height;
+	h.spots = spots;
+	SDL_GetMouseState( &x, &y );
+	h.mouseX = x;
+	h.mouseY = y;
+	file = fopen( path, "wb" );
+	if( !file )
+		return false;
+	if( fwrite( &h, sizeof(h), 1, file ) != 1 )
+	{
+		close();
+		return false;
+	}
+	start = SDL_GetTicks();
+	return true;
+}
+void EventRecorder::record(const SDL_Event &event)
+{
+	if( !file )
+		return;
+	recordedEvent e;
+	memset( &e, 0, sizeof(e) );
+	e.time = SDL_GetTicks() - start;
+	e.type = event.type;
+	switch( event.type )
+	{
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			e.a = event.key.state;
+			e.x = event.key.keysym.sym;
+			e.y = event.key.keysym.mod;
+			e.dx = event.key.keysym.unicode;
+			break;
+		case SDL_MOUSEMOTION:
+			e.a = event.motion.state;
+			e.x = event.motion.x;
+			e.y = event.motion.y;
+			e.dx = event.motion.xrel;
+			e.dy = event.motion.yrel;
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			e.a = event.button.button;
+			e.b = event.button.state;
+			e.x = event.button.x;
+			e.y = event.button.y;
+			break;
+		case SDL_ACTIVEEVENT:
+			e.a = event.active.gain;
+			e.b = event.active.state;
+			break;
+		case SDL_VIDEOEXPOSE:
+		case SDL_QUIT:
+			break;
+		default:		// user events, and anything the program does not act on
+			return;
+	}
+	fwrite( &e, sizeof(e), 1, file );
+}
+void EventRecorder::close()
+{
+	if( file )
+		fclose( file );
+	file = NULL;
+}
+
+class EventReplayer
+{
+	private:
+		std::vector<recordedEvent> events;
+		unsigned held;				// events from here on ended the recording : pushed after the end of the replay
+		SDL_Thread *thread;
+		volatile bool stopping;
+
+		/* Private functions */
+		static int run(void*);
+
+	public:
+		/* Constructors */
+		EventReplayer();
+		~EventReplayer();
+
+		/* Public variables */
+		recorderHeader header;		// of the recording opened
+		bool fast;					// push each event as soon as the one before has been taken, not at the recorded times
+		Uint32 started, finished;	// ticks the replay started and pushed its last event
+
+		/* Construction */
+		bool open(const char*);		// read a recording, false if it is missing or not one
+		bool start();				// start pushing its events, false if the thread could not be started
+
+		/* Queries */
+		size_t count() const { return held; }		// events replayed before its end
+};
+EventReplayer::EventReplayer()
+{
+	thread = NULL;
+	held = 0;
+	stopping = false;
+	fast = false;
+	started = finished = 0;
+	memset( &header, 0, sizeof(header) );
+}
+EventReplayer::~EventReplayer()
+{
+	stopping = true;
+	if( thread )
+		SDL_WaitThread( thread, NULL );
+}
+bool EventReplayer::open(const char *path)
+{
+	FILE *in = fopen( path, "rb" );
+	if( !in )
+		return false;
+	recordedEvent e;
+	bool valid = fread( &header, sizeof(header), 1, in ) == 1 && !memcmp( header.magic, recorderMagic, sizeof(recorderMagic) )
+		&& header.version == recorderVersion && header.recordSize == sizeof(recordedEvent);
+	events.clear();
+	while( valid && fread( &e, sizeof(e), 1, in ) == 1 )
+		events.push_back( e );
+	fclose( in );
+	held = events.size();
+	if( held && (events[held-1].type == SDL_QUIT || (events[held-1].type == SDL_KEYUP && events[held-1].x == SDLK_ESCAPE)) )
+		held--;
+	if( held && events[held-1].type == SDL_KEYDOWN && events[held-1].x == SDLK_ESCAPE )		// the press of the Escape released
+		held--;
+	return valid;
+}
+bool EventReplayer::start()
+{
+	if( thread )
+		return false;
+	started = SDL_GetTicks();
+	thread = SDL_CreateThread( run, this );
+	return thread != NULL;
+}
+/* The queue holds few events (SDL_MAXEVENTS) : when it is full the push is tried again a millisecond later.
+ * Fast, every event is handled on its own, so a replay always does the same drawing.
+ * Slot held is the end of the replay, the recorded events after it are shifted up one */
+int EventReplayer::run(void *data)
+{
+	EventReplayer &r = *(EventReplayer*)data;
+	SDL_Event event;
+	for( unsigned i = 0; i <= r.events.size() && !r.stopping; i++ )
+	{
+		if( i == r.held )
+		{
+			r.finished = SDL_GetTicks();
+			memset( &event, 0, sizeof(event) );
+			event.type = SDL_USEREVENT;
+			event.user.code = replayEventCode;
+			event.user.data1 = &r;
+			while( !r.stopping && SDL_PushEvent( &event ) < 0 )
+				SDL_Delay( 1 );
+			continue;
+		}
+		const recordedEvent &e = r.events[ i < r.held ? i : i - 1 ];
+		if( !r.fast )
+			while( SDL_GetTicks() - r.started < e.time && !r.stopping )
+				SDL_Delay( std::min( e.time - (SDL_GetTicks() - r.started), (Uint32)10 ) );
+		else		// once the main loop has taken the last one : it would skip a mouse motion with a newer one queued behind it
+			while( SDL_PeepEvents( &event, 1, SDL_PEEKEVENT, SDL_ALLEVENTS ) > 0 && !r.stopping )
+				SDL_Delay( 0 );
+		memset( &event, 0, sizeof(event) );
+		event.type = e.type;
+		switch( e.type )
+		{
+			case SDL_KEYDOWN:
+			case SDL_KEYUP:
+				event.key.state = e.a;
+				event.key.keysym.sym = (SDLKey)e.x;
+				event.key.keysym.mod = (SDLMod)e.y;
+				event.key.keysym.unicode = e.dx;
+				break;
+			case SDL_MOUSEMOTION:
+				event.motion.state = e.a;
+				event.motion.x = e.x;
+				event.motion.y = e.y;
+				event.motion.xrel = e.dx;
+				event.motion.yrel = e.dy;
+				break;
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP:
+				event.button.button = e.a;
+				event.button.state = e.b;
+				event.button.x = e.x;
+				event.button.y = e.y;
+				break;
+			case SDL_ACTIVEEVENT:
+				event.active.gain = e.a;
+				event.active.state = e.b;
+				break;
+			default:
+				break;
+		}
+		while( SDL_PushEvent( &event ) < 0 && !r.stopping )
+			SDL_Delay( 1 );
+	}
+	return 0;
+}
+
+#endif
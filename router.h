@@ -0,0 +1,678 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+#include "geometry.h"
+#include "faces.h"
+#include "triangulation.h"
+
+/* Automatic lines between two spots - the reroute steps from gamePlan.txt :
+ *	region test		the spots must share a face (PlanarMap)
+ *	straight test	one cubic leaving each spot through the middle of its corner of that face, if it crosses nothing
+ *	reroute			A* on a grid over the board, kept away from the curves, pulled tight and fitted with a chain of cubics
+ *	threading		where the grid has no way through or no legal line along it, the shortest path through a triangulation of the board (if given), fitted the same way
+ * Everything returned has been tested against the exact curves, so a route is always a legal line.
+ * A line splitting a face may be asked which side of it other boundaries end up on : as a side of the ray from a point
+ * of each towards +x, crossed an odd or an even number of times. The A* then searches cells and crossings so far
+ * together (each side doubles the states), pulling tight keeps the crossings, and the chain is checked exactly */
+
+/* Global constants for routing */
+static const double routeCell = 4;				// grid cell size in pixels
+static const int routeClearance = 3;			// cells the route tries to keep between itself and other curves
+static const double routePenalty = 4;			// extra cost of a step right next to a curve (falls off to 0 at routeClearance)
+static const int routeLaunchSteps = 16;			// half cells searched along the middle of a corner for a free cell to start from
+static const double routeLoopSize = 60;			// length of the control arms of a loop from a spot back to itself
+static const int routeSidesMax = 6;				// sides the A* follows : any more are only checked on the chain found
+/* End constants */
+
+struct routeSide				// the line crosses the ray from (x,y) towards +x an odd number of times, or an even one
+{ double x, y; bool odd; };
+
+class Router
+{
+	private:
+		const PlanarMap &map;
+		Triangulation *mesh;				// the same board's free space, for passages too narrow for the grid (NULL : grid only)
+		box area;							// part of the plane the grid covers (the screen)
+		int columns, rows;
+		std::vector<unsigned char> clear;	// distance in cells to the nearest curve, capped at routeClearance (0 : a curve passes through the cell)
+		std::vector<float> cost;			// A* distance from the start
+		std::vector<int> parent;			// A* tree (-1 : not reached)
+		std::vector<unsigned char> closed;	// cells A* has finished with
+		std::vector<int> visited;			// cells to reset before the next search
+		typedef std::pair<float, int> entry;
+		typedef std::pair<int, unsigned char> kept;	// a cell walled off, and the clearance it had
+		std::vector<entry> open;			// A* queue (a heap, kept between searches for its memory)
+		std::vector<routeSide> sides;		// asked of the route being searched
+		int sideBits;						// of them the A* follows : a state is cell << sideBits | crossings so far
+
+		/* Private functions */
+		void rasterize();						// mark the cells the curves pass through and spread the clearance out from them
+		void spread(std::vector<int>&, std::vector<kept>*);	// from these blocked cells, keeping what the cells had if asked
+		int cell(double, double) const;			// grid cell holding a point (-1 : off the grid)
+		void centre(int, double&, double&) const;
+		double middle(int) const;				// direction out of a spot through the middle of the corner a half-edge leaves it by (in the half-edge's face)
+		double corner(int, int, double, double) const;	// the same for a spot's corner in a face, the one facing the point best
+		double opening(int) const;				// direction out of an isolated spot with the most room either side
+		bool launch(int, double, double&, double&) const;	// first free point out from the spot along the direction
+		void wall(double, double, double, double, int, int, std::vector<kept>&);	// block the cells along a segment but two, and spread the clearance from them
+		void unwall(std::vector<kept>&, unsigned);	// undo the walls back to this many cells kept
+		bool touching(const std::vector<int>&, unsigned, unsigned&, unsigned&) const;	// the first cell of a path (from a place on) next to one it was in before
+		bool search(int, int, unsigned, std::vector<int>&);		// A* between two cells, arriving with the given crossings : path from start to goal
+		unsigned crossings(double, double, double, double) const;	// a bit for each side whose ray the segment crosses
+		bool sided(const std::vector<cubic>&) const;		// exact test : the chain crosses every side's ray as asked
+		bool visible(double, double, double, double, int) const;	// straight segment through cells at least this clear
+		bool legal(const std::vector<cubic>&) const;		// exact test : no crossings with the board or along the chain
+		void fit(const std::vector<double>&, const std::vector<double>&, double, double, std::vector<cubic>&) const;
+		void polyline(const std::vector<double>&, const std::vector<double>&, std::vector<cubic>&) const;	// straight cubics from point to point
+		bool thread(const boardSpot&, const boardSpot&, double, double, double, double, double, double, std::vector<cubic>&);	// from spot to spot by way of two launch points, on the mesh's shortest path between them
+
+	public:
+		/* Constructors */
+		Router(const PlanarMap&, const box&, Triangulation* =NULL);
+
+		/* Routing */
+		bool route(int, int, std::vector<cubic>&, int=-1, const std::vector<routeSide>* =NULL, int=-1, int=-1);	// chain of cubics from one spot to another (the same spot : a loop) in any face they share, or only the given one, on the sides given and leaving and arriving by the corners given (as half-edges, -1 : any) - false if there is no room
+};
+Router::Router(const PlanarMap &m, const box &b, Triangulation *t) : map(m), mesh(t), area(b)
+{
+	columns = std::max( 1, (int)ceil( (b.x1 - b.x0)/routeCell ) );
+	rows = std::max( 1, (int)ceil( (b.y1 - b.y0)/routeCell ) );
+	clear.resize( columns*rows );
+	cost.resize( columns*rows );
+	parent.assign( columns*rows, -1 );
+	closed.assign( columns*rows, 0 );
+	sideBits = 0;
+}
+/* Octile distance : the cheapest 8-neighbour walk with no curves in the way */
+inline float octile(int di, int dj)
+{
+	di = abs(di);
+	dj = abs(dj);
+	return di > dj ? di + 0.41421356f*dj : dj + 0.41421356f*di;
+}
+inline int Router::cell(double x, double y) const
+{
+	int i = (int)floor( (x - area.x0)/routeCell ), j = (int)floor( (y - area.y0)/routeCell );
+	if( i < 0 || j < 0 || i >= columns || j >= rows )
+		return -1;
+	return j*columns + i;
+}
+inline void Router::centre(int c, double &x, double &y) const
+{
+	x = area.x0 + (c % columns + 0.5)*routeCell;
+	y = area.y0 + (c / columns + 0.5)*routeCell;
+}
+/* Breadth first from every cell a curve passes through - 8 neighbours, so the distance is in chessboard cells */
+void Router::rasterize()
+{
+	std::vector<int> queue;
+	clear.assign( columns*rows, routeClearance );
+	for( int i = 0; i < map.curveCount(); i++ )
+	{
+		cubic c = map.edgeCurve( 2*i );
+		double length = 0;
+		for( int k = 0; k < 3; k++ )
+			length += sqrt( (c.x[k+1] - c.x[k])*(c.x[k+1] - c.x[k]) + (c.y[k+1] - c.y[k])*(c.y[k+1] - c.y[k]) );
+		int steps = 1 + (int)( 2*length/routeCell );		// control polygon is longer than the curve : at least two points per cell
+		for( int k = 0; k <= steps; k++ )
+		{
+			double x, y;
+			evaluate( c, (double)k/steps, x, y );
+			int at = cell( x, y );
+			if( at >= 0 && clear[at] )
+			{
+				clear[at] = 0;
+				queue.push_back( at );
+			}
+		}
+	}
+	for( int s = 0; s < map.spots(); s++ )		// isolated spots are boundaries too : lines go round them, with room left for a loop
+		for( int k = 0; k < 9 && map.leaving(s) < 0; k++ )
+		{
+			int at = cell( map.spot(s).x + (k % 3 - 1)*routeCell, map.spot(s).y + (k / 3 - 1)*routeCell );
+			if( at >= 0 && clear[at] )
+			{
+				clear[at] = 0;
+				queue.push_back( at );
+			}
+		}
+	spread( queue, NULL );
+}
+void Router::spread(std::vector<int> &queue, std::vector<kept> *saved)
+{
+	for( unsigned head = 0; head < queue.size(); head++ )
+	{
+		int at = queue[head], i = at % columns, j = at / columns;
+		if( clear[at] + 1 >= routeClearance )
+			continue;
+		for( int dj = -1; dj <= 1; dj++ )
+			for( int di = -1; di <= 1; di++ )
+			{
+				int ni = i + di, nj = j + dj;
+				if( ni < 0 || nj < 0 || ni >= columns || nj >= rows )
+					continue;
+				int next = nj*columns + ni;
+				if( clear[next] > clear[at] + 1 )
+				{
+					if( saved )
+						saved->push_back( kept( next, clear[next] ) );
+					clear[next] = clear[at] + 1;
+					queue.push_back( next );
+				}
+			}
+	}
+}
+double Router::middle(int h) const
+{
+	double gap = map.edge( map.counterClockwiseOf(h) ).angle - map.edge(h).angle;
+	if( gap <= 0 )
+		gap += 6.283185307179586;		// wraps past -pi, or the spot's only curve (a full turn)
+	return map.edge(h).angle + gap/2;
+}
+double Router::corner(int s, int f, double towardsX, double towardsY) const
+{
+	const boardSpot &p = map.spot(s);
+	double towards = atan2( towardsY - p.y, towardsX - p.x );
+	int first = map.leaving(s);
+	if( first < 0 )		// isolated spot : straight at the other end
+		return towards;
+	double best = 0, bestMiss = 10;
+	int h = first;
+	do
+	{
+		if( map.faceOf(h) == f )
+		{
+			double angle = middle(h), miss = fabs( atan2( sin(angle - towards), cos(angle - towards) ) );
+			if( miss < bestMiss )
+			{
+				best = angle;
+				bestMiss = miss;
+			}
+		}
+		h = map.counterClockwiseOf(h);
+	} while( h != first );
+	return best;
+}
+/* Scored by the clearance along the two ways a loop leaves by, out to the first curve */
+double Router::opening(int s) const
+{
+	const boardSpot &p = map.spot(s);
+	double best = 0;
+	int bestRoom = -1;
+	for( int k = 0; k < 16; k++ )
+	{
+		double angle = k*6.283185307179586/16;		// 2 pi
+		int room = 0;
+		for( int side = -1; side <= 1; side += 2 )
+			for( int step = 2; step <= routeLaunchSteps; step++ )
+			{
+				double d = step*routeCell/2;
+				int at = cell( p.x + d*cos(angle + side*0.6), p.y + d*sin(angle + side*0.6) );
+				if( at < 0 || (!clear[at] && step > 2) )
+					break;
+				room += clear[at];
+			}
+		if( room > bestRoom )
+		{
+			best = angle;
+			bestRoom = room;
+		}
+	}
+	return best;
+}
+bool Router::launch(int s, double angle, double &x, double &y) const
+{
+	const boardSpot &p = map.spot(s);
+	int fallback = -1;
+	bool left = false;
+	for( int k = 2; k <= routeLaunchSteps; k++ )
+	{
+		double d = k*routeCell/2;
+		int at = cell( p.x + d*cos(angle), p.y + d*sin(angle) );
+		if( at < 0 )
+			break;
+		if( !clear[at] )		// past the spot's own cells : a curve, and beyond it the other side
+		{
+			if( left )
+				break;
+			continue;
+		}
+		left = true;
+		if( clear[at] > 1 || (clear[at] == 1 && fallback < 0) )
+		{
+			x = p.x + d*cos(angle);
+			y = p.y + d*sin(angle);
+			if( clear[at] > 1 )
+				return true;
+			fallback = k;
+		}
+	}
+	return fallback >= 0;
+}
+void Router::wall(double x0, double y0, double x1, double y1, int keep, int keepToo, std::vector<kept> &saved)
+{
+	std::vector<int> queue;
+	double length = sqrt( (x1 - x0)*(x1 - x0) + (y1 - y0)*(y1 - y0) );
+	int steps = 1 + (int)( 2*length/routeCell );
+	for( int k = 0; k <= steps; k++ )
+	{
+		int at = cell( x0 + (x1 - x0)*k/steps, y0 + (y1 - y0)*k/steps );
+		if( at < 0 || at == keep || at == keepToo || !clear[at] )
+			continue;
+		saved.push_back( kept( at, clear[at] ) );
+		clear[at] = 0;
+		queue.push_back( at );
+	}
+	spread( queue, &saved );
+}
+void Router::unwall(std::vector<kept> &saved, unsigned back)
+{
+	while( saved.size() > back )
+	{
+		clear[ saved.back().first ] = saved.back().second;
+		saved.pop_back();
+	}
+}
+/* Three steps apart at least : a path turning a corner is next to itself two steps on */
+bool Router::touching(const std::vector<int> &path, unsigned from, unsigned &before, unsigned &after) const
+{
+	for( after = from + 3; after < path.size(); after++ )
+		for( before = from; before + 3 <= after; before++ )
+			if( abs( path[before] % columns - path[after] % columns ) <= 1 && abs( path[before] / columns - path[after] / columns ) <= 1 )
+				return true;
+	return false;
+}
+bool Router::search(int start, int goal, unsigned arrive, std::vector<int> &path)
+{
+	static const int neighbourI[8] = { 1, -1, 0, 0, 1, 1, -1, -1 }, neighbourJ[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };	// straight, then diagonal
+	float stepCost[routeClearance + 1];
+	for( int c = 0; c <= routeClearance; c++ )
+		stepCost[c] = 1 + routePenalty*(routeClearance - c)/routeClearance;
+	std::greater<entry> later;
+	unsigned states = (unsigned)columns*rows << sideBits;
+	if( parent.size() < states )		// more sides than before : the new states start unreached
+	{
+		cost.resize( states );
+		parent.resize( states, -1 );
+		closed.resize( states, 0 );
+	}
+	open.clear();
+	for( unsigned i = 0; i < visited.size(); i++ )
+	{
+		parent[visited[i]] = -1;
+		closed[visited[i]] = 0;
+	}
+	visited.clear();
+	int gi = goal % columns, gj = goal / columns, first = start << sideBits, last = goal << sideBits | arrive;
+	parent[first] = first;
+	cost[first] = 0;
+	visited.push_back( first );
+	open.push_back( entry( 0, first ) );
+	while( !open.empty() )
+	{
+		entry e = open.front();
+		std::pop_heap( open.begin(), open.end(), later );
+		open.pop_back();
+		int state = e.second, at = state >> sideBits, i = at % columns, j = at / columns;
+		unsigned crossed = state & ((1 << sideBits) - 1);
+		if( state == last )
+			break;
+		if( closed[state] )		// stale entry : already expanded at a lower cost
+			continue;
+		closed[state] = 1;
+		double x, y, nx, ny;
+		centre( at, x, y );
+		for( int k = 0; k < 8; k++ )
+		{
+			int di = neighbourI[k], dj = neighbourJ[k], ni = i + di, nj = j + dj;
+			if( ni < 0 || nj < 0 || ni >= columns || nj >= rows )
+				continue;
+			int next = nj*columns + ni;
+			if( !clear[next] && next != goal )
+				continue;
+			if( k >= 4 && (!clear[j*columns + ni] || !clear[nj*columns + i]) )		// no squeezing diagonally between two curve cells
+				continue;
+			int nextState = next << sideBits;
+			if( sideBits )
+			{
+				centre( next, nx, ny );
+				nextState |= (crossed ^ crossings( x, y, nx, ny )) & ((1 << sideBits) - 1);
+			}
+			if( closed[nextState] )
+				continue;
+			float step = stepCost[ clear[next] ]*(k >= 4 ? 1.41421356f : 1.0f);
+			if( parent[nextState] < 0 || cost[state] + step < cost[nextState] )
+			{
+				if( parent[nextState] < 0 )
+					visited.push_back( nextState );
+				parent[nextState] = state;
+				cost[nextState] = cost[state] + step;
+				open.push_back( entry( cost[nextState] + 1.001f*octile( gi - ni, gj - nj ), nextState ) );		// a touch over the true distance : ties go to the cell nearer the goal
+				std::push_heap( open.begin(), open.end(), later );
+			}
+		}
+	}
+	if( parent[last] < 0 )
+		return false;
+	path.clear();
+	for( int state = last; state != first; state = parent[state] )
+		path.push_back( state >> sideBits );
+	path.push_back( start );
+	std::reverse( path.begin(), path.end() );
+	return true;
+}
+/* Half open, as rayCrossings : y <= the ray's is one side */
+unsigned Router::crossings(double x0, double y0, double x1, double y1) const
+{
+	unsigned mask = 0;
+	for( unsigned s = 0; s < sides.size(); s++ )
+		if( (y0 <= sides[s].y) != (y1 <= sides[s].y) && x0 + (sides[s].y - y0)*(x1 - x0)/(y1 - y0) > sides[s].x )
+			mask |= 1u << s;
+	return mask;
+}
+bool Router::sided(const std::vector<cubic> &chain) const
+{
+	for( unsigned s = 0; s < sides.size(); s++ )
+	{
+		int winding = 0;
+		for( unsigned i = 0; i < chain.size(); i++ )
+			winding += rayCrossings( chain[i], sides[s].x, sides[s].y );
+		if( (winding & 1) != sides[s].odd )
+			return false;
+	}
+	return true;
+}
+bool Router::visible(double x0, double y0, double x1, double y1, int least) const
+{
+	double length = sqrt( (x1 - x0)*(x1 - x0) + (y1 - y0)*(y1 - y0) );
+	int steps = 1 + (int)( 2*length/routeCell );
+	for( int k = 0; k <= steps; k++ )
+	{
+		int at = cell( x0 + (x1 - x0)*k/steps, y0 + (y1 - y0)*k/steps );
+		if( at < 0 || clear[at] < least )
+			return false;
+	}
+	return true;
+}
+bool Router::legal(const std::vector<cubic> &chain) const
+{
+	for( unsigned i = 0; i < chain.size(); i++ )
+	{
+		const cubic &c = chain[i];
+		box cb = bounds(c);
+		if( selfIntersects( c ) )
+			return false;
+		for( int k = 0; k < map.curveCount(); k++ )
+		{
+			cubic other = map.edgeCurve( 2*k );
+			if( !overlaps( cb, bounds(other) ) )
+				continue;
+			double sharedX[2], sharedY[2];
+			int shared = 0;
+			for( int e = 0; e < 4; e += 3 )		// the route may only meet the board at its own two spots (the bends are new)
+			{
+				if( e == 0 ? i != 0 : i + 1 != chain.size() )
+					continue;
+				for( int o = 0; o < 4; o += 3 )
+					if( other.x[o] == c.x[e] && other.y[o] == c.y[e] )
+					{
+						sharedX[shared] = c.x[e];
+						sharedY[shared] = c.y[e];
+						shared++;
+						break;
+					}
+			}
+			if( crosses( c, other, shared, sharedX, sharedY ) )
+				return false;
+		}
+		for( unsigned j = i + 1; j < chain.size(); j++ )		// pieces of the chain meet their neighbours only at the bends, and a loop's ends at its spot
+		{
+			double sharedX[2], sharedY[2];
+			int shared = 0;
+			if( j == i + 1 )
+			{
+				sharedX[shared] = c.x[3];
+				sharedY[shared++] = c.y[3];
+			}
+			if( i == 0 && j + 1 == chain.size() && c.x[0] == chain[j].x[3] && c.y[0] == chain[j].y[3] )
+			{
+				sharedX[shared] = c.x[0];
+				sharedY[shared++] = c.y[0];
+			}
+			if( crosses( c, chain[j], shared, sharedX, sharedY ) )
+				return false;
+		}
+	}
+	return true;
+}
+/* Cubics through the points, leaving the first along startAngle and arriving at the last against endAngle,
+ * tangents in between parallel to the chord through the neighbours (Catmull-Rom) */
+void Router::fit(const std::vector<double> &xs, const std::vector<double> &ys, double startAngle, double endAngle, std::vector<cubic> &chain) const
+{
+	int n = xs.size();
+	std::vector<double> tx( n ), ty( n );
+	tx[0] = cos(startAngle);		ty[0] = sin(startAngle);
+	tx[n-1] = -cos(endAngle);		ty[n-1] = -sin(endAngle);
+	for( int i = 1; i + 1 < n; i++ )
+	{
+		double dx = xs[i+1] - xs[i-1], dy = ys[i+1] - ys[i-1], d = sqrt( dx*dx + dy*dy );
+		tx[i] = d > 0 ? dx/d : 0;
+		ty[i] = d > 0 ? dy/d : 0;
+	}
+	chain.clear();
+	for( int i = 0; i + 1 < n; i++ )
+	{
+		double length = sqrt( (xs[i+1] - xs[i])*(xs[i+1] - xs[i]) + (ys[i+1] - ys[i])*(ys[i+1] - ys[i]) )/3;
+		cubic c = { { xs[i], xs[i] + tx[i]*length, xs[i+1] - tx[i+1]*length, xs[i+1] },
+					{ ys[i], ys[i] + ty[i]*length, ys[i+1] - ty[i+1]*length, ys[i+1] } };
+		chain.push_back( c );
+	}
+}
+void Router::polyline(const std::vector<double> &xs, const std::vector<double> &ys, std::vector<cubic> &chain) const
+{
+	chain.clear();
+	for( unsigned k = 0; k + 1 < xs.size(); k++ )
+	{
+		cubic c = { { xs[k], (2*xs[k] + xs[k+1])/3, (xs[k] + 2*xs[k+1])/3, xs[k+1] },
+					{ ys[k], (2*ys[k] + ys[k+1])/3, (ys[k] + 2*ys[k+1])/3, ys[k+1] } };
+		chain.push_back( c );
+	}
+}
+/* The mesh path bends a cell's width off the curves where the triangles leave room, and each straight piece of it stays in
+ * triangles of the chain : only the curves' bulge off their segments can cut it, which the exact tests catch */
+bool Router::thread(const boardSpot &a, const boardSpot &b, double ax, double ay, double bx, double by, double startAngle, double endAngle, std::vector<cubic> &chain)
+{
+	std::vector<double> px, py, xs, ys;
+	if( !mesh || mesh->shortestPath( ax, ay, bx, by, px, py, routeCell ) < 0 )
+		return false;
+	xs.assign( 1, a.x );	ys.assign( 1, a.y );
+	xs.insert( xs.end(), px.begin() + 1, px.end() - 1 );
+	ys.insert( ys.end(), py.begin() + 1, py.end() - 1 );
+	xs.push_back( b.x );	ys.push_back( b.y );
+	fit( xs, ys, startAngle, endAngle, chain );
+	if( legal( chain ) && sided( chain ) )
+		return true;
+	px.insert( px.begin(), a.x );	py.insert( py.begin(), a.y );
+	px.push_back( b.x );			py.push_back( b.y );
+	polyline( px, py, chain );
+	return legal( chain ) && sided( chain );
+}
+bool Router::route(int from, int to, std::vector<cubic> &chain, int face, const std::vector<routeSide> *asked, int fromCorner, int toCorner)
+{
+	const boardSpot &a = map.spot(from), &b = map.spot(to);
+	std::vector<int> facesFrom, facesTo;
+	for( int k = 0; k < 2; k++ )		// region test : faces around each spot
+	{
+		int s = k ? to : from, first = map.leaving(s);
+		std::vector<int> &out = k ? facesTo : facesFrom;
+		if( first < 0 )
+			out.push_back( map.spotFace(s) );
+		else
+		{
+			int h = first;
+			do
+			{
+				out.push_back( map.faceOf(h) );
+				h = map.counterClockwiseOf(h);
+			} while( h != first );
+		}
+	}
+	if( asked )
+		sides = *asked;
+	else
+		sides.clear();
+	sideBits = std::min( (int)sides.size(), routeSidesMax );
+	unsigned wanted = 0;
+	for( unsigned s = 0; s < sides.size(); s++ )
+		if( sides[s].odd )
+			wanted |= 1u << s;
+	rasterize();
+	std::vector<int> path;
+	std::vector<double> xs, ys;
+	for( unsigned i = 0; i < facesFrom.size(); i++ )
+	{
+		int f = facesFrom[i];
+		if( (face >= 0 && f != face) || std::find( facesTo.begin(), facesTo.end(), f ) == facesTo.end() || std::find( facesFrom.begin(), facesFrom.begin() + i, f ) != facesFrom.begin() + i )
+			continue;
+		double startAngle, endAngle;
+		if( (fromCorner >= 0 && map.faceOf(fromCorner) != f) || (toCorner >= 0 && map.faceOf(toCorner) != f) )
+			continue;
+		if( from == to && fromCorner == toCorner )		// loop : leave and come back through the same corner, shrinking until it fits - else around what it must hold
+		{
+			double angle = fromCorner >= 0 ? middle( fromCorner ) : map.leaving(from) < 0 ? opening( from ) : corner( from, f, a.x + 1, a.y );
+			for( double size = routeLoopSize; size >= routeCell; size /= 2 )
+			{
+				cubic c = { { a.x, a.x + size*cos(angle - 0.6), a.x + size*cos(angle + 0.6), a.x },
+							{ a.y, a.y + size*sin(angle - 0.6), a.y + size*sin(angle + 0.6), a.y } };
+				chain.assign( 1, c );
+				if( legal( chain ) && sided( chain ) )
+					return true;
+			}
+			if( !wanted )
+				continue;
+			startAngle = angle - 0.6;
+			endAngle = angle + 0.6;
+		}
+		else
+		{
+			startAngle = fromCorner >= 0 ? middle( fromCorner ) : corner( from, f, b.x, b.y );
+			endAngle = toCorner >= 0 ? middle( toCorner ) : corner( to, f, a.x, a.y );
+			if( from != to )		// straight test : one cubic (not between two corners of one spot)
+			{
+				xs.assign( 1, a.x );	ys.assign( 1, a.y );
+				xs.push_back( b.x );	ys.push_back( b.y );
+				fit( xs, ys, startAngle, endAngle, chain );
+				if( legal( chain ) && sided( chain ) )
+					return true;
+			}
+		}
+		double ax, ay, bx, by;
+		if( !launch( from, startAngle, ax, ay ) || !launch( to, endAngle, bx, by ) )
+			continue;
+		int start = cell( ax, ay ), goal = cell( bx, by );
+		double sx, sy, gx, gy;
+		centre( start, sx, sy );
+		centre( goal, gx, gy );
+		unsigned arrive = wanted ^ crossings( a.x, a.y, ax, ay ) ^ crossings( ax, ay, sx, sy ) ^ crossings( gx, gy, bx, by ) ^ crossings( bx, by, b.x, b.y );		// what the cells must cross between them
+		std::vector<kept> saved;		// the legs out of the spots are walls for the path in between (a loop could cut through its own)
+		wall( a.x, a.y, ax, ay, start, goal, saved );
+		wall( b.x, b.y, bx, by, start, goal, saved );
+		if( !search( start, goal, arrive & ((1 << sideBits) - 1), path ) )
+		{
+			unwall( saved, 0 );
+			if( thread( a, b, ax, ay, bx, by, startAngle, endAngle, chain ) )
+				return true;
+			continue;
+		}
+		/* Round a side the cheapest path comes back the way it went, next to itself : wall off the way out up to the turn, and search the way back again
+		 * kept clear of it as of a curve - each side may need it once */
+		std::vector<int> back;
+		unsigned past = 0, before, after;
+		for( int tries = 0; sideBits && tries < routeSidesMax && touching( path, past, before, after ); tries++ )
+		{
+			unsigned turn = (before + after)/2, crossedOut = 0, walled = saved.size();
+			double x0, y0, x1, y1;
+			centre( path[0], x1, y1 );
+			for( unsigned k = 1; k <= turn; k++ )
+			{
+				x0 = x1;
+				y0 = y1;
+				centre( path[k], x1, y1 );
+				crossedOut ^= crossings( x0, y0, x1, y1 );
+				wall( x0, y0, x1, y1, path[turn], goal, saved );
+			}
+			if( !search( path[turn], goal, (arrive ^ crossedOut) & ((1 << sideBits) - 1), back ) )
+			{
+				unwall( saved, walled );
+				break;
+			}
+			path.resize( turn );
+			path.insert( path.end(), back.begin(), back.end() );
+			past = turn;
+		}
+		/* The path as points : launch point, the cells' centres, launch point - and the rays crossed up to each */
+		std::vector<double> qx( 1, ax ), qy( 1, ay );
+		for( unsigned k = 0; k < path.size(); k++ )
+		{
+			double x, y;
+			centre( path[k], x, y );
+			qx.push_back( x );
+			qy.push_back( y );
+		}
+		qx.push_back( bx );		qy.push_back( by );
+		std::vector<unsigned> crossed( qx.size(), 0 );
+		for( unsigned k = 1; k < qx.size(); k++ )
+			crossed[k] = crossed[k-1] ^ crossings( qx[k-1], qy[k-1], qx[k], qy[k] );
+		/* Pull the path tight : from each corner walk on along the path while the corner can still see it (a cell clear of the curves and the legs, where the path had
+		 * that room), crossing the rays as the path did and none of the corners before */
+		std::vector<double> px( 1, ax ), py( 1, ay );
+		unsigned at = 0;
+		while( at + 1 < qx.size() )
+		{
+			unsigned next = at + 1;
+			for( unsigned k = at + 2; k < qx.size(); k++ )
+			{
+				int cellAt = path[ at ? at - 1 : 0 ], cellK = path[ std::min( k - 1, (unsigned)path.size() - 1 ) ];
+				if( !visible( qx[at], qy[at], qx[k], qy[k], std::max( 1, std::min( 2, std::min( (int)clear[cellAt], (int)clear[cellK] ) ) ) )
+				 || crossings( qx[at], qy[at], qx[k], qy[k] ) != (crossed[at] ^ crossed[k]) )
+					break;
+				bool crossesBack = false;
+				double s, t;
+				for( unsigned m = 0; m + 2 < px.size() && !crossesBack; m++ )
+					crossesBack = segmentsCross( px[m], py[m], px[m+1], py[m+1], qx[at], qy[at], qx[k], qy[k], s, t );
+				if( crossesBack )
+					break;
+				next = k;
+			}
+			px.push_back( qx[next] );
+			py.push_back( qy[next] );
+			at = next;
+		}
+		unwall( saved, 0 );
+		/* Smooth : spot, the corners in between, spot - the launch points are replaced by the corner directions */
+		xs.assign( 1, a.x );	ys.assign( 1, a.y );
+		xs.insert( xs.end(), px.begin() + 1, px.end() - 1 );
+		ys.insert( ys.end(), py.begin() + 1, py.end() - 1 );
+		xs.push_back( b.x );	ys.push_back( b.y );
+		fit( xs, ys, startAngle, endAngle, chain );
+		if( legal( chain ) && sided( chain ) )
+			return true;
+		/* Polyline through the launch points, then the mesh as a last resort */
+		px.insert( px.begin(), a.x );	py.insert( py.begin(), a.y );
+		px.push_back( b.x );			py.push_back( b.y );
+		polyline( px, py, chain );
+		if( legal( chain ) && sided( chain ) )
+			return true;
+		if( thread( a, b, ax, ay, bx, by, startAngle, endAngle, chain ) )
+			return true;
+	}
+	chain.clear();
+	return false;
+}
+
+#endif
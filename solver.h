@@ -0,0 +1,260 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <algorithm>
+#include <vector>
+#include <SDL/SDL.h>
+#include "canonical.h"
+#include "moves.h"
+#include "database.h"
+#include "tablebase.h"
+
+/* Who wins a Sprouts position : negamax with alpha-beta over canonical positions, remembered in a transposition table
+ * keyed on the canonical hash. Normal play (the player with no move left loses) or misère (the player who moves last
+ * loses) : the rules only change the value of a position with no move, and the key space results are kept under */
+
+/* Global constants for the solver */
+static const int solverTableBits = 22;			// 4M entries
+static const Uint32 solverProgressTime = 1000;	// milliseconds between progress reports
+static const Uint64 solverValueMask = 0xFF;		// table entries keep the value in the low byte of the key (so tables have at least 256 entries)
+static const int solverValueBias = 128;
+static const Uint64 solverDatabaseWork = 64;	// positions a result must have taken to search before it is worth a database record
+/* End constants */
+
+/* Results by canonical hash, one 64-bit word per entry : the key with its low byte replaced by the value
+ * (the index already fixes those bits). Entries are read and written whole with GCC's atomic builtins,
+ * so any number of threads can share a table without locks - a race only loses a result, never mixes two */
+class TranspositionTable
+{
+	private:
+		std::vector<Uint64> slots;
+		Uint64 mask;
+
+	public:
+		/* Constructors */
+		TranspositionTable(int=solverTableBits);
+
+		/* Construction */
+		void clear();
+		void store(Uint64, int);		// a value from -127 to 127, not 0 - always replace : the newest results are the ones nearby searches want
+
+		/* Queries */
+		int probe(Uint64) const;		// the value stored, 0 unknown
+};
+TranspositionTable::TranspositionTable(int bits)
+{
+	slots.resize( (size_t)1 << bits );
+	mask = ((Uint64)1 << bits) - 1;
+	clear();
+}
+void TranspositionTable::clear()
+{
+	std::fill( slots.begin(), slots.end(), 0 );
+}
+inline void TranspositionTable::store(Uint64 key, int value)
+{
+	__atomic_store_n( &slots[key & mask], (key & ~solverValueMask) | (Uint64)(value + solverValueBias), __ATOMIC_RELAXED );
+}
+inline int TranspositionTable::probe(Uint64 key) const
+{
+	Uint64 slot = __atomic_load_n( &slots[key & mask], __ATOMIC_RELAXED );
+	if( (slot ^ key) & ~solverValueMask || !(slot & solverValueMask) )
+		return 0;
+	return (int)(slot & solverValueMask) - solverValueBias;
+}
+
+class Solver
+{
+	private:
+		struct frame			// scratch for one depth of the search
+		{
+			std::vector<sproutsMove> moves;
+			std::vector<Uint64> children;		// hashes of the children tried so far : many moves lead to the same position
+			position child, canon;
+		};
+
+		TranspositionTable *table, *owned;
+		std::vector<frame> frames;
+		Canonicalizer canonicalizer;
+		Uint32 lastReport;
+		bool aborted;
+
+		/* Private functions */
+		int negamax(const position&, Uint64, int, int, int);
+		void report(int);
+		void sizeFrames(const position&);
+
+	public:
+		/* Constructors */
+		Solver(int=solverTableBits);
+		Solver(TranspositionTable&);		// share a table (between threads, or between searches)
+		~Solver();
+
+		/* Public variables */
+		Uint64 nodes, hits;
+		Uint32 started;
+		void (*progress)(const Solver&, int, void*);	// called about every solverProgressTime ms with the depth reached, if set
+		void *progressData;
+		bool (*stop)(void*);			// polled every few hundred positions, if set : true gives the search up
+		void *stopData;
+		PositionDatabase *database;		// solved positions kept between runs, if set : looked up after the table, and fed the costly results
+		sproutsRules rules;				// normalPlay unless set : keys are hashed with the rules, so one table can serve both
+		const Tablebase *tablebase;		// endgame outcomes (built under the same rules), if set : looked up before the database
+
+		/* Queries */
+		bool solve(const position&, sproutsMove* =NULL, int* =NULL);	// true if the player to move wins, and a winning move (and how many moves it had) - false if stopped
+		int search(const position&, Uint64);	// value of a canonical position and its hash : +1 win, -1 loss, 0 given up
+		void clear();						// forget the table
+		int probe(Uint64 key) const { return table->probe( key ); }
+		bool stopped() const { return aborted; }	// the last search was given up (its answer means nothing)
+};
+Solver::Solver(int bits)
+{
+	table = owned = new TranspositionTable( bits );
+	nodes = hits = 0;
+	progress = NULL;
+	progressData = NULL;
+	stop = NULL;
+	stopData = NULL;
+	database = NULL;
+	rules = normalPlay;
+	tablebase = NULL;
+	aborted = false;
+}
+Solver::Solver(TranspositionTable &shared)
+{
+	table = &shared;
+	owned = NULL;
+	nodes = hits = 0;
+	progress = NULL;
+	progressData = NULL;
+	stop = NULL;
+	stopData = NULL;
+	database = NULL;
+	rules = normalPlay;
+	tablebase = NULL;
+	aborted = false;
+}
+Solver::~Solver()
+{
+	delete owned;
+}
+void Solver::clear()
+{
+	table->clear();
+}
+void Solver::report(int depth)
+{
+	if( stop && stop( stopData ) )
+		aborted = true;
+	Uint32 now = SDL_GetTicks();
+	if( progress && now - lastReport >= solverProgressTime )
+	{
+		lastReport = now;
+		progress( *this, depth, progressData );
+	}
+}
+/* Every move uses up a life : the search is never deeper than the lives left (sized once - frames are referenced down the recursion) */
+void Solver::sizeFrames(const position &p)
+{
+	int lives = livesBound( p );
+	if( (int)frames.size() < lives + 2 )
+		frames.resize( lives + 2 );
+}
+/* Value of a canonical position for the player to move - with only win and loss the first losing child ends the search,
+ * so every value stored is exact. A search given up returns 0 all the way back and stores nothing */
+int Solver::negamax(const position &p, Uint64 key, int depth, int alpha, int beta)
+{
+	int known = probe( key );
+	if( known )
+	{
+		hits++;
+		return known;
+	}
+	if( tablebase && livesLeft( p ) <= tablebase->lives() && (known = tablebase->probe( key )) )
+	{
+		hits++;
+		table->store( key, known );
+		return known;
+	}
+	int stored, depthStored;
+	if( database && database->find( key, databaseOutcome, stored, depthStored ) )
+	{
+		hits++;
+		table->store( key, stored );
+		return stored;
+	}
+	Uint64 first = nodes;
+	if( (++nodes & 0xFF) == 0 )
+		report( depth );
+	if( aborted )
+		return 0;
+	frame &f = frames[depth];
+	generateMoves( p, f.moves );
+	f.children.clear();
+	int value = -1;
+	for( unsigned i = 0; i < f.moves.size() && alpha < beta; i++ )
+	{
+		applyMove( p, f.moves[i], f.child );
+		canonicalizer.canonical( f.child, f.canon );
+		Uint64 childKey = positionHash( f.canon, rules );
+		if( std::find( f.children.begin(), f.children.end(), childKey ) != f.children.end() )
+			continue;
+		f.children.push_back( childKey );
+		int v = -negamax( f.canon, childKey, depth + 1, -beta, -alpha );
+		if( aborted )
+			return 0;
+		value = std::max( value, v );
+		alpha = std::max( alpha, v );
+	}
+	if( f.moves.empty() )		// no move : lost in normal play, won in misère (the opponent moved last)
+		value = rules == misere ? 1 : -1;
+	table->store( key, value );
+	if( database && nodes - first >= solverDatabaseWork )
+		database->store( key, databaseOutcome, value, livesBound( p ) );
+	return value;
+}
+int Solver::search(const position &p, Uint64 key)
+{
+	started = lastReport = SDL_GetTicks();
+	aborted = false;
+	sizeFrames( p );
+	return negamax( p, key, 0, -1, 1 );
+}
+/* The root is searched on the position as given (not its canonical form), so the winning move is in its terms.
+ * A position with no move is won under misère with no move to give : best is left as it was, so callers check the count */
+bool Solver::solve(const position &p, sproutsMove *best, int *moveCount)
+{
+	std::vector<sproutsMove> moves;
+	position child, canon;
+	std::vector<Uint64> children;
+	started = lastReport = SDL_GetTicks();
+	aborted = false;
+	sizeFrames( p );
+	generateMoves( p, moves );
+	if( moveCount )
+		*moveCount = moves.size();
+	if( moves.empty() )
+		return rules == misere;
+	for( unsigned i = 0; i < moves.size(); i++ )
+	{
+		applyMove( p, moves[i], child );
+		canonicalizer.canonical( child, canon );
+		Uint64 key = positionHash( canon, rules );
+		if( std::find( children.begin(), children.end(), key ) != children.end() )
+			continue;
+		children.push_back( key );
+		int v = negamax( canon, key, 1, -1, 1 );
+		if( aborted )
+			return false;
+		if( v < 0 )		// the opponent loses after this move
+		{
+			if( best )
+				*best = moves[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include "geometry.h"
+
+/* Bentley-Ottmann sweep : reports every crossing among a set of line segments in O((n+k) log n)
+ * Curves are tessellated into segments first (see tessellate), so this finds all crossings on a board at once
+ * instead of testing every pair of curves */
+
+/* Global constants for the sweep */
+static const double sweepShear = 0.0012345;	// x += y*shear before sweeping so no segment is vertical (small enough to keep slopes, and so rounding, tame)
+static const double sweepEpsilon = 1e-7;	// y values closer than this are "the same point" on the sweep line
+/* End constants */
+
+struct segment					// one piece of a tessellated curve
+{
+	double x0, y0, x1, y1;
+	int curve, piece;			// which curve and which piece along it (pieces of one curve are numbered from 0)
+	bool curveStart, curveEnd;	// true if (x0,y0) / (x1,y1) is an endpoint (spot) of the curve
+};
+
+struct sweepHit					// segments a and b (indices into the input) cross at (x,y)
+{ int a, b; double x, y; };
+
+/* Append the curve as `pieces` straight segments (uniform in t, like drawLines) */
+inline void tessellate(const cubic &c, int curve, int pieces, std::vector<segment> &out)
+{
+	double xOld = c.x[0], yOld = c.y[0], xNew, yNew;
+	for( int i = 1; i <= pieces; i++ )
+	{
+		evaluate( c, (double)i/pieces, xNew, yNew );
+		segment s = { xOld, yOld, xNew, yNew, curve, i - 1, i == 1, i == pieces };
+		out.push_back( s );
+		xOld = xNew;
+		yOld = yNew;
+	}
+}
+
+class SweepLine
+{
+	private:
+		struct statusOrder				// orders segment indices by y where they meet the sweep line (ties : by slope, i.e. order just right of it)
+		{
+			const SweepLine *sweep;
+			statusOrder(const SweepLine *s) : sweep(s) {}
+			bool operator()(int, int) const;
+		};
+		struct eventPoint				// sweep events sorted left to right, then top to bottom
+		{
+			double x, y;
+			bool operator<(const eventPoint &e) const { return x < e.x || (x == e.x && y < e.y); }
+		};
+		typedef std::set<int, statusOrder> status;
+
+		std::vector<segment> segs;		// sheared, oriented left to right, plus one probe segment at the back
+		std::map<eventPoint, std::vector<int> > events;		// event point -> segments starting there
+		status active;					// segments currently crossing the sweep line, bottom to top
+		std::vector<status::iterator> where;				// position of each active segment in the status
+		std::set< std::pair<int,int> > reported;			// pairs already reported (several nearly equal event points may see one crossing)
+		double sweepX, sweepY;			// current event point
+		int probe;						// index of the probe segment used to search the status by y
+
+		/* Private functions */
+		double yAt(int, double) const;
+		double slope(int) const;
+		void findEvent(int, int, const eventPoint&);
+		void handle(const eventPoint&, std::vector<int>&, std::vector<sweepHit>&);
+		bool joined(int, int, const eventPoint&) const;		// true if a meeting at this point is an allowed joint, not a crossing
+
+	public:
+		/* Constructors */
+		SweepLine(const std::vector<segment>&, bool=true);	// takes the segments (true : apply the shear, false : already sheared)
+
+		/* Sweep */
+		void run(std::vector<sweepHit>&, double=-1e300, double=1e300);	// report crossings with sheared x in [xMin,xMax)
+};
+SweepLine::SweepLine(const std::vector<segment> &input, bool shear) : segs(input), active( statusOrder(this) )
+{
+	for( unsigned i = 0; i < segs.size(); i++ )
+	{
+		segment &s = segs[i];
+		if( shear )
+		{
+			s.x0 += s.y0*sweepShear;
+			s.x1 += s.y1*sweepShear;
+		}
+		if( s.x1 < s.x0 || (s.x1 == s.x0 && s.y1 < s.y0) )	// orient left to right
+		{
+			std::swap( s.x0, s.x1 );
+			std::swap( s.y0, s.y1 );
+			std::swap( s.curveStart, s.curveEnd );
+		}
+	}
+	probe = segs.size();
+	segment p = { 0,0, 0,0, -1, -1, false, false };
+	segs.push_back( p );
+	where.resize( segs.size() );
+	sweepX = sweepY = -1e300;
+}
+inline double SweepLine::yAt(int i, double x) const
+{
+	const segment &s = segs[i];
+	if( i == probe || s.x1 == s.x0 )
+		return s.y0;
+	if( x <= s.x0 ) return s.y0;
+	if( x >= s.x1 ) return s.y1;
+	return s.y0 + (s.y1 - s.y0)*(x - s.x0)/(s.x1 - s.x0);
+}
+inline double SweepLine::slope(int i) const
+{
+	const segment &s = segs[i];
+	if( i == probe )
+		return -1e300;
+	if( s.x1 == s.x0 )
+		return 1e300;
+	return (s.y1 - s.y0)/(s.x1 - s.x0);
+}
+inline bool SweepLine::statusOrder::operator()(int a, int b) const
+{
+	if( a == b )
+		return false;
+	double ya = sweep->yAt( a, sweep->sweepX ), yb = sweep->yAt( b, sweep->sweepX );
+	if( ya < yb - sweepEpsilon ) return true;
+	if( yb < ya - sweepEpsilon ) return false;
+	double sa = sweep->slope(a), sb = sweep->slope(b);
+	if( sa != sb )		// meeting on the sweep line : below the event point they have swapped already, above it not yet
+		return ya > sweep->sweepY + sweepEpsilon ? sa > sb : sa < sb;
+	return a < b;		// overlapping collinear pieces : any fixed order
+}
+/* Queue the crossing of a and b if it lies right of (or directly below) the current event point */
+void SweepLine::findEvent(int a, int b, const eventPoint &p)
+{
+	double s, t;
+	const segment &sa = segs[a], &sb = segs[b];
+	if( !segmentsCross( sa.x0,sa.y0, sa.x1,sa.y1, sb.x0,sb.y0, sb.x1,sb.y1, s, t ) )
+		return;
+	eventPoint q = { sa.x0 + (sa.x1 - sa.x0)*s, sa.y0 + (sa.y1 - sa.y0)*s };
+	const double ends[4][2] = { {sa.x0,sa.y0}, {sa.x1,sa.y1}, {sb.x0,sb.y0}, {sb.x1,sb.y1} };
+	for( int i = 0; i < 4; i++ )	// meeting at an endpoint : use the endpoint's own event, not a rounded copy of it
+	{
+		if( fabs(q.x - ends[i][0]) <= sweepEpsilon && fabs(q.y - ends[i][1]) <= sweepEpsilon )
+		{
+			q.x = ends[i][0];
+			q.y = ends[i][1];
+			break;
+		}
+	}
+	if( q.x < p.x || (q.x == p.x && q.y <= p.y) )
+		return;
+	events[q];		// creates the event with no starting segments if it is not queued already
+}
+/* Neighbouring pieces of one curve, or curves meeting at a spot, touch at their endpoints without crossing */
+bool SweepLine::joined(int a, int b, const eventPoint &p) const
+{
+	const segment &sa = segs[a], &sb = segs[b];
+	bool aEnd = (sa.x0 == p.x && sa.y0 == p.y) || (sa.x1 == p.x && sa.y1 == p.y),
+		 bEnd = (sb.x0 == p.x && sb.y0 == p.y) || (sb.x1 == p.x && sb.y1 == p.y);
+	if( !aEnd || !bEnd )
+		return false;
+	if( sa.curve == sb.curve && (sa.piece - sb.piece == 1 || sb.piece - sa.piece == 1) )
+		return true;
+	bool aSpot = (sa.x0 == p.x && sa.y0 == p.y) ? sa.curveStart : sa.curveEnd,
+		 bSpot = (sb.x0 == p.x && sb.y0 == p.y) ? sb.curveStart : sb.curveEnd;
+	return aSpot && bSpot;
+}
+void SweepLine::handle(const eventPoint &p, std::vector<int> &starting, std::vector<sweepHit> &hits)
+{
+	std::vector<int> here;		// segments ending at or passing through p
+	std::vector<int> after;		// segments continuing right of p
+	sweepX = p.x;
+	sweepY = p.y;
+	segs[probe].y0 = p.y - sweepEpsilon;
+	status::iterator it = active.lower_bound( probe );
+	while( it != active.end() && yAt( *it, p.x ) <= p.y + sweepEpsilon )
+	{
+		here.push_back( *it );
+		++it;
+	}
+	/* Report every pair meeting at p */
+	std::vector<int> all( here );
+	all.insert( all.end(), starting.begin(), starting.end() );
+	for( unsigned i = 0; i < all.size(); i++ )
+	{
+		for( unsigned j = i + 1; j < all.size(); j++ )
+		{
+			int a = std::min( all[i], all[j] ), b = std::max( all[i], all[j] );
+			if( joined( a, b, p ) || !reported.insert( std::make_pair(a, b) ).second )
+				continue;
+			sweepHit h = { a, b, p.x - p.y*sweepShear, p.y };
+			hits.push_back( h );
+		}
+	}
+	/* Remove everything through p, then put back what continues, ordered as it is just right of p */
+	for( unsigned i = 0; i < here.size(); i++ )
+	{
+		active.erase( where[here[i]] );
+		if( segs[here[i]].x1 > p.x + sweepEpsilon )
+			after.push_back( here[i] );
+	}
+	after.insert( after.end(), starting.begin(), starting.end() );
+	if( after.empty() )		// p was the right end of everything : its two neighbours are now adjacent
+	{
+		it = active.lower_bound( probe );
+		if( it != active.end() && it != active.begin() )
+		{
+			status::iterator below = it;
+			--below;
+			findEvent( *below, *it, p );
+		}
+		return;
+	}
+	status::iterator lowest = active.end(), highest = active.end();
+	for( unsigned i = 0; i < after.size(); i++ )
+	{
+		where[after[i]] = active.insert( after[i] ).first;
+		if( lowest == active.end() || active.key_comp()( after[i], *lowest ) )
+			lowest = where[after[i]];
+		if( highest == active.end() || active.key_comp()( *highest, after[i] ) )
+			highest = where[after[i]];
+	}
+	if( lowest != active.begin() )
+	{
+		status::iterator below = lowest;
+		--below;
+		findEvent( *below, *lowest, p );
+	}
+	status::iterator above = highest;
+	++above;
+	if( above != active.end() )
+		findEvent( *highest, *above, p );
+}
+/* Sweep left to right, appending crossings whose (sheared) x lies in [xMin,xMax) to hits */
+void SweepLine::run(std::vector<sweepHit> &hits, double xMin, double xMax)
+{
+	std::vector<sweepHit> found;
+	events.clear();
+	active.clear();
+	reported.clear();
+	for( int i = 0; i < probe; i++ )
+	{
+		if( segs[i].x0 == segs[i].x1 && segs[i].y0 == segs[i].y1 )	// zero length piece (a control point on top of an endpoint)
+			continue;
+		eventPoint left = { segs[i].x0, segs[i].y0 }, right = { segs[i].x1, segs[i].y1 };
+		events[left].push_back( i );
+		events[right];
+	}
+	while( !events.empty() )
+	{
+		std::map<eventPoint, std::vector<int> >::iterator e = events.begin();
+		eventPoint p = e->first;
+		std::vector<int> starting;
+		starting.swap( e->second );
+		events.erase( e );
+		found.clear();
+		handle( p, starting, found );
+		if( p.x >= xMin && p.x < xMax )
+			hits.insert( hits.end(), found.begin(), found.end() );
+	}
+}
+
+/* Arguments for one strip of the parallel sweep */
+struct sweepStrip
+{
+	const std::vector<segment> *all;	// every segment (already sheared)
+	double xMin, xMax;
+	std::vector<sweepHit> hits;
+};
+inline int sweepStripThread(void *data)
+{
+	sweepStrip *strip = (sweepStrip*)data;
+	std::vector<segment> mine;
+	std::vector<int> index;				// strip segment -> input segment
+	for( unsigned i = 0; i < strip->all->size(); i++ )
+	{
+		const segment &s = (*strip->all)[i];
+		if( std::max( s.x0, s.x1 ) >= strip->xMin && std::min( s.x0, s.x1 ) < strip->xMax )
+		{
+			mine.push_back( s );
+			index.push_back( i );
+		}
+	}
+	SweepLine sweep( mine, false );
+	sweep.run( strip->hits, strip->xMin, strip->xMax );
+	for( unsigned i = 0; i < strip->hits.size(); i++ )
+	{
+		strip->hits[i].a = index[strip->hits[i].a];
+		strip->hits[i].b = index[strip->hits[i].b];
+		if( strip->hits[i].a > strip->hits[i].b )
+			std::swap( strip->hits[i].a, strip->hits[i].b );
+	}
+	return 0;
+}
+
+/* All crossings among the segments, single threaded */
+inline void sweepCrossings(const std::vector<segment> &segs, std::vector<sweepHit> &hits)
+{
+	SweepLine sweep( segs );
+	sweep.run( hits );
+}
+
+/* All crossings among the segments, with the board cut into vertical strips swept on separate threads
+ * Strips hold equal numbers of segment left ends; a segment spanning several strips is swept in each, and each strip
+ * keeps only the crossings inside it, so nothing is reported twice */
+inline void sweepCrossings(const std::vector<segment> &input, std::vector<sweepHit> &hits, int threads)
+{
+	if( threads <= 1 || input.size() < 2 )
+	{
+		sweepCrossings( input, hits );
+		return;
+	}
+	std::vector<segment> segs( input );
+	std::vector<double> lefts;
+	for( unsigned i = 0; i < segs.size(); i++ )
+	{
+		segs[i].x0 += segs[i].y0*sweepShear;
+		segs[i].x1 += segs[i].y1*sweepShear;
+		lefts.push_back( std::min( segs[i].x0, segs[i].x1 ) );
+	}
+	std::sort( lefts.begin(), lefts.end() );
+	std::vector<sweepStrip> strips( threads );
+	std::vector<SDL_Thread*> running( threads );
+	for( int i = 0; i < threads; i++ )
+	{
+		strips[i].all = &segs;
+		strips[i].xMin = i == 0 ? -1e300 : lefts[ lefts.size()*i/threads ];
+		strips[i].xMax = i == threads - 1 ? 1e300 : lefts[ lefts.size()*(i + 1)/threads ];
+	}
+	for( int i = 0; i < threads; i++ )
+		running[i] = SDL_CreateThread( sweepStripThread, &strips[i] );
+	for( int i = 0; i < threads; i++ )
+	{
+		if( running[i] )
+			SDL_WaitThread( running[i], NULL );
+		else		// could not start a thread : sweep the strip here
+			sweepStripThread( &strips[i] );
+		hits.insert( hits.end(), strips[i].hits.begin(), strips[i].hits.end() );
+	}
+}
+
+#endif
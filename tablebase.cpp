@@ -0,0 +1,86 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <SDL/SDL.h>
+
+#include "tablebase.h"
+#include "solver.h"
+
+using namespace std;
+
+/* Endgame tablebase generator - offline, no window
+ * Usage : sproutsTablebase [lives] [spots] [threads] [normal|misere] [file]
+ * Every position reached from the starts of 1 .. spots spots with at most lives lives left, labelled and written to file
+ * (endgame.tb, or endgame-misere.tb under misère rules), then checked against the solver on a sample */
+
+void builderProgress(const char *sweep, int lives, size_t count, void *start)
+{
+	printf( "%-8s  lives %2d  %9lu positions  %8u ms\n", sweep, lives, (unsigned long)count, SDL_GetTicks() - *(Uint32*)start );
+	fflush( stdout );
+}
+
+int main( int argc, char* argv[] )
+{
+	int lives = argc > 1 ? atoi(argv[1]) : 8;
+	int spots = argc > 2 ? atoi(argv[2]) : 5;
+	int threads = argc > 3 ? atoi(argv[3]) : 4;
+	bool misereRules = argc > 4 && !strcmp( argv[4], "misere" );
+	const char *path = argc > 5 ? argv[5] : misereRules ? "endgame-misere.tb" : "endgame.tb";
+
+	TablebaseBuilder builder;
+	builder.rules = misereRules ? misere : normalPlay;
+	Uint32 start = SDL_GetTicks();
+	builder.progress = builderProgress;
+	builder.progressData = &start;
+	if( !builder.build( lives, spots, threads, path ) )
+	{
+		fprintf( stderr, "could not write %s\n", path );
+		return EXIT_FAILURE;
+	}
+	Uint32 time = SDL_GetTicks() - start;
+
+	Tablebase table;
+	if( !table.open( path ) )
+	{
+		fprintf( stderr, "could not read %s back\n", path );
+		return EXIT_FAILURE;
+	}
+	printf( "%lu positions met, %lu in %s (%s, at most %d lives) in %u ms\n", (unsigned long)builder.positions, (unsigned long)table.count(),
+		path, misereRules ? "misere" : "normal play", table.lives(), time );
+
+	/* Random games from the biggest start, every position with few enough lives solved again and compared */
+	position p, child, canon;
+	Canonicalizer canonicalizer;
+	vector<sproutsMove> moves;
+	int checked = 0, missing = 0, wrong = 0;
+	for( int game = 0; game < 200; game++ )
+	{
+		string text;
+		for( int i = 0; i < spots; i++ )
+			text += "0.";
+		text += "}!";
+		readPosition( text.c_str(), p );
+		for( ;; )
+		{
+			canonicalizer.canonical( p, canon );
+			if( livesLeft( canon ) <= lives )
+			{
+				Solver solver( 16 );
+				solver.rules = builder.rules;
+				int value = table.probe( positionHash( canon, builder.rules ) );
+				if( !value )
+					missing++;
+				else if( (value > 0) != solver.solve( canon ) )
+					wrong++;
+				checked++;
+			}
+			generateMoves( p, moves );
+			if( moves.empty() )
+				break;
+			applyMove( p, moves[ rand() % moves.size() ], child );
+			p = child;
+		}
+	}
+	printf( "%d positions checked against the solver : %d wrong, %d not in the table\n", checked, wrong, missing );
+	return wrong || missing ? EXIT_FAILURE : EXIT_SUCCESS;
+}
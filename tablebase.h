@@ -0,0 +1,369 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include "canonical.h"
+#include "moves.h"
+#include "packed.h"
+#include "database.h"
+
+/* Endgame tablebase : the outcome of every canonical position with few lives left, worked out once offline and read
+ * back mapped, so a probe costs a binary search in pages shared by every process that has the file open.
+ * Built in two sweeps over the positions grouped by lives left (a move always takes one, so a child is in a lower group) :
+ *   - down : the starting positions of 1 .. n spots, and everything reached from them, one group at a time
+ *   - up (retrograde) : each group from the lowest, a position's value read off its children already labelled
+ * Every position in a group is handled on its own, so both sweeps share a group out between threads. The groups are
+ * kept packed (see packed.h) and unpacked one position at a time : they hold every position reached, so they are the
+ * generator's memory.
+ * "Every position" is every one reached from the starts given : a position that only comes from a bigger start is missing
+ * and a probe for it simply fails.
+ * File : header, an index of where each 2^indexBits-th of the key range starts, then the sorted entries - the canonical
+ * hash with its lowest bit replaced by the outcome (1 : the player to move wins) */
+
+/* Global constants for tablebases */
+static const Uint32 tablebaseVersion = 2;		// 2 : keyed by the unique canonical forms
+static const char tablebaseMagic[8] = { 'S','P','R','O','U','T','T','B' };
+static const int tablebaseIndexBits = 16;		// index entries : 2^bits + 1, 256KB
+static const Uint64 tablebaseValueBit = 1;
+/* End constants */
+
+struct tablebaseHeader
+{
+	char magic[8];
+	Uint32 version, rules, lives, indexBits;	// rules : sproutsRules, lives : the most lives left a position in the table has
+	Uint64 count;								// entries
+	Uint8 padding[32];
+};
+
+class Tablebase
+{
+	private:
+		MappedFile file;
+		const tablebaseHeader *header;		// NULL while closed
+		const Uint32 *index;
+		const Uint64 *entries;
+
+	public:
+		/* Constructors */
+		Tablebase();
+
+		/* Construction */
+		bool open(const char*);		// map a tablebase read-only, false if it is missing or not one
+		void close();
+
+		/* Queries */
+		bool isOpen() const { return header != NULL; }
+		int probe(Uint64) const;	// +1 win, -1 loss for the player to move, 0 not in the table
+		int lives() const { return header ? header->lives : -1; }
+		sproutsRules rules() const { return header ? (sproutsRules)header->rules : normalPlay; }
+		Uint64 count() const { return header ? header->count : 0; }
+};
+Tablebase::Tablebase()
+{
+	header = NULL;
+	index = NULL;
+	entries = NULL;
+}
+bool Tablebase::open(const char *path)
+{
+	close();
+	if( !file.open( path ) || file.size() < sizeof(tablebaseHeader) )
+	{
+		close();
+		return false;
+	}
+	const tablebaseHeader *h = (const tablebaseHeader*)file.data();
+	size_t indexSize = (((size_t)1 << h->indexBits) + 1)*sizeof(Uint32);
+	if( memcmp( h->magic, tablebaseMagic, sizeof(tablebaseMagic) ) || h->version != tablebaseVersion || h->indexBits > 30
+	 || file.size() < sizeof(tablebaseHeader) + indexSize + h->count*sizeof(Uint64) )
+	{
+		close();
+		return false;
+	}
+	header = h;
+	index = (const Uint32*)(file.data() + sizeof(tablebaseHeader));
+	entries = (const Uint64*)(file.data() + sizeof(tablebaseHeader) + indexSize);
+	return true;
+}
+void Tablebase::close()
+{
+	file.close();
+	header = NULL;
+}
+int Tablebase::probe(Uint64 key) const
+{
+	if( !header )
+		return 0;
+	Uint64 bucket = key >> (64 - header->indexBits), wanted = key | tablebaseValueBit;
+	const Uint64 *first = entries + index[bucket], *last = entries + index[bucket + 1];
+	const Uint64 *found = std::lower_bound( first, last, key & ~tablebaseValueBit );
+	if( found == last || (*found | tablebaseValueBit) != wanted )
+		return 0;
+	return *found & tablebaseValueBit ? 1 : -1;
+}
+
+/* The generator, offline : positions are kept canonical and grouped by lives left */
+class TablebaseBuilder
+{
+	private:
+		struct job					// one thread's share of a group
+		{
+			TablebaseBuilder *owner;
+			int group, first, step;
+			PackedPositions found;		// down : children, with their lives and hashes
+			std::vector<int> foundLives;
+			std::vector<Uint64> foundKeys;
+		};
+
+		std::vector<PackedPositions> groups;			// positions by lives left, packed
+		std::vector< std::vector<Uint64> > keys;		// their hashes, in step
+		std::vector< std::vector<Sint8> > values;		// up : their outcomes
+		std::vector<Uint64> seen;		// every hash met (open addressing, 0 empty)
+		size_t seenCount;
+		std::vector<Uint64> solved;		// entries of the groups labelled so far, sorted
+		int threads;
+
+		/* Private functions */
+		bool insertSeen(Uint64);		// false if already there
+		bool isSeen(Uint64) const;
+		void runJobs(int, int (*)(void*));
+		static int expand(void*);
+		static int label(void*);
+
+	public:
+		/* Constructors */
+		TablebaseBuilder();
+
+		/* Public variables */
+		sproutsRules rules;
+		Uint64 positions;				// canonical positions met on the way down, of any lives
+		void (*progress)(const char*, int, size_t, void*);	// after each group of each sweep, if set : sweep, lives, positions
+		void *progressData;
+
+		/* Construction */
+		bool build(int, int, int, const char*);		// lives, most spots in a start, threads, file - false if the file could not be written
+};
+TablebaseBuilder::TablebaseBuilder()
+{
+	rules = normalPlay;
+	positions = 0;
+	progress = NULL;
+	progressData = NULL;
+	threads = 1;
+	seenCount = 0;
+}
+bool TablebaseBuilder::insertSeen(Uint64 key)
+{
+	if( !key )		// 0 marks an empty slot
+		key = 1;
+	if( 2*(seenCount + 1) > seen.size() )		// keep it at most half full
+	{
+		std::vector<Uint64> old( std::max( (size_t)1024, 2*seen.size() ), 0 );
+		old.swap( seen );
+		seenCount = 0;
+		for( size_t i = 0; i < old.size(); i++ )
+			if( old[i] )
+				insertSeen( old[i] );
+	}
+	size_t mask = seen.size() - 1;
+	for( size_t i = key & mask; ; i = (i + 1) & mask )
+	{
+		if( seen[i] == key )
+			return false;
+		if( !seen[i] )
+		{
+			seen[i] = key;
+			seenCount++;
+			return true;
+		}
+	}
+}
+bool TablebaseBuilder::isSeen(Uint64 key) const
+{
+	if( !key )
+		key = 1;
+	size_t mask = seen.size() - 1;
+	for( size_t i = key & mask; !seen.empty() && seen[i]; i = (i + 1) & mask )
+		if( seen[i] == key )
+			return true;
+	return false;
+}
+/* A group shared out position by position (position i to thread i % threads), one thread per share */
+void TablebaseBuilder::runJobs(int group, int (*work)(void*))
+{
+	std::vector<job> jobs( threads );
+	std::vector<SDL_Thread*> running( threads );
+	for( int t = 0; t < threads; t++ )
+	{
+		jobs[t].owner = this;
+		jobs[t].group = group;
+		jobs[t].first = t;
+		jobs[t].step = threads;
+		running[t] = SDL_CreateThread( work, &jobs[t] );
+	}
+	for( int t = 0; t < threads; t++ )
+		if( running[t] )
+			SDL_WaitThread( running[t], NULL );
+		else		// could not start a thread : its share is done here
+			work( &jobs[t] );
+	if( work != expand )
+		return;
+	for( int t = 0; t < threads; t++ )		// new children into their groups, once each
+		for( unsigned i = 0; i < jobs[t].found.size(); i++ )
+		{
+			int lives = jobs[t].foundLives[i];
+			Uint64 key = jobs[t].foundKeys[i];
+			if( !insertSeen( key ) )
+				continue;
+			groups[lives].push_back( jobs[t].found.data(i), jobs[t].found.length(i) );
+			keys[lives].push_back( key );
+		}
+}
+int TablebaseBuilder::expand(void *data)
+{
+	job &j = *(job*)data;
+	TablebaseBuilder &b = *j.owner;
+	const PackedPositions &group = b.groups[j.group];
+	Canonicalizer canonicalizer;
+	std::vector<sproutsMove> moves;
+	std::vector<Uint64> children;
+	position p, child, canon;
+	for( unsigned i = j.first; i < group.size(); i += j.step )
+	{
+		group.get( i, p );
+		generateMoves( p, moves );
+		children.clear();
+		for( unsigned m = 0; m < moves.size(); m++ )
+		{
+			applyMove( p, moves[m], child );
+			canonicalizer.canonical( child, canon );
+			Uint64 key = positionHash( canon, b.rules );
+			if( b.isSeen( key ) || std::find( children.begin(), children.end(), key ) != children.end() )		// seen is only written between groups
+				continue;
+			children.push_back( key );
+			j.found.push_back( canon );
+			j.foundLives.push_back( livesLeft( canon ) );
+			j.foundKeys.push_back( key );
+		}
+	}
+	return 0;
+}
+/* A position wins if some child loses - the children are in lower groups, all labelled already */
+int TablebaseBuilder::label(void *data)
+{
+	job &j = *(job*)data;
+	TablebaseBuilder &b = *j.owner;
+	const PackedPositions &group = b.groups[j.group];
+	std::vector<Sint8> &values = b.values[j.group];
+	Canonicalizer canonicalizer;
+	std::vector<sproutsMove> moves;
+	position p, child, canon;
+	for( unsigned i = j.first; i < group.size(); i += j.step )
+	{
+		group.get( i, p );
+		generateMoves( p, moves );
+		int value = moves.empty() && b.rules == misere ? 1 : -1;		// no move : lost, or won in misère
+		for( unsigned m = 0; m < moves.size() && value < 0; m++ )
+		{
+			applyMove( p, moves[m], child );
+			canonicalizer.canonical( child, canon );
+			Uint64 key = positionHash( canon, b.rules );
+			std::vector<Uint64>::const_iterator found = std::lower_bound( b.solved.begin(), b.solved.end(), key & ~tablebaseValueBit );
+			if( found != b.solved.end() && (*found | tablebaseValueBit) == (key | tablebaseValueBit) && !(*found & tablebaseValueBit) )
+				value = 1;
+		}
+		values[i] = value;
+	}
+	return 0;
+}
+bool TablebaseBuilder::build(int lives, int spots, int threadCount, const char *path)
+{
+	threads = std::max( threadCount, 1 );
+	int top = std::max( lives, positionLives*spots );
+	groups.assign( top + 1, PackedPositions() );
+	keys.assign( top + 1, std::vector<Uint64>() );
+	values.assign( top + 1, std::vector<Sint8>() );
+	seen.clear();
+	seenCount = 0;
+	solved.clear();
+	positions = 0;
+	for( int n = 1; n <= spots; n++ )
+	{
+		position start, canon;
+		Canonicalizer canonicalizer;
+		start.labels = 0;
+		for( int i = 0; i < n; i++ )
+		{
+			start.spots.push_back( 0 );
+			start.boundaryEnd.push_back( i + 1 );
+		}
+		start.regionEnd.push_back( n );
+		canonicalizer.canonical( start, canon );
+		Uint64 key = positionHash( canon, rules );
+		insertSeen( key );
+		groups[ livesLeft( canon ) ].push_back( canon );
+		keys[ livesLeft( canon ) ].push_back( key );
+	}
+
+	/* Down : a group is complete once every higher one has been opened */
+	for( int l = top; l >= 0; l-- )
+	{
+		runJobs( l, expand );
+		positions += groups[l].size();
+		if( progress )
+			progress( "opened", l, groups[l].size(), progressData );
+		if( l > lives )		// above the table : not needed again
+		{
+			groups[l].clear();
+			std::vector<Uint64>().swap( keys[l] );
+		}
+	}
+	std::vector<Uint64>().swap( seen );
+
+	/* Up : each group from the values of the ones below */
+	for( int l = 0; l <= lives; l++ )
+	{
+		values[l].assign( groups[l].size(), 0 );
+		runJobs( l, label );
+		size_t before = solved.size();
+		for( unsigned i = 0; i < groups[l].size(); i++ )
+			solved.push_back( (keys[l][i] & ~tablebaseValueBit) | (values[l][i] > 0 ? tablebaseValueBit : 0) );
+		std::sort( solved.begin() + before, solved.end() );
+		std::inplace_merge( solved.begin(), solved.begin() + before, solved.end() );
+		if( progress )
+			progress( "labelled", l, groups[l].size(), progressData );
+	}
+
+	/* Written whole before it replaces the old one, so a reader never maps half a table */
+	tablebaseHeader h;
+	memset( &h, 0, sizeof(h) );
+	memcpy( h.magic, tablebaseMagic, sizeof(tablebaseMagic) );
+	h.version = tablebaseVersion;
+	h.rules = rules;
+	h.lives = lives;
+	h.indexBits = tablebaseIndexBits;
+	h.count = solved.size();
+	std::vector<Uint32> index( ((size_t)1 << tablebaseIndexBits) + 1 );
+	size_t at = 0;
+	for( size_t b = 0; b < index.size(); b++ )
+	{
+		while( at < solved.size() && (solved[at] >> (64 - tablebaseIndexBits)) < b )
+			at++;
+		index[b] = at;
+	}
+	ReplacedFile out;
+	if( !out.open( path ) )
+		return false;
+	out.write( &h, sizeof(h), 1 );
+	out.write( &index[0], sizeof(Uint32), index.size() );
+	if( !solved.empty() )
+		out.write( &solved[0], sizeof(Uint64), solved.size() );
+	return out.commit();
+}
+
+#endif
@@ -0,0 +1,567 @@
+#ifndef TRIANGULATION_H
+#define TRIANGULATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "geometry.h"
+
+/* Constrained Delaunay triangulation of the board : the curves, cut into short segments, are edges that are never flipped,
+ * and the free space between them is cut into triangles that are as fat as those edges allow.
+ * Points go in by walking to the triangle that holds them and flipping until the triangles around them are Delaunay again,
+ * segments by flipping away the edges they cross (Sloan's method), so a new line only changes the triangles along it.
+ * The board keeps one next to its planar map, and the router follows its shortest paths where its grid is too coarse */
+
+/* Global constants for the triangulation */
+static const int meshPieces = 16;				// segments per curve
+static const double meshTolerance = 1e-9;		// relative : smaller orientations are collinear, closer points are the same point
+/* End constants */
+
+/* Twice the signed area of abc - positive when a, b, c turn counter-clockwise (with y up) */
+inline double orient(double ax, double ay, double bx, double by, double cx, double cy)
+{
+	return (bx - ax)*(cy - ay) - (by - ay)*(cx - ax);
+}
+
+class Triangulation
+{
+	public:
+		struct triangle
+		{
+			int v[3];				// corners, with orient > 0
+			int n[3];				// triangle across the edge opposite v[i] (-1 : outside the mesh)
+			bool fixed[3];			// the edge opposite v[i] is part of a curve
+		};
+
+	private:
+		std::vector<double> xs, ys;
+		std::vector<triangle> tris;
+		std::vector<int> vertexTriangle;	// one triangle at each vertex
+		int last;							// triangle the last walk ended in : the next walk starts there
+		std::vector<int> pending;			// triangles around a new point still to check
+
+		/* A* over triangles, kept between searches for their memory */
+		std::vector<double> cost;
+		std::vector<double> entryX, entryY;	// where the search entered each triangle
+		std::vector<int> parent;
+		std::vector<int> visited;
+
+		/* Private functions */
+		double orient(int a, int b, int c) const { return ::orient( xs[a], ys[a], xs[b], ys[b], xs[c], ys[c] ); }
+		bool collinear(int, int, int) const;
+		bool illegal(int, int) const;			// the edge opposite v[i] fails the empty circle test (and may be flipped)
+		void setTriangle(int, int, int, int, int, int, int, bool, bool, bool);
+		void relink(int, int, int, int);		// the triangle across edge ab of a neighbour is now t
+		int edgeIndex(int, int, int) const;		// index of the corner opposite edge ab in a triangle (-1 : not one of its edges)
+		int corner(int, int) const;				// index of a vertex in a triangle
+		void flip(int, int);					// swap the edge opposite v[i] for the other diagonal of the two triangles
+		int splitTriangle(int, int);
+		int splitEdge(int, int, int);
+		void legalize(int);					// flip around a new point until the triangles at it are Delaunay
+		bool findEdge(int, int, int&, int&) const;	// a triangle and index with edge ab opposite v[i]
+
+	public:
+		/* Constructors */
+		Triangulation();
+
+		/* Construction */
+		void clear(const box&);				// empty the mesh : two triangles covering well past the box
+		int insertPoint(double, double, double=0);	// add a point, or snap it onto a curve edge within the distance, returns its vertex
+		bool insertSegment(int, int);		// make ab an edge that is never flipped (false : it would cross another curve)
+		bool insertCurve(const cubic&);		// a curve as meshPieces segments
+
+		/* Queries */
+		int locate(double, double);			// triangle holding the point, by walking from the last one (-1 : off the mesh)
+		double shortestPath(double, double, double, double, std::vector<double>&, std::vector<double>&, double=0);	// corners of a short path that crosses no curve (kept the given distance off the corners it turns, where there is room), its length (-1 : none)
+		int triangles() const { return tris.size(); }
+		const triangle &tri(int t) const { return tris[t]; }
+		int vertices() const { return xs.size(); }
+		double x(int v) const { return xs[v]; }
+		double y(int v) const { return ys[v]; }
+};
+Triangulation::Triangulation()
+{
+	box b = { 0, 0, 1, 1 };
+	clear( b );
+}
+inline bool Triangulation::collinear(int a, int b, int c) const
+{
+	double abx = xs[b] - xs[a], aby = ys[b] - ys[a], acx = xs[c] - xs[a], acy = ys[c] - ys[a];
+	return fabs( orient( a, b, c ) ) <= meshTolerance*(abx*abx + aby*aby + acx*acx + acy*acy);
+}
+bool Triangulation::illegal(int t, int i) const
+{
+	const triangle &tr = tris[t];
+	if( tr.fixed[i] || tr.n[i] < 0 )
+		return false;
+	const triangle &u = tris[tr.n[i]];
+	int q = u.v[ edgeIndex( tr.n[i], tr.v[(i+1)%3], tr.v[(i+2)%3] ) ];
+	/* in circle determinant, positive when q is inside the circle through the corners */
+	double ax = xs[tr.v[0]] - xs[q], ay = ys[tr.v[0]] - ys[q],
+		   bx = xs[tr.v[1]] - xs[q], by = ys[tr.v[1]] - ys[q],
+		   cx = xs[tr.v[2]] - xs[q], cy = ys[tr.v[2]] - ys[q];
+	return (ax*ax + ay*ay)*(bx*cy - cx*by) - (bx*bx + by*by)*(ax*cy - cx*ay) + (cx*cx + cy*cy)*(ax*by - bx*ay) > 0;
+}
+void Triangulation::setTriangle(int t, int a, int b, int c, int na, int nb, int nc, bool fa, bool fb, bool fc)
+{
+	triangle &tr = tris[t];
+	tr.v[0] = a;	tr.v[1] = b;	tr.v[2] = c;
+	tr.n[0] = na;	tr.n[1] = nb;	tr.n[2] = nc;
+	tr.fixed[0] = fa;	tr.fixed[1] = fb;	tr.fixed[2] = fc;
+	vertexTriangle[a] = vertexTriangle[b] = vertexTriangle[c] = t;
+}
+inline int Triangulation::edgeIndex(int t, int a, int b) const
+{
+	const triangle &tr = tris[t];
+	for( int k = 0; k < 3; k++ )
+	{
+		int p = tr.v[(k+1)%3], q = tr.v[(k+2)%3];
+		if( (p == a && q == b) || (p == b && q == a) )
+			return k;
+	}
+	return -1;
+}
+inline int Triangulation::corner(int t, int v) const
+{
+	const triangle &tr = tris[t];
+	return tr.v[0] == v ? 0 : tr.v[1] == v ? 1 : 2;
+}
+inline void Triangulation::relink(int neighbour, int a, int b, int t)
+{
+	if( neighbour >= 0 )
+		tris[neighbour].n[ edgeIndex( neighbour, a, b ) ] = t;
+}
+/* t = (p, a, b) and u = (q, b, a) across ab become (p, a, q) and (q, b, p) across pq */
+void Triangulation::flip(int t, int i)
+{
+	triangle tr = tris[t];
+	int u = tr.n[i];
+	triangle ur = tris[u];
+	int p = tr.v[i], a = tr.v[(i+1)%3], b = tr.v[(i+2)%3];
+	int j = edgeIndex( u, a, b ), q = ur.v[j], ja = corner( u, a ), jb = corner( u, b );
+	int tA = tr.n[(i+1)%3], tB = tr.n[(i+2)%3], uA = ur.n[ja], uB = ur.n[jb];
+	bool fA = tr.fixed[(i+1)%3], fB = tr.fixed[(i+2)%3], gA = ur.fixed[ja], gB = ur.fixed[jb];
+	setTriangle( t, p, a, q, uB, u, tB, gB, false, fB );
+	setTriangle( u, q, b, p, tA, t, uA, fA, false, gA );
+	relink( tA, b, p, u );
+	relink( uB, a, q, t );
+}
+int Triangulation::splitTriangle(int t, int p)
+{
+	triangle tr = tris[t];
+	int a = tr.v[0], b = tr.v[1], c = tr.v[2];
+	int t2 = tris.size(), t3 = t2 + 1;
+	tris.resize( tris.size() + 2 );
+	setTriangle( t, a, b, p, t2, t3, tr.n[2], false, false, tr.fixed[2] );
+	setTriangle( t2, b, c, p, t3, t, tr.n[0], false, false, tr.fixed[0] );
+	setTriangle( t3, c, a, p, t, t2, tr.n[1], false, false, tr.fixed[1] );
+	relink( tr.n[0], b, c, t2 );
+	relink( tr.n[1], c, a, t3 );
+	pending.push_back( t );
+	pending.push_back( t2 );
+	pending.push_back( t3 );
+	return p;
+}
+/* t = (x, a, b) and u = (q, b, a) with p on ab become four triangles round p - a curve edge stays a curve edge on both halves */
+int Triangulation::splitEdge(int t, int i, int p)
+{
+	triangle tr = tris[t];
+	int x = tr.v[i], a = tr.v[(i+1)%3], b = tr.v[(i+2)%3], u = tr.n[i];
+	int tA = tr.n[(i+1)%3], tB = tr.n[(i+2)%3];
+	bool f = tr.fixed[i], fA = tr.fixed[(i+1)%3], fB = tr.fixed[(i+2)%3];
+	int t2 = tris.size(), u2 = u >= 0 ? t2 + 1 : -1;
+	tris.resize( tris.size() + (u >= 0 ? 2 : 1) );
+	if( u >= 0 )
+	{
+		triangle ur = tris[u];
+		int q = ur.v[ edgeIndex( u, a, b ) ], ja = corner( u, a ), jb = corner( u, b );
+		int uA = ur.n[ja], uB = ur.n[jb];
+		bool gA = ur.fixed[ja], gB = ur.fixed[jb];
+		setTriangle( u, q, b, p, t2, u2, uA, f, false, gA );
+		setTriangle( u2, q, p, a, t, uB, u, f, gB, false );
+		relink( uB, a, q, u2 );
+		pending.push_back( u );
+		pending.push_back( u2 );
+	}
+	setTriangle( t, x, a, p, u2, t2, tB, f, false, fB );
+	setTriangle( t2, x, p, b, u, tA, t, f, fA, false );
+	relink( tA, b, x, t2 );
+	pending.push_back( t );
+	pending.push_back( t2 );
+	return p;
+}
+void Triangulation::legalize(int p)
+{
+	while( !pending.empty() )
+	{
+		int t = pending.back();
+		pending.pop_back();
+		int k = corner( t, p );
+		if( tris[t].v[k] != p || !illegal( t, k ) )
+			continue;
+		int u = tris[t].n[k];
+		flip( t, k );
+		pending.push_back( t );
+		pending.push_back( u );
+	}
+}
+bool Triangulation::findEdge(int a, int b, int &t, int &i) const
+{
+	for( int turn = 0; turn < 2; turn++ )		// counter-clockwise round a, then clockwise if that runs off the mesh
+	{
+		int start = vertexTriangle[a], at = start;
+		do
+		{
+			int k = corner( at, a );
+			if( tris[at].v[(k+1)%3] == b )
+			{
+				t = at;
+				i = (k+2)%3;
+				return true;
+			}
+			if( tris[at].v[(k+2)%3] == b )
+			{
+				t = at;
+				i = (k+1)%3;
+				return true;
+			}
+			at = tris[at].n[ turn ? (k+2)%3 : (k+1)%3 ];
+		} while( at >= 0 && at != start );
+		if( at == start )
+			break;
+	}
+	return false;
+}
+void Triangulation::clear(const box &b)
+{
+	double w = std::max( b.x1 - b.x0, 1.0 ), h = std::max( b.y1 - b.y0, 1.0 );
+	double x0 = b.x0 - w, y0 = b.y0 - h, x1 = b.x1 + w, y1 = b.y1 + h;		// control points stray past the screen
+	xs.clear();
+	ys.clear();
+	xs.push_back( x0 );	ys.push_back( y0 );
+	xs.push_back( x1 );	ys.push_back( y0 );
+	xs.push_back( x1 );	ys.push_back( y1 );
+	xs.push_back( x0 );	ys.push_back( y1 );
+	vertexTriangle.assign( 4, 0 );
+	tris.resize( 2 );
+	setTriangle( 0, 0, 1, 2, -1, 1, -1, false, false, false );		// split along the diagonal 0-2
+	setTriangle( 1, 0, 2, 3, -1, -1, 0, false, false, false );
+	last = 0;
+}
+int Triangulation::locate(double x, double y)
+{
+	int t = last < (int)tris.size() ? last : 0, first = 0;
+	for( unsigned steps = 0; steps < 4*tris.size() + 16; steps++ )
+	{
+		bool moved = false;
+		for( int e = 0; e < 3; e++ )
+		{
+			int k = (first + e) % 3;		// the edge tried first turns each step, so the walk cannot circle
+			const triangle &tr = tris[t];
+			int a = tr.v[(k+1)%3], b = tr.v[(k+2)%3];
+			if( ::orient( xs[a], ys[a], xs[b], ys[b], x, y ) < 0 )
+			{
+				t = tr.n[k];
+				moved = true;
+				break;
+			}
+		}
+		if( t < 0 )
+			return -1;
+		if( !moved )
+		{
+			last = t;
+			return t;
+		}
+		first = (first + 1) % 3;
+	}
+	return -1;
+}
+int Triangulation::insertPoint(double x, double y, double snap)
+{
+	int t = locate( x, y );
+	if( t < 0 )
+		return -1;
+	const triangle &tr = tris[t];
+	double scale = (xs[2] - xs[0])*(xs[2] - xs[0]) + (ys[2] - ys[0])*(ys[2] - ys[0]);
+	for( int k = 0; k < 3; k++ )		// already there
+		if( (xs[tr.v[k]] - x)*(xs[tr.v[k]] - x) + (ys[tr.v[k]] - y)*(ys[tr.v[k]] - y) <= meshTolerance*meshTolerance*scale )
+			return tr.v[k];
+	int on = -1;
+	for( int k = 0; k < 3 && on < 0; k++ )		// on an edge, or near enough to a curve edge to snap onto it
+	{
+		int a = tr.v[(k+1)%3], b = tr.v[(k+2)%3];
+		double dx = xs[b] - xs[a], dy = ys[b] - ys[a], length2 = dx*dx + dy*dy;
+		double s = ((x - xs[a])*dx + (y - ys[a])*dy)/length2, o = ::orient( xs[a], ys[a], xs[b], ys[b], x, y );
+		if( fabs(o) <= meshTolerance*length2 || (tr.fixed[k] && o*o <= snap*snap*length2 && s > 0 && s < 1) )
+		{
+			if( s <= meshTolerance )
+				return a;
+			if( s >= 1 - meshTolerance )
+				return b;
+			x = xs[a] + s*dx;
+			y = ys[a] + s*dy;
+			on = k;
+		}
+	}
+	int p = xs.size();
+	xs.push_back( x );
+	ys.push_back( y );
+	vertexTriangle.push_back( t );
+	if( on >= 0 )
+		splitEdge( t, on, p );
+	else
+		splitTriangle( t, p );
+	legalize( p );
+	return p;
+}
+bool Triangulation::insertSegment(int a, int b)
+{
+	int t, i;
+	if( a == b )
+		return true;
+	if( findEdge( a, b, t, i ) )
+	{
+		tris[t].fixed[i] = true;
+		if( tris[t].n[i] >= 0 )
+			tris[ tris[t].n[i] ].fixed[ edgeIndex( tris[t].n[i], a, b ) ] = true;
+		return true;
+	}
+	/* Find the triangle at a that ab leaves through, then walk along ab collecting the edges it crosses */
+	std::vector< std::pair<int,int> > crossing, created;
+	t = -1;
+	int start = vertexTriangle[a], at = start;
+	do
+	{
+		int k = corner( at, a ), c1 = tris[at].v[(k+1)%3], c2 = tris[at].v[(k+2)%3];
+		for( int c = 0; c < 2; c++ )		// a vertex lying on ab : put in the two halves instead
+		{
+			int w = c ? c2 : c1;
+			if( collinear( a, b, w ) && (xs[w] - xs[a])*(xs[b] - xs[a]) + (ys[w] - ys[a])*(ys[b] - ys[a]) > 0 )
+				return insertSegment( a, w ) && insertSegment( w, b );
+		}
+		if( orient( a, c1, b ) > 0 && orient( a, b, c2 ) > 0 )
+		{
+			t = at;
+			i = k;
+			break;
+		}
+		at = tris[at].n[(k+1)%3];
+	} while( at >= 0 && at != start );
+	if( t < 0 )
+		return false;
+	while( true )
+	{
+		if( tris[t].fixed[i] )		// ab would cross another curve
+			return false;
+		int l = tris[t].v[(i+2)%3], r = tris[t].v[(i+1)%3];		// ends of the crossed edge, left and right of ab
+		crossing.push_back( std::make_pair( l, r ) );
+		int u = tris[t].n[i];
+		int w = tris[u].v[ edgeIndex( u, l, r ) ];
+		if( w == b )
+			break;
+		if( collinear( a, b, w ) )
+			return insertSegment( a, w ) && insertSegment( w, b );
+		t = u;
+		i = orient( a, b, w ) > 0 ? corner( u, l ) : corner( u, r );		// w left of ab : the next crossed edge is wr
+	}
+	/* Flip the crossed edges away - a crossed edge whose two triangles make a concave quad waits its turn */
+	unsigned stuck = 0;
+	while( !crossing.empty() )
+	{
+		std::pair<int,int> e = crossing.front();
+		crossing.erase( crossing.begin() );
+		findEdge( e.first, e.second, t, i );
+		int u = tris[t].n[i], p = tris[t].v[i], q = tris[u].v[ edgeIndex( u, e.first, e.second ) ];
+		if( orient( p, q, e.first )*orient( p, q, e.second ) >= 0 )
+		{
+			crossing.push_back( e );
+			if( ++stuck > 2*crossing.size() + 8 )	// nothing left can flip
+				return false;
+			continue;
+		}
+		stuck = 0;
+		flip( t, i );
+		if( p != a && p != b && q != a && q != b && orient( a, b, p )*orient( a, b, q ) < 0 )
+			crossing.push_back( std::make_pair( p, q ) );
+		else
+			created.push_back( std::make_pair( p, q ) );
+	}
+	/* ab is in the mesh now : fix it, then flip the new edges until they are Delaunay again */
+	findEdge( a, b, t, i );
+	tris[t].fixed[i] = true;
+	tris[ tris[t].n[i] ].fixed[ edgeIndex( tris[t].n[i], a, b ) ] = true;
+	bool changed = true;
+	while( changed )
+	{
+		changed = false;
+		for( unsigned k = 0; k < created.size(); k++ )
+		{
+			std::pair<int,int> &e = created[k];
+			if( (e.first == a && e.second == b) || (e.first == b && e.second == a) || !findEdge( e.first, e.second, t, i ) || !illegal( t, i ) )
+				continue;
+			int u = tris[t].n[i], p = tris[t].v[i], q = tris[u].v[ edgeIndex( u, e.first, e.second ) ];
+			flip( t, i );
+			e = std::make_pair( p, q );
+			changed = true;
+		}
+	}
+	return true;
+}
+bool Triangulation::insertCurve(const cubic &c)
+{
+	int from = insertPoint( c.x[0], c.y[0] );
+	for( int k = 1; k <= meshPieces && from >= 0; k++ )
+	{
+		double x, y;
+		evaluate( c, (double)k/meshPieces, x, y );
+		int to = insertPoint( x, y );
+		if( to < 0 || !insertSegment( from, to ) )
+			return false;
+		from = to;
+	}
+	return from >= 0;
+}
+/* A* from triangle to triangle through edges that are not curves, entering each where the edge is nearest the way to the goal,
+ * then the funnel algorithm pulls the path tight through that chain of triangles (shortest within the chain).
+ * A margin moves both ends of each portal in along it, by up to a quarter of its length : the path bends round points of the curves at that distance */
+double Triangulation::shortestPath(double x0, double y0, double x1, double y1, std::vector<double> &px, std::vector<double> &py, double margin)
+{
+	typedef std::pair<double, int> entry;
+	int start = locate( x0, y0 ), goal = locate( x1, y1 );
+	px.clear();
+	py.clear();
+	if( start < 0 || goal < 0 )
+		return -1;
+	for( unsigned k = 0; k < visited.size(); k++ )
+		parent[visited[k]] = -1;
+	visited.clear();
+	cost.resize( tris.size() );
+	entryX.resize( tris.size() );
+	entryY.resize( tris.size() );
+	parent.resize( tris.size(), -1 );
+	std::vector<entry> open;
+	std::greater<entry> later;
+	parent[start] = start;
+	cost[start] = 0;
+	entryX[start] = x0;
+	entryY[start] = y0;
+	visited.push_back( start );
+	open.push_back( entry( 0, start ) );
+	while( !open.empty() )
+	{
+		entry e = open.front();
+		std::pop_heap( open.begin(), open.end(), later );
+		open.pop_back();
+		int t = e.second;
+		double ex = entryX[t], ey = entryY[t];
+		if( t == goal )
+			break;
+		if( e.first > cost[t] + sqrt( (x1 - ex)*(x1 - ex) + (y1 - ey)*(y1 - ey) ) + 1e-9 )	// stale entry
+			continue;
+		for( int k = 0; k < 3; k++ )
+		{
+			int u = tris[t].n[k];
+			if( u < 0 || tris[t].fixed[k] )
+				continue;
+			int a = tris[t].v[(k+1)%3], b = tris[t].v[(k+2)%3];
+			double dx = xs[b] - xs[a], dy = ys[b] - ys[a], s = ((x1 - xs[a])*dx + (y1 - ys[a])*dy + (ex - xs[a])*dx + (ey - ys[a])*dy)/(2*(dx*dx + dy*dy));
+			s = std::max( 0.05, std::min( 0.95, s ) );		// between the points of the edge nearest the entry and the goal, kept off the corners
+			double mx = xs[a] + s*dx, my = ys[a] + s*dy, g = cost[t] + sqrt( (mx - ex)*(mx - ex) + (my - ey)*(my - ey) );
+			if( parent[u] >= 0 && g >= cost[u] )
+				continue;
+			if( parent[u] < 0 )
+				visited.push_back( u );
+			parent[u] = t;
+			entryX[u] = mx;
+			entryY[u] = my;
+			cost[u] = g;
+			open.push_back( entry( g + sqrt( (x1 - mx)*(x1 - mx) + (y1 - my)*(y1 - my) ), u ) );
+			std::push_heap( open.begin(), open.end(), later );
+		}
+	}
+	if( parent[goal] < 0 )
+		return -1;
+	/* Portals : the edges between consecutive triangles, as (left, right) seen walking from start to goal */
+	std::vector<int> chain;
+	for( int t = goal; t != start; t = parent[t] )
+		chain.push_back( t );
+	chain.push_back( start );
+	std::reverse( chain.begin(), chain.end() );
+	std::vector<double> lx( 1, x0 ), ly( 1, y0 ), rx( 1, x0 ), ry( 1, y0 );
+	for( unsigned k = 0; k + 1 < chain.size(); k++ )
+	{
+		const triangle &tr = tris[chain[k]];
+		int e = tr.n[0] == chain[k+1] ? 0 : tr.n[1] == chain[k+1] ? 1 : 2;
+		int l = tr.v[(e+2)%3], r = tr.v[(e+1)%3];
+		double dx = xs[r] - xs[l], dy = ys[r] - ys[l], d = sqrt( dx*dx + dy*dy ), in = d > 0 ? std::min( margin, d/4 )/d : 0;
+		lx.push_back( xs[l] + in*dx );	ly.push_back( ys[l] + in*dy );
+		rx.push_back( xs[r] - in*dx );	ry.push_back( ys[r] - in*dy );
+	}
+	lx.push_back( x1 );	ly.push_back( y1 );
+	rx.push_back( x1 );	ry.push_back( y1 );
+	/* Funnel : narrow the wedge from the apex portal by portal, and when one side crosses the other its end becomes the new apex */
+	double apexX = x0, apexY = y0, leftX = x0, leftY = y0, rightX = x0, rightY = y0, length = 0;
+	int apex = 0, left = 0, right = 0;
+	px.push_back( x0 );
+	py.push_back( y0 );
+	for( int k = 1; k < (int)lx.size(); k++ )
+	{
+		if( ::orient( apexX, apexY, rightX, rightY, rx[k], ry[k] ) >= 0 )		// right side moves in
+		{
+			if( (apexX == rightX && apexY == rightY) || ::orient( apexX, apexY, leftX, leftY, rx[k], ry[k] ) < 0 )
+			{
+				rightX = rx[k];
+				rightY = ry[k];
+				right = k;
+			}
+			else		// past the left side : the left end is a corner of the path
+			{
+				length += sqrt( (leftX - apexX)*(leftX - apexX) + (leftY - apexY)*(leftY - apexY) );
+				apexX = rightX = leftX;
+				apexY = rightY = leftY;
+				apex = right = left;
+				if( apexX != px.back() || apexY != py.back() )
+				{
+					px.push_back( apexX );
+					py.push_back( apexY );
+				}
+				k = apex;
+				continue;
+			}
+		}
+		if( ::orient( apexX, apexY, leftX, leftY, lx[k], ly[k] ) <= 0 )		// left side moves in
+		{
+			if( (apexX == leftX && apexY == leftY) || ::orient( apexX, apexY, rightX, rightY, lx[k], ly[k] ) > 0 )
+			{
+				leftX = lx[k];
+				leftY = ly[k];
+				left = k;
+			}
+			else		// past the right side : the right end is a corner of the path
+			{
+				length += sqrt( (rightX - apexX)*(rightX - apexX) + (rightY - apexY)*(rightY - apexY) );
+				apexX = leftX = rightX;
+				apexY = leftY = rightY;
+				apex = left = right;
+				if( apexX != px.back() || apexY != py.back() )
+				{
+					px.push_back( apexX );
+					py.push_back( apexY );
+				}
+				k = apex;
+				continue;
+			}
+		}
+	}
+	length += sqrt( (x1 - apexX)*(x1 - apexX) + (y1 - apexY)*(y1 - apexY) );
+	if( x1 != px.back() || y1 != py.back() )
+	{
+		px.push_back( x1 );
+		py.push_back( y1 );
+	}
+	return length;
+}
+
+#endif
@@ -1,3 +1,5 @@
+#ifndef XORRNG_H
+#define XORRNG_H
 
 /* Marsaglia's XOR-Shift RNG - source : class PowerPoint */
 /* This currently does not start with a random seed - very repeatable - yech */
@@ -11,9 +13,32 @@ inline unsigned long XORshiftRNG()
 	return (w = (w^(w>>19))^(t^(t>>8)));
 }
 
+/* The same generator with its state kept by the caller : one each for threads drawing at once, seeded apart */
+struct xorShiftState
+{ unsigned long x, y, z, w; };
+inline unsigned long XORshiftRNG( xorShiftState &s )
+{
+	unsigned long t = s.x^(s.x<<11);
+	s.x = s.y;
+	s.y = s.z;
+	s.z = s.w;
+	return (s.w = (s.w^(s.w>>19))^(t^(t>>8)));
+}
+inline void XORshiftSeed( xorShiftState &s, unsigned long seed )
+{
+	s.x = 123456789;
+	s.y = 362436069;
+	s.z = 521288629;
+	s.w = 88675123 ^ (seed*2654435761ul);		// never all zero
+	for( int i = 0; i < 16; i++ )		// mix the seed through the whole state
+		XORshiftRNG( s );
+}
+
 /* Returns a random number in [0,n) */
 inline int random( int n )
 {
 	// return XORshiftRNG() % n;	// use this once XOR-Shift RNG has a random start seed
 	return rand() % n;
 }
+
+#endif